@@ -0,0 +1,88 @@
+/* calibrationBench.c */
+
+/* Time the waveform calibration kernels and print the
+   cost of one waveform of each kind.
+
+   usage: calibrationBench [waveforms]
+	waveforms	calibrated per kind, default 1000000 */
+
+#include <stdio.h>
+#include <time.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/calibration.h"
+
+static CAL_TABLES tables;
+static CAL_HIT mv;
+static HIT_RECORD hit;
+static short fixed[ATWD_HI_LEN/2];
+
+static double nowNsec(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+
+    long count=1000000;
+    double start;
+    double sink=0;
+    long n;
+    int a;
+    int i;
+
+    if(argc>=2) {
+	sscanf(argv[1],"%li",&count);
+    }
+    if(count<1) {
+	count=1;
+    }
+
+    calibration_init(&tables);
+    for(a=0;a<HIT_ATWD_CNT;a++) {
+	for(i=0;i<CAL_SAMPLES;i++) {
+	    calibration_set(&tables,a,CAL_LO,i,50.0f+(i&3),2.0f+i/1000.0f);
+	    calibration_set(&tables,a,CAL_HI,i,50.0f+(i&3),0.25f+i/1000.0f);
+	}
+	for(i=0;i<ATWD_LO_LEN;i++) {
+	    hit.lo[a][i]=(UBYTE)(50+(i*7)%40);
+	}
+	for(i=0;i<ATWD_HI_LEN/2;i++) {
+	    hit.hi[a][i]=(USHORT)(50+(i*37)%900);
+	}
+    }
+
+    /* the ATWD varies so tables and samples move through
+       the cache as they would for real hits */
+    start=nowNsec();
+    for(n=0;n<count;n++) {
+	a=n&(HIT_ATWD_CNT-1);
+	calibration_apply8(&tables,a,hit.lo[a],ATWD_LO_LEN,mv.lo[a]);
+	sink+=mv.lo[a][n&(ATWD_LO_LEN-1)];
+    }
+    printf("lo  %4d samples: %7.1f ns/waveform\n",ATWD_LO_LEN,
+	(nowNsec()-start)/count);
+
+    start=nowNsec();
+    for(n=0;n<count;n++) {
+	a=n&(HIT_ATWD_CNT-1);
+	calibration_apply16(&tables,a,hit.hi[a],ATWD_HI_LEN/2,mv.hi[a]);
+	sink+=mv.hi[a][n&(ATWD_HI_LEN/2-1)];
+    }
+    printf("hi  %4d samples: %7.1f ns/waveform\n",ATWD_HI_LEN/2,
+	(nowNsec()-start)/count);
+
+    start=nowNsec();
+    for(n=0;n<count;n++) {
+	a=n&(HIT_ATWD_CNT-1);
+	calibration_toFixed(mv.hi[a],ATWD_HI_LEN/2,16.0f,fixed);
+	sink+=fixed[n&(ATWD_HI_LEN/2-1)];
+    }
+    printf("to fixed point:   %7.1f ns/waveform\n",(nowNsec()-start)/count);
+
+    /* keeps the work from being optimized away */
+    return (sink==0.5) ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+/* generatorBench.c */
+
+/* Run the hit generator through DATA_ACC_SET_GENERATOR,
+   paced and then as fast as the buffer takes, and print
+   the rates it reaches.  Exits 1 if the paced rate is
+   off by more than half or the unpaced one is not ten
+   times higher.
+
+   usage: generatorBench [rateHz [msec]]
+	rateHz		paced rate, default 10000
+	msec		length of each run, default 1000 */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "message/message.h"
+#include "domapp_common/commonServices.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/hitFilter.h"
+#include "dataAccess/scaler.h"
+#include "dataAccess/histogram.h"
+#include "dataAccess/dataAccess.h"
+#include "dataAccess/DAmessageAPIstatus.h"
+
+extern void formatLong(ULONG value, UBYTE *buf);
+extern ULONG unformatLong(UBYTE *buf);
+
+static MESSAGE_STRUCT m;
+static UBYTE body[MAXDATA_VALUE];
+
+/* send one DATA_ACC_SET_GENERATOR, returns the hits the
+   generator that was running made, or -1 */
+static long setGenerator(UBYTE mode, ULONG rateHz) {
+    Message_init(&m);
+    Message_setType(&m,DATA_ACCESS);
+    Message_setSubtype(&m,DATA_ACC_SET_GENERATOR);
+    Message_setData(&m,body,MAXDATA_VALUE);
+    body[0]=mode;
+    body[1]=REAL_DATA;
+    body[2]=20;
+    body[3]=ATWD0_LO_PRES|ATWD0_HI_PRES;
+    formatLong(rateHz,&body[4]);
+    Message_setDataLen(&m,DATA_ACC_SET_GENERATOR_LEN);
+    if(dataAccess_serve(&m)!=SUCCESS) {
+	return -1;
+    }
+    return (long)unformatLong(body);
+}
+
+/* hits a run of msec made at rateHz, or -1 */
+static long run(ULONG rateHz, long msec) {
+    if(setGenerator(DATA_ACC_GEN_FIXED,rateHz)<0) {
+	return -1;
+    }
+    usleep(msec*1000);
+    return setGenerator(DATA_ACC_GEN_STOP,0);
+}
+
+int main(int argc, char *argv[]) {
+
+    long rateHz=10000;
+    long msec=1000;
+    long expected;
+    long paced;
+    long unpaced;
+
+    if(argc>=2) {
+	sscanf(argv[1],"%li",&rateHz);
+    }
+    if(argc>=3) {
+	sscanf(argv[2],"%li",&msec);
+    }
+    if(rateHz<1) {
+	rateHz=1;
+    }
+    if(msec<1) {
+	msec=1;
+    }
+    expected=rateHz*msec/1000;
+
+    dataAccess_init();
+    paced=run(rateHz,msec);
+    unpaced=run(0,msec);
+    if((paced<0) || (unpaced<0)) {
+	printf("generatorBench: error in DATA_ACC_SET_GENERATOR\n");
+	return 1;
+    }
+    printf("paced   %7ld Hz: %10.0f hits/s\n",rateHz,paced*1000.0/msec);
+    printf("unpaced:          %10.0f hits/s\n",unpaced*1000.0/msec);
+
+    if((paced<expected/2) || (paced>expected+expected/2)) {
+	printf("generatorBench: generator rate not kept\n");
+	return 1;
+    }
+    if(unpaced<10*expected) {
+	printf("generatorBench: generator too slow\n");
+	return 1;
+    }
+    return 0;
+}
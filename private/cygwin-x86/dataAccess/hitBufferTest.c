@@ -0,0 +1,1237 @@
+/* hitBufferTest.c */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "message/message.h"
+#include "domapp_common/commonServices.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/hitFilter.h"
+#include "dataAccess/scaler.h"
+#include "dataAccess/histogram.h"
+#include "dataAccess/dataAccess.h"
+#include "dataAccess/DAmessageAPIstatus.h"
+#include "dataAccess/waveformCodec.h"
+#include "dataAccess/pulseFeatures.h"
+#include "dataAccess/calibration.h"
+#include "dataAccess/waveformFile.h"
+#include "dataAccess/hitGenerator.h"
+#include "dataAccess/pedestal.h"
+#include "dataAccess/hitBufferTest.h"
+
+#define ERROR -1
+
+extern void formatLong(ULONG value, UBYTE *buf);
+extern ULONG unformatLong(UBYTE *buf);
+extern void formatShort(USHORT value, UBYTE *buf);
+extern USHORT unformatShort(UBYTE *buf);
+#define TEST_READERS 2
+#define TEST_HITS 200000
+/* hit with ATWD0 lo and hi on the wire */
+#define TEST_HIT_LEN (DATA_ACC_HIT_HDR_LEN+ATWD_LO_LEN+ATWD_HI_LEN)
+#define TEST_RATE 10000
+#define TEST_RUN_MSEC 200
+/* sample where a generated pulse peaks */
+#define TEST_PEAK 16
+#define TEST_FILE "/tmp/hitBufferTest_waveforms.dat"
+#define TEST_RECORDS 3
+/* spreads hi samples over the whole 16 bit range */
+#define TEST_HI_STEP 511
+#define TEST_PACKED_HITS 8
+/* column scans: hits TEST_TICKS apart from a time that
+   wraps TEST_WRAP_AT hits in */
+#define TEST_TICKS 10
+#define TEST_WRAP_AT 500
+#define TEST_EXTRA 100
+/* window queries: hits wrap the clock TEST_WRAP_HITS in */
+#define TEST_WINDOW_HITS 50
+#define TEST_WRAP_HITS 20
+/* feature readout: every TEST_PRESCALE'th hit goes raw */
+#define TEST_PRESCALE 4
+/* more than one message holds */
+#define TEST_FEATURE_HITS (10*TEST_PRESCALE)
+#define TEST_FEATURE_HIT_LEN (DATA_ACC_HIT_HDR_LEN+2*(3+8))
+/* pedestal run: hits alternate between two levels */
+#define TEST_PED_HITS 100
+#define TEST_PED_CHANNEL_LEN (4+2*ATWD_LO_LEN*2)
+
+/* storage */
+char *errorMsg;
+HIT_BUFFER testHits;
+volatile int producerDone;
+/* fixed point rounding: halves and the edge of the range */
+const float tieIn[8]={0.5f,1.5f,2.5f,-0.5f,-1.5f,-2.5f,32766.5f,-32767.5f};
+const short tieOut[8]={0,2,2,0,-2,-2,32766,-32767};
+
+typedef struct {
+    HIT_READER r;
+    ULONG got;
+    int outOfOrder;
+} TEST_READER;
+
+static void *readerThread(void *arg) {
+    TEST_READER *t=(TEST_READER *)arg;
+    static __thread HIT_RECORD hit;
+    ULONG expect=0;
+
+    for(;;) {
+	if(!hitBuffer_peek(&testHits,&t->r,&hit)) {
+	    if(producerDone && (t->r.next==testHits.head)) {
+		break;
+	    }
+	    continue;
+	}
+	/* lost hits leave a gap, nothing may come twice */
+	if((hit.seq<expect) || (hit.dom.trig.time!=hit.seq)) {
+	    t->outOfOrder++;
+	}
+	expect=hit.seq+1;
+	hitBuffer_next(&t->r);
+	t->got++;
+    }
+    return 0;
+}
+
+static void fillHit(HIT_RECORD *h, ULONG time) {
+    memset(&h->dom,0,sizeof(DOM_DATA));
+    h->dom.trig.time=time;
+    h->dom.trig.SPE=TRUE;
+    h->dom.atwd0.lo=TRUE;
+    h->dom.atwd0.hi=TRUE;
+}
+
+/* GET_DATA through the service, returns the hit count */
+static int readout(MESSAGE_STRUCT *M, UBYTE *body, int encoding) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_GET_DATA);
+    Message_setData(M,body,MAXDATA_VALUE);
+    Message_setDataLen(M,0);
+    /* raw is also what an empty request asks for */
+    if(encoding!=DATA_ACC_ENC_RAW) {
+	body[0]=(UBYTE)encoding;
+	Message_setDataLen(M,1);
+    }
+    if(dataAccess_serve(M)!=SUCCESS) {
+	return -1;
+    }
+    return (body[0]<<8)|body[1];
+}
+
+/* DATA_ACC_SET_FEATURES through the service */
+static int setFeatures(MESSAGE_STRUCT *M, UBYTE *body, USHORT prescale) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_SET_FEATURES);
+    Message_setData(M,body,MAXDATA_VALUE);
+    formatShort(DATA_ACC_FEATURE_LO_THRESHOLD,&body[0]);
+    formatShort(DATA_ACC_FEATURE_HI_THRESHOLD,&body[2]);
+    formatShort(prescale,&body[4]);
+    Message_setDataLen(M,DATA_ACC_SET_FEATURES_LEN);
+    return (dataAccess_serve(M)==SUCCESS) ? 0 : -1;
+}
+
+/* DATA_ACC_SET_CALIBRATION of ATWD0 hi through the
+   service: pedestal p+i%3 and gain g at sample i */
+static int setCalibration(MESSAGE_STRUCT *M, UBYTE *body, float p,
+	float g) {
+    union {
+	unsigned int bits;
+	float value;
+    } x;
+    int i;
+
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_SET_CALIBRATION);
+    Message_setData(M,body,MAXDATA_VALUE);
+    body[0]=0;
+    body[1]=CAL_HI;
+    formatShort(0,&body[2]);
+    formatShort(CAL_SAMPLES,&body[4]);
+    for(i=0;i<CAL_SAMPLES;i++) {
+	x.value=p+i%3;
+	formatLong(x.bits,&body[DATA_ACC_SET_CALIBRATION_LEN+8*i]);
+	x.value=g;
+	formatLong(x.bits,&body[DATA_ACC_SET_CALIBRATION_LEN+8*i+4]);
+    }
+    Message_setDataLen(M,DATA_ACC_SET_CALIBRATION_LEN+8*CAL_SAMPLES);
+    return (dataAccess_serve(M)==SUCCESS) ? 0 : -1;
+}
+
+/* DATA_ACC_GET_PEDESTAL through the service, returns
+   the state */
+static int getPedestal(MESSAGE_STRUCT *M, UBYTE *body, int atwd) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_GET_PEDESTAL);
+    Message_setData(M,body,MAXDATA_VALUE);
+    body[0]=(UBYTE)atwd;
+    body[1]=TRUE;
+    Message_setDataLen(M,(atwd<0) ? 0 : DATA_ACC_GET_PEDESTAL_LEN);
+    if(dataAccess_serve(M)!=SUCCESS) {
+	return -1;
+    }
+    return body[0];
+}
+
+/* hit for a pedestal run: ATWD0 lo at 10 or 14, hi at
+   50 or 52 */
+static void pedestalHit(HIT_RECORD *h, int odd) {
+    int i;
+
+    fillHit(h,0);
+    memset(h->lo[0],odd ? 14 : 10,ATWD_LO_LEN);
+    for(i=0;i<ATWD_HI_LEN/2;i++) {
+	h->hi[0][i]=odd ? 52 : 50;
+    }
+}
+
+/* DATA_ACC_SET_FILTER through the service: drop the
+   hits not of classes */
+static int setFilter(MESSAGE_STRUCT *M, UBYTE *body, UBYTE classes,
+	UBYTE classAction) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_SET_FILTER);
+    Message_setData(M,body,MAXDATA_VALUE);
+    body[0]=0;
+    body[1]=0;
+    body[2]=classes;
+    body[3]=HIT_FILTER_KEEP;
+    body[4]=HIT_FILTER_KEEP;
+    body[5]=classAction;
+    Message_setDataLen(M,DATA_ACC_SET_FILTER_LEN);
+    return (dataAccess_serve(M)==SUCCESS) ? 0 : -1;
+}
+
+/* GET_FILTER_STATS through the service, returns kept */
+static long filterKept(MESSAGE_STRUCT *M, UBYTE *body, ULONG *dropped) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_GET_FILTER_STATS);
+    Message_setData(M,body,MAXDATA_VALUE);
+    Message_setDataLen(M,0);
+    if((dataAccess_serve(M)!=SUCCESS) ||
+	(Message_dataLen(M)!=DATA_ACC_GET_FILTER_STATS_LEN)) {
+	return -1;
+    }
+    *dropped=unformatLong(&body[DATA_ACC_GET_FILTER_STATS_LEN-4]);
+    return (long)unformatLong(&body[DATA_ACC_GET_FILTER_STATS_LEN-12]);
+}
+
+/* SET_HISTOGRAM through the service */
+static int setHistogram(MESSAGE_STRUCT *M, UBYTE *body, int quantity,
+	HIST_AXIS *a) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_SET_HISTOGRAM);
+    Message_setData(M,body,MAXDATA_VALUE);
+    body[0]=quantity;
+    body[1]=a->scale;
+    body[2]=a->shift;
+    formatShort(a->bins,&body[3]);
+    formatLong((ULONG)a->lo,&body[5]);
+    formatLong(a->width,&body[9]);
+    Message_setDataLen(M,DATA_ACC_SET_HISTOGRAM_LEN);
+    return (dataAccess_serve(M)==SUCCESS) ? 0 : -1;
+}
+
+/* GET_HISTOGRAM since the last read through the service,
+   decoded into count.  Returns the hits in the bins. */
+static long getHistogram(MESSAGE_STRUCT *M, UBYTE *body, int quantity,
+	int format, ULONG *count) {
+    UBYTE *p=&body[DATA_ACC_HISTOGRAM_HDR_LEN];
+    unsigned int zz;
+    ULONG prev=0;
+    long total=0;
+    int bins;
+    int shift;
+    int n;
+    int i;
+
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_GET_HISTOGRAM);
+    Message_setData(M,body,MAXDATA_VALUE);
+    body[0]=quantity;
+    body[1]=format;
+    body[2]=TRUE;
+    Message_setDataLen(M,DATA_ACC_GET_HISTOGRAM_LEN);
+    if((dataAccess_serve(M)!=SUCCESS) || (body[0]!=quantity) ||
+	(body[1]!=format)) {
+	return -1;
+    }
+    bins=unformatShort(&body[2]);
+    count[0]=unformatLong(&body[4]);
+    count[bins+1]=unformatLong(&body[8]);
+    memset(&count[1],0,bins*sizeof(ULONG));
+    if(format==HIST_SPARSE) {
+	n=unformatShort(p);
+	for(p+=2;n>0;n--,p+=6) {
+	    count[1+unformatShort(p)]=unformatLong(&p[2]);
+	}
+    }
+    else {
+	for(i=0;i<bins;i++) {
+	    zz=0;
+	    for(shift=0;;shift+=7) {
+		zz|=(unsigned int)(*p&0x7f)<<shift;
+		if((*p++&0x80)==0) {
+		    break;
+		}
+	    }
+	    prev+=(int)(zz>>1)^-(int)(zz&1);
+	    count[1+i]=prev&0xffffffff;
+	}
+    }
+    if(p-body!=Message_dataLen(M)) {
+	return -1;
+    }
+    for(i=1;i<=bins;i++) {
+	total+=count[i];
+    }
+    return total;
+}
+
+/* GET_WINDOW through the service, returns the hit count */
+static int window(MESSAGE_STRUCT *M, UBYTE *body, ULONG fromEpoch,
+	ULONG fromTime, ULONG toEpoch, ULONG toTime) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_GET_WINDOW);
+    Message_setData(M,body,MAXDATA_VALUE);
+    formatLong(fromEpoch,&body[0]);
+    formatLong(fromTime,&body[4]);
+    formatLong(toEpoch,&body[8]);
+    formatLong(toTime,&body[12]);
+    body[16]=DATA_ACC_ENC_RAW;
+    Message_setDataLen(M,DATA_ACC_GET_WINDOW_LEN);
+    if(dataAccess_serve(M)!=SUCCESS) {
+	return -1;
+    }
+    return (body[0]<<8)|body[1];
+}
+
+/* run the generator through DATA_ACC_SET_GENERATOR for
+   a while, returns the hits it made */
+static long runGenerator(MESSAGE_STRUCT *M, UBYTE *body, ULONG rateHz) {
+    Message_init(M);
+    Message_setType(M,DATA_ACCESS);
+    Message_setSubtype(M,DATA_ACC_SET_GENERATOR);
+    Message_setData(M,body,MAXDATA_VALUE);
+    body[0]=DATA_ACC_GEN_FIXED;
+    body[1]=REAL_DATA;
+    body[2]=20;
+    body[3]=ATWD0_LO_PRES|ATWD0_HI_PRES;
+    formatLong(rateHz,&body[4]);
+    Message_setDataLen(M,DATA_ACC_SET_GENERATOR_LEN);
+    if(dataAccess_serve(M)!=SUCCESS) {
+	return -1;
+    }
+    usleep(TEST_RUN_MSEC*1000);
+    /* the reply took the front of body */
+    body[0]=DATA_ACC_GEN_STOP;
+    body[1]=REAL_DATA;
+    body[2]=20;
+    body[3]=ATWD0_LO_PRES|ATWD0_HI_PRES;
+    Message_setDataLen(M,DATA_ACC_SET_GENERATOR_LEN);
+    if(dataAccess_serve(M)!=SUCCESS) {
+	return -1;
+    }
+    return (long)unformatLong(body);
+}
+
+/* code and decode lo and hi, TRUE if nothing changed */
+static BOOLEAN roundTrip(UBYTE *lo, USHORT *hi) {
+    UBYTE coded[WAVE_CODEC_MAX_LEN(ATWD_HI_LEN/2,2)];
+    UBYTE lo2[ATWD_LO_LEN];
+    USHORT hi2[ATWD_HI_LEN/2];
+    int len;
+
+    len=waveformCodec_encode8(lo,ATWD_LO_LEN,coded);
+    if((len>WAVE_CODEC_MAX_LEN(ATWD_LO_LEN,1)) ||
+	(waveformCodec_decode8(coded,len,lo2,ATWD_LO_LEN)!=len) ||
+	(waveformCodec_decode8(coded,len-1,lo2,ATWD_LO_LEN)!=-1) ||
+	(memcmp(lo,lo2,ATWD_LO_LEN)!=0)) {
+	return FALSE;
+    }
+    len=waveformCodec_encode16(hi,ATWD_HI_LEN/2,coded);
+    if((len>WAVE_CODEC_MAX_LEN(ATWD_HI_LEN/2,2)) ||
+	(waveformCodec_decode16(coded,len,hi2,ATWD_HI_LEN/2)!=len) ||
+	(waveformCodec_decode16(coded,len-1,hi2,ATWD_HI_LEN/2)!=-1) ||
+	(memcmp(hi,hi2,ATWD_HI_LEN)!=0)) {
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/* a waveform file of TEST_RECORDS hits with ATWD0 lo
+   and hi, and a cut short one after them */
+static int writeWaveforms(void) {
+    UBYTE rec[TEST_HIT_LEN];
+    FILE *out=fopen(TEST_FILE,"w");
+    int i;
+    int j;
+
+    if(out==0) {
+	return -1;
+    }
+    for(i=0;i<TEST_RECORDS;i++) {
+	memset(rec,0,sizeof(rec));
+	rec[0]=TEST_HIT_LEN>>8;
+	rec[1]=TEST_HIT_LEN&0xff;
+	rec[2]=ATWD0_LO_PRES|ATWD0_HI_PRES;
+	rec[3]=MSPE_MASK;
+	rec[15]=(UBYTE)(i+1);
+	for(j=0;j<ATWD_LO_LEN;j++) {
+	    rec[DATA_ACC_HIT_HDR_LEN+j]=(UBYTE)(255-j);
+	}
+	for(j=0;j<ATWD_HI_LEN/2;j++) {
+	    formatShort((USHORT)(j*TEST_HI_STEP),
+		&rec[DATA_ACC_HIT_HDR_LEN+ATWD_LO_LEN+2*j]);
+	}
+	fwrite(rec,1,sizeof(rec),out);
+    }
+    fwrite(rec,1,DATA_ACC_HIT_HDR_LEN+1,out);
+    fclose(out);
+    return 0;
+}
+
+/* test entry point */
+int hitBufferTest() {
+    static HIT_RECORD hit;
+    static UBYTE body[MAXDATA_VALUE];
+    TEST_READER readers[TEST_READERS];
+    pthread_t ids[TEST_READERS];
+    MESSAGE_STRUCT m;
+    HIT_READER idle;
+    HIT_GEN_CONFIG cfg;
+    WAVEFORM_FILE file;
+    static HIT_GEN gen;
+    static HIT_RECORD sent[TEST_PACKED_HITS];
+    static UBYTE match[HIT_BUFFER_LEN];
+    static UBYTE lo[ATWD_LO_LEN];
+    static USHORT hi[ATWD_HI_LEN/2];
+    PULSE_FEATURES f;
+    static PED_SUMS peds;
+    static HIT_RECORD batch[HIT_FILTER_BATCH];
+    UBYTE verdict[HIT_FILTER_BATCH];
+    HIT_FILTER filter;
+    HIT_FILTER_CONFIG fc;
+    ULONG dropped;
+    static SCALER scaler;
+    ULONG lost;
+    ULONG sum;
+    static HISTOGRAM hist;
+    static ULONG counts[HIST_MAX_BINS+2];
+    HIST_PART *part;
+    HIST_PART *other;
+    HIST_AXIS axis;
+    static USHORT pedMean[PED_SAMPLES];
+    static USHORT pedVar[PED_SAMPLES];
+    static CAL_TABLES cal;
+    static float mv[CAL_SAMPLES];
+    static short fixed[CAL_SAMPLES];
+    float want;
+    HIT_RECORD *h;
+    UBYTE *p;
+    UBYTE *next;
+    ULONG first;
+    ULONG t0;
+    int i;
+    int j;
+    int k;
+
+    /* overwrite: the producer never waits, readers see */
+    /*	every hit in order or count it lost */
+    hitBuffer_init(&testHits,HIT_OVERWRITE);
+    producerDone=FALSE;
+    for(i=0;i<TEST_READERS;i++) {
+	memset(&readers[i],0,sizeof(TEST_READER));
+	hitBuffer_addReader(&testHits,&readers[i].r,HIT_FROM_OLDEST);
+	pthread_create(&ids[i],NULL,readerThread,&readers[i]);
+    }
+    for(i=0;i<TEST_HITS;i++) {
+	h=hitBuffer_claim(&testHits);
+	h->dom.trig.time=i;
+	hitBuffer_publish(&testHits);
+    }
+    producerDone=TRUE;
+    for(i=0;i<TEST_READERS;i++) {
+	pthread_join(ids[i],NULL);
+	if((readers[i].outOfOrder!=0) ||
+	    (readers[i].got+readers[i].r.lost!=TEST_HITS)) {
+	    errorMsg="hitBufferTest: overwrite reader lost track";
+	    return ERROR;
+	}
+	hitBuffer_removeReader(&testHits,&readers[i].r);
+    }
+
+    /* stop: a reader that does not read holds the producer */
+    hitBuffer_init(&testHits,HIT_STOP);
+    hitBuffer_addReader(&testHits,&idle,HIT_FROM_OLDEST);
+    for(i=0;i<HIT_BUFFER_LEN+10;i++) {
+	fillHit(&hit,i);
+	hitBuffer_put(&testHits,&hit);
+    }
+    if((testHits.dropped!=10) ||
+	(hitBuffer_pending(&testHits,&idle)!=HIT_BUFFER_LEN) ||
+	!hitBuffer_peek(&testHits,&idle,&hit) || (hit.seq!=0)) {
+	errorMsg="hitBufferTest: stop policy not applied";
+	return ERROR;
+    }
+
+    /* columns: the ring and the clock both wrap in the */
+    /*	stretch scanned, every other hit is SPE */
+    hitBuffer_init(&testHits,HIT_OVERWRITE);
+    t0=HIT_TIME_MASK-(TEST_WRAP_AT+TEST_EXTRA)*TEST_TICKS+1;
+    for(i=0;i<HIT_BUFFER_LEN+TEST_EXTRA;i++) {
+	fillHit(&hit,t0+i*TEST_TICKS);
+	hit.dom.trig.SPE=(i&1)==0;
+	hit.dom.trig.quality=(BYTE)i;
+	hit.lo[0][1]=(UBYTE)i;
+	hitBuffer_put(&testHits,&hit);
+    }
+    first=TEST_EXTRA;
+    k=HIT_BUFFER_LEN;
+    t0=(t0+(TEST_WRAP_AT+TEST_EXTRA-5)*TEST_TICKS)&HIT_TIME_MASK;
+    if((hitBuffer_countTime(&testHits,first,k,t0,10*TEST_TICKS)!=10) ||
+	(hitBuffer_countTime(&testHits,first,k,t0+1,TEST_TICKS)!=1) ||
+	(hitBuffer_countTime(&testHits,first,k,0,HIT_TIME_MASK)!=k) ||
+	(hitBuffer_countFlags(&testHits,first,k,HIT_FLAG_SPE,
+	    HIT_FLAG_SPE)!=k/2) ||
+	(hitBuffer_countFlags(&testHits,first,k,HIT_FLAG_PRESENT,
+	    ATWD0_LO_PRES|ATWD0_HI_PRES)!=k)) {
+	errorMsg="hitBufferTest: error in column counts";
+	return ERROR;
+    }
+    if((hitBuffer_select(&testHits,first,k,t0,10*TEST_TICKS,
+	    HIT_FLAG_SPE,HIT_FLAG_SPE,match)!=5) ||
+	(match[TEST_WRAP_AT-5]!=0) || (match[TEST_WRAP_AT-4]!=1) ||
+	(match[TEST_WRAP_AT+5]!=0)) {
+	errorMsg="hitBufferTest: error in column select";
+	return ERROR;
+    }
+    if(!hitBuffer_row(&testHits,first+TEST_WRAP_AT,&hit) ||
+	(hit.dom.trig.time!=0) || (hit.lo[0][1]!=(UBYTE)(first+TEST_WRAP_AT)) ||
+	(hit.dom.trig.quality!=(BYTE)(first+TEST_WRAP_AT)) ||
+	!hit.dom.trig.SPE || !hit.dom.atwd0.hi || hit.dom.atwd1.lo ||
+	hitBuffer_row(&testHits,first-1,&hit)) {
+	errorMsg="hitBufferTest: error in row view";
+	return ERROR;
+    }
+
+    /* time index: hits before the wrap are epoch 0 */
+    t0=HIT_TIME_MASK-(TEST_WRAP_AT+TEST_EXTRA)*TEST_TICKS+1;
+    k=TEST_WRAP_AT+TEST_EXTRA;
+    if((hitBuffer_find(&testHits,0,t0+(k-5)*TEST_TICKS)!=k-5) ||
+	(hitBuffer_find(&testHits,0,t0+(k-5)*TEST_TICKS+1)!=k-4) ||
+	(hitBuffer_find(&testHits,1,0)!=k) ||
+	(hitBuffer_find(&testHits,1,5*TEST_TICKS)!=k+5) ||
+	(hitBuffer_find(&testHits,0,0)!=first) ||
+	(hitBuffer_find(&testHits,2,0)!=testHits.head) ||
+	!hitBuffer_row(&testHits,k,&hit) || (hit.epoch!=1)) {
+	errorMsg="hitBufferTest: error in time index";
+	return ERROR;
+    }
+    /* a late hit from before the wrap is not a wrap */
+    fillHit(&hit,HIT_TIME_MASK-1);
+    hitBuffer_put(&testHits,&hit);
+    fillHit(&hit,(HIT_BUFFER_LEN+TEST_EXTRA-k)*TEST_TICKS);
+    hitBuffer_put(&testHits,&hit);
+    if(!hitBuffer_row(&testHits,testHits.head-2,&hit) ||
+	(hit.epoch!=0) ||
+	!hitBuffer_row(&testHits,testHits.head-1,&hit) ||
+	(hit.epoch!=1)) {
+	errorMsg="hitBufferTest: late hit taken for a wrap";
+	return ERROR;
+    }
+
+    /* readout returns whole hits only, as many as fit */
+    commonServices_init(&dataAcc,0,0);
+    dataAccess_init();
+    for(i=0;i<20;i++) {
+	fillHit(&hit,i);
+	hitBuffer_put(&dataAccHits,&hit);
+    }
+    i=(MAXDATA_VALUE-DATA_ACC_DATA_HDR_LEN)/TEST_HIT_LEN;
+    if((readout(&m,body,DATA_ACC_ENC_RAW)!=i) ||
+	(Message_dataLen(&m)!=DATA_ACC_DATA_HDR_LEN+i*TEST_HIT_LEN) ||
+	(((body[2]<<8)|body[3])!=TEST_HIT_LEN) ||
+	(body[4]!=(ATWD0_LO_PRES|ATWD0_HI_PRES))) {
+	errorMsg="hitBufferTest: error in DATA_ACC_GET_DATA";
+	return ERROR;
+    }
+    if((readout(&m,body,DATA_ACC_ENC_RAW)!=20-i) ||
+	(readout(&m,body,DATA_ACC_ENC_RAW)!=0)) {
+	errorMsg="hitBufferTest: readout lost hits";
+	return ERROR;
+    }
+
+    /* generated patterns */
+    memset(&cfg,0,sizeof(cfg));
+    cfg.pattern=FMT_CNT;
+    cfg.present=ATWD1_HI_PRES;
+    hitGenerator_init(&gen,&cfg);
+    hitGenerator_next(&gen,&hit);
+    if(!hit.dom.atwd1.hi || hit.dom.atwd0.lo || (hit.hi[1][5]!=5)) {
+	errorMsg="hitBufferTest: error in FMT_CNT pattern";
+	return ERROR;
+    }
+    cfg.pattern=REAL_DATA;
+    cfg.mspePercent=100;
+    cfg.present=ATWD0_LO_PRES|ATWD0_HI_PRES;
+    hitGenerator_init(&gen,&cfg);
+    for(i=0;i<100;i++) {
+	hitGenerator_next(&gen,&hit);
+	k=hit.dom.trig.energy/HIT_GEN_SPE_CHARGE;
+	if(hit.dom.trig.SPE || (k<2) || (k>HIT_GEN_MAX_PE) ||
+	    (hit.hi[0][0]!=HIT_GEN_PEDESTAL) ||
+	    (hit.hi[0][TEST_PEAK]!=HIT_GEN_PEDESTAL+k*gen.hiPulse[TEST_PEAK]) ||
+	    (hit.lo[0][TEST_PEAK]!=HIT_GEN_PEDESTAL+k*gen.loPulse[TEST_PEAK])) {
+	    errorMsg="hitBufferTest: error in REAL_DATA pattern";
+	    return ERROR;
+	}
+    }
+
+    /* coding is lossless for flat, pulsed, noisy and */
+    /*	extreme waveforms */
+    for(i=0;i<ATWD_HI_LEN/2;i++) {
+	lo[i]=HIT_GEN_PEDESTAL;
+	hi[i]=HIT_GEN_PEDESTAL;
+    }
+    k=!roundTrip(lo,hi);
+    k|=(waveformCodec_encode16(hi,ATWD_HI_LEN/2,body)>=ATWD_HI_LEN/8);
+    k|=!roundTrip(hit.lo[0],hit.hi[0]);
+    srand(1);
+    for(i=0;i<ATWD_HI_LEN/2;i++) {
+	lo[i]=(UBYTE)rand();
+	hi[i]=(USHORT)rand();
+    }
+    k|=!roundTrip(lo,hi);
+    for(i=0;i<ATWD_HI_LEN/2;i++) {
+	lo[i]=(i&1) ? 255 : 0;
+	hi[i]=(i&1) ? 0xffff : 0;
+    }
+    k|=!roundTrip(lo,hi);
+    if(k) {
+	errorMsg="hitBufferTest: waveform coding not lossless";
+	return ERROR;
+    }
+
+    /* a packed readout gives back the waveforms put in */
+    for(i=0;i<TEST_PACKED_HITS;i++) {
+	hitGenerator_next(&gen,&sent[i]);
+	hitBuffer_put(&dataAccHits,&sent[i]);
+    }
+    if(readout(&m,body,DATA_ACC_ENC_PACKED)!=TEST_PACKED_HITS) {
+	errorMsg="hitBufferTest: packed readout lost hits";
+	return ERROR;
+    }
+    p=body+DATA_ACC_DATA_HDR_LEN;
+    for(i=0;i<TEST_PACKED_HITS;i++) {
+	k=(p[0]<<8)|p[1];
+	if((k>=TEST_HIT_LEN) || (p[19]!=DATA_ACC_ENC_PACKED) ||
+	    (p[2]!=(ATWD0_LO_PRES|ATWD0_HI_PRES))) {
+	    errorMsg="hitBufferTest: error in packed hit header";
+	    return ERROR;
+	}
+	next=p+k;
+	p+=DATA_ACC_HIT_HDR_LEN;
+	p+=waveformCodec_decode8(p,ATWD_LO_LEN+1,lo,ATWD_LO_LEN);
+	if((waveformCodec_decode16(p,ATWD_HI_LEN+1,hi,ATWD_HI_LEN/2)<0) ||
+	    (memcmp(lo,sent[i].lo[0],ATWD_LO_LEN)!=0) ||
+	    (memcmp(hi,sent[i].hi[0],ATWD_HI_LEN)!=0)) {
+	    errorMsg="hitBufferTest: error in packed waveforms";
+	    return ERROR;
+	}
+	p=next;
+    }
+    if(p!=body+Message_dataLen(&m)) {
+	errorMsg="hitBufferTest: packed hit lengths wrong";
+	return ERROR;
+    }
+
+    /* window queries find hits across the wrap and leave */
+    /*	the readout place alone */
+    dataAccess_init();
+    t0=HIT_TIME_MASK-TEST_WRAP_HITS*TEST_TICKS+1;
+    for(i=0;i<TEST_WINDOW_HITS;i++) {
+	fillHit(&hit,t0+i*TEST_TICKS);
+	hitBuffer_put(&dataAccHits,&hit);
+    }
+    k=TEST_WRAP_HITS-3;
+    if((window(&m,body,0,t0+k*TEST_TICKS,1,2*TEST_TICKS)!=5) ||
+	(unformatLong(&body[2])!=0) || (unformatLong(&body[6])!=0) ||
+	(unformatLong(&body[DATA_ACC_WINDOW_HDR_LEN+4])!=k) ||
+	(Message_dataLen(&m)!=DATA_ACC_WINDOW_HDR_LEN+5*TEST_HIT_LEN)) {
+	errorMsg="hitBufferTest: error in DATA_ACC_GET_WINDOW";
+	return ERROR;
+    }
+    i=(MAXDATA_VALUE-DATA_ACC_WINDOW_HDR_LEN)/TEST_HIT_LEN;
+    if((window(&m,body,0,0,2,0)!=i) ||
+	(unformatLong(&body[2])!=TEST_WINDOW_HITS-i) ||
+	(window(&m,body,1,0,1,1)!=1) || (unformatLong(&body[6])!=1) ||
+	(window(&m,body,1,1,1,TEST_TICKS)!=0) ||
+	(readout(&m,body,DATA_ACC_ENC_RAW)!=i) ||
+	(unformatLong(&body[DATA_ACC_DATA_HDR_LEN+4])!=0)) {
+	errorMsg="hitBufferTest: error in window bounds";
+	return ERROR;
+    }
+
+    /* pulses: one over threshold from 21 to 23, one across */
+    /*	a mask word from 95 to 97, past a low bump */
+    for(i=0;i<ATWD_HI_LEN/2;i++) {
+	hi[i]=HIT_GEN_PEDESTAL;
+    }
+    hi[20]+=10;
+    hi[21]+=60;
+    hi[22]+=100;
+    hi[23]+=60;
+    hi[24]+=10;
+    hi[60]+=20;
+    hi[95]+=40;
+    hi[96]+=80;
+    hi[97]+=40;
+    pulseFeatures_find16(hi,ATWD_HI_LEN/2,30,&f);
+    if((f.baseline!=HIT_GEN_PEDESTAL) || (f.cnt!=2) || (f.found!=2) ||
+	(f.pulse[0].peak!=100) || (f.pulse[0].charge!=220) ||
+	(f.pulse[0].time!=20*PULSE_TIME_SCALE+13) ||
+	(f.pulse[1].peak!=80) || (f.pulse[1].charge!=160) ||
+	(f.pulse[1].time!=95*PULSE_TIME_SCALE)) {
+	errorMsg="hitBufferTest: error in pulse features";
+	return ERROR;
+    }
+    for(i=0;i<ATWD_LO_LEN;i++) {
+	lo[i]=(i%10==5) ? 200 : 0;
+    }
+    pulseFeatures_find8(lo,ATWD_LO_LEN,6,&f);
+    /* two spikes in each baseline stretch: 400/16; half */
+    /*	of 175 is crossed 8/16 of a sample early */
+    if((f.baseline!=25) || (f.cnt!=PULSE_MAX) ||
+	(f.found!=(ATWD_LO_LEN+5)/10) || (f.pulse[PULSE_MAX-1].time!=
+	    (10*(PULSE_MAX-1)+4)*PULSE_TIME_SCALE+8)) {
+	errorMsg="hitBufferTest: error in lo pulse features";
+	return ERROR;
+    }
+
+    /* feature readout: one pulse per waveform, every */
+    /*	TEST_PRESCALE'th hit raw */
+    dataAccess_init();
+    if(setFeatures(&m,body,TEST_PRESCALE)<0) {
+	errorMsg="hitBufferTest: error in DATA_ACC_SET_FEATURES";
+	return ERROR;
+    }
+    for(i=0;i<2*TEST_PRESCALE;i++) {
+	hitGenerator_next(&gen,&sent[i%TEST_PACKED_HITS]);
+	hitBuffer_put(&dataAccHits,&sent[i%TEST_PACKED_HITS]);
+    }
+    if(readout(&m,body,DATA_ACC_ENC_FEATURES)!=2*TEST_PRESCALE) {
+	errorMsg="hitBufferTest: feature readout lost hits";
+	return ERROR;
+    }
+    p=body+DATA_ACC_DATA_HDR_LEN;
+    for(i=1;i<=2*TEST_PRESCALE;i++) {
+	k=(p[0]<<8)|p[1];
+	if((i%TEST_PRESCALE)==0) {
+	    if((k!=TEST_HIT_LEN) || (p[19]!=DATA_ACC_ENC_RAW)) {
+		errorMsg="hitBufferTest: feature readout not prescaled";
+		return ERROR;
+	    }
+	}
+	else if((k!=TEST_FEATURE_HIT_LEN) || (p[19]!=DATA_ACC_ENC_FEATURES) ||
+	    (p[20]!=1) || (p[20+3+8]!=1)) {
+	    errorMsg="hitBufferTest: error in feature readout";
+	    return ERROR;
+	}
+	p+=k;
+    }
+    /* a raw hit that does not fit is still raw at the */
+    /*	front of the next message */
+    for(i=0;i<TEST_FEATURE_HITS;i++) {
+	hitGenerator_next(&gen,&sent[i%TEST_PACKED_HITS]);
+	hitBuffer_put(&dataAccHits,&sent[i%TEST_PACKED_HITS]);
+    }
+    i=1;
+    while(i<=TEST_FEATURE_HITS) {
+	j=readout(&m,body,DATA_ACC_ENC_FEATURES);
+	if((j<=0) || ((i==1) && (j==TEST_FEATURE_HITS))) {
+	    errorMsg="hitBufferTest: error in feature readout overflow";
+	    return ERROR;
+	}
+	p=body+DATA_ACC_DATA_HDR_LEN;
+	for(;j>0;j--,i++) {
+	    if((p[19]==DATA_ACC_ENC_RAW)!=((i%TEST_PRESCALE)==0)) {
+		errorMsg="hitBufferTest: prescale lost across messages";
+		return ERROR;
+	    }
+	    p+=(p[0]<<8)|p[1];
+	}
+    }
+    setFeatures(&m,body,0);
+
+    /* calibration: (sample-pedestal)*gain per sample */
+    calibration_init(&cal);
+    for(i=0;i<CAL_SAMPLES;i++) {
+	calibration_set(&cal,2,CAL_HI,i,40.0f+i%7,0.5f+i/256.0f);
+	calibration_set(&cal,2,CAL_LO,i,10.0f,4.0f);
+	hi[i]=(USHORT)(i*TEST_HI_STEP);
+	lo[i]=(UBYTE)(255-i);
+    }
+    calibration_apply16(&cal,2,hi,CAL_SAMPLES,mv);
+    for(i=0;i<CAL_SAMPLES;i++) {
+	want=(hi[i]-(40.0f+i%7))*(0.5f+i/256.0f);
+	if((mv[i]-want>0.01f) || (want-mv[i]>0.01f)) {
+	    errorMsg="hitBufferTest: error in hi calibration";
+	    return ERROR;
+	}
+    }
+    calibration_apply8(&cal,2,lo,ATWD_LO_LEN,mv);
+    calibration_apply8(&cal,1,lo,ATWD_LO_LEN/2,&mv[ATWD_LO_LEN/2]);
+    if((mv[0]!=(255-10)*4.0f) || (mv[ATWD_LO_LEN/2-1]!=
+	(255-ATWD_LO_LEN/2+1-10)*4.0f) || (mv[ATWD_LO_LEN/2]!=255.0f)) {
+	errorMsg="hitBufferTest: error in lo calibration";
+	return ERROR;
+    }
+    mv[0]=-1.25f;
+    mv[1]=1.25f;
+    mv[2]=5000.0f;
+    mv[3]=-5000.0f;
+    calibration_toFixed(mv,8,16.0f,fixed);
+    if((fixed[0]!=-20) || (fixed[1]!=20) || (fixed[2]!=32767) ||
+	(fixed[3]!=-32767)) {
+	errorMsg="hitBufferTest: error in fixed point calibration";
+	return ERROR;
+    }
+    /* halves go to even and a huge gain is held, the same */
+    /*	with and without SSE2 */
+    for(i=0;i<8;i++) {
+	mv[i]=tieIn[i];
+    }
+    calibration_toFixed(mv,8,1.0f,fixed);
+    for(i=0;i<8;i++) {
+	if(fixed[i]!=tieOut[i]) {
+	    errorMsg="hitBufferTest: fixed point tie not rounded to even";
+	    return ERROR;
+	}
+    }
+    calibration_toFixed(mv,8,1e30f,fixed);
+    for(i=0;i<8;i++) {
+	if(fixed[i]!=((tieIn[i]>0) ? 32767 : (tieIn[i]<0) ? -32767 : 0)) {
+	    errorMsg="hitBufferTest: fixed point not held at a huge gain";
+	    return ERROR;
+	}
+    }
+
+    /* calibrated readout: hi in 1/16 mV, lo as it was */
+    /*	with the tables unset */
+    dataAccess_init();
+    if(setCalibration(&m,body,HIT_GEN_PEDESTAL,0.25f)<0) {
+	errorMsg="hitBufferTest: error in DATA_ACC_SET_CALIBRATION";
+	return ERROR;
+    }
+    body[0]=HIT_ATWD_CNT;
+    Message_setDataLen(&m,DATA_ACC_SET_CALIBRATION_LEN);
+    formatShort(0,&body[4]);
+    if(dataAccess_serve(&m)==SUCCESS) {
+	errorMsg="hitBufferTest: bad calibration taken";
+	return ERROR;
+    }
+    /* refused whole, the tables above stay */
+    if((setCalibration(&m,body,NAN,0.25f)==0) ||
+	(setCalibration(&m,body,HIT_GEN_PEDESTAL,INFINITY)==0)) {
+	errorMsg="hitBufferTest: calibration not finite taken";
+	return ERROR;
+    }
+    hitGenerator_next(&gen,&hit);
+    hitBuffer_put(&dataAccHits,&hit);
+    p=body+DATA_ACC_DATA_HDR_LEN+DATA_ACC_HIT_HDR_LEN;
+    if((readout(&m,body,DATA_ACC_ENC_CALIBRATED)!=1) ||
+	(Message_dataLen(&m)!=DATA_ACC_DATA_HDR_LEN+DATA_ACC_HIT_HDR_LEN+
+	    2*ATWD_LO_LEN+ATWD_HI_LEN) ||
+	(((p[0]<<8)|p[1])!=hit.lo[0][0]*DATA_ACC_CAL_SCALE)) {
+	errorMsg="hitBufferTest: error in calibrated readout";
+	return ERROR;
+    }
+    p+=2*ATWD_LO_LEN;
+    for(i=0;i<ATWD_HI_LEN/2;i++) {
+	k=(short)((p[2*i]<<8)|p[2*i+1]);
+	if(k!=(hit.hi[0][i]-HIT_GEN_PEDESTAL-i%3)*DATA_ACC_CAL_SCALE/4) {
+	    errorMsg="hitBufferTest: error in calibrated hi samples";
+	    return ERROR;
+	}
+    }
+
+    /* pedestals: mean and variance of each sample */
+    pedestal_clear(&peds);
+    for(i=0;i<4;i++) {
+	pedestalHit(&hit,i&1);
+	pedestal_add(&peds,&hit,ATWD0_LO_PRES|ATWD0_HI_PRES);
+    }
+    if((pedestal_mean(&peds,0,PED_HI,pedMean,pedVar)!=4) ||
+	(pedMean[ATWD_HI_LEN/2-1]!=51*PED_SCALE) ||
+	(pedVar[0]!=1*PED_SCALE) ||
+	(pedestal_mean(&peds,0,PED_LO,pedMean,pedVar)!=4) ||
+	(pedMean[0]!=12*PED_SCALE) || (pedVar[ATWD_LO_LEN-1]!=4*PED_SCALE) ||
+	(pedestal_mean(&peds,1,PED_HI,pedMean,0)!=0)) {
+	errorMsg="hitBufferTest: error in pedestal averages";
+	return ERROR;
+    }
+    /* sums past 32 bits: 0x10002 full scale hi samples */
+    pedestal_clear(&peds);
+    for(k=0;k<ATWD_HI_LEN/2;k++) {
+	peds.sum[0][PED_HI][k]=0xffffULL*0x10001;
+	hit.hi[0][k]=0xffff;
+    }
+    pedestal_add(&peds,&hit,ATWD0_HI_PRES);
+    for(k=0;k<ATWD_HI_LEN/2;k++) {
+	if((peds.sum[0][PED_HI][k]!=0xffffULL*0x10002) ||
+	    (peds.sumSq[0][PED_HI][k]!=0xffffULL*0xffff)) {
+	    errorMsg="hitBufferTest: pedestal sum wrapped";
+	    return ERROR;
+	}
+    }
+
+    /* a pedestal run on the worker, watched as it goes */
+    dataAccess_init();
+    Message_init(&m);
+    Message_setType(&m,DATA_ACCESS);
+    Message_setSubtype(&m,DATA_ACC_START_PEDESTAL);
+    Message_setData(&m,body,MAXDATA_VALUE);
+    formatLong(TEST_PED_HITS,body);
+    Message_setDataLen(&m,DATA_ACC_START_PEDESTAL_LEN);
+    if((dataAccess_serve(&m)!=SUCCESS) ||
+	(getPedestal(&m,body,0)!=PED_RUNNING) ||
+	(Message_dataLen(&m)!=DATA_ACC_PEDESTAL_HDR_LEN) ||
+	(unformatLong(&body[5])!=TEST_PED_HITS)) {
+	errorMsg="hitBufferTest: pedestal run not started";
+	return ERROR;
+    }
+    for(i=0;i<TEST_PED_HITS;i++) {
+	pedestalHit(&hit,i&1);
+	hitBuffer_put(&dataAccHits,&hit);
+    }
+    for(i=0;(i<1000) && (getPedestal(&m,body,-1)==PED_RUNNING);i++) {
+	usleep(1000);
+    }
+    if((getPedestal(&m,body,0)!=PED_DONE) ||
+	(unformatLong(&body[1])!=TEST_PED_HITS) ||
+	(Message_dataLen(&m)!=DATA_ACC_PEDESTAL_HDR_LEN+
+	    2*TEST_PED_CHANNEL_LEN) ||
+	(unformatLong(&body[DATA_ACC_PEDESTAL_HDR_LEN])!=TEST_PED_HITS) ||
+	(((body[DATA_ACC_PEDESTAL_HDR_LEN+4]<<8)|
+	    body[DATA_ACC_PEDESTAL_HDR_LEN+5])!=12*PED_SCALE)) {
+	errorMsg="hitBufferTest: error in DATA_ACC_GET_PEDESTAL";
+	return ERROR;
+    }
+    p=body+DATA_ACC_PEDESTAL_HDR_LEN+TEST_PED_CHANNEL_LEN;
+    if((unformatLong(p)!=TEST_PED_HITS) ||
+	(((p[4]<<8)|p[5])!=51*PED_SCALE) ||
+	(((p[4+ATWD_HI_LEN]<<8)|p[5+ATWD_HI_LEN])!=1*PED_SCALE)) {
+	errorMsg="hitBufferTest: error in hi pedestal readout";
+	return ERROR;
+    }
+
+    /* recorded waveforms, divided by 10 on the way in */
+    if((writeWaveforms()<0) ||
+	(waveformFile_open(&file,TEST_FILE)!=TEST_RECORDS)) {
+	errorMsg="hitBufferTest: cannot index waveform file";
+	return ERROR;
+    }
+    hitGenerator_setFile(&file);
+    cfg.pattern=REAL_DATA_DIV10;
+    cfg.present=ATWD0_LO_PRES|ATWD0_HI_PRES|ATWD1_LO_PRES;
+    hitGenerator_init(&gen,&cfg);
+    for(i=0;i<10;i++) {
+	hitGenerator_next(&gen,&hit);
+	if(hit.dom.trig.SPE || (hit.dom.trig.energy<1) ||
+	    (hit.dom.trig.energy>TEST_RECORDS) || !hit.dom.atwd1.lo ||
+	    (hit.lo[1][0]!=HIT_GEN_PEDESTAL/10)) {
+	    errorMsg="hitBufferTest: error in REAL_DATA record";
+	    return ERROR;
+	}
+	for(k=0;k<ATWD_HI_LEN/2;k++) {
+	    if((hit.hi[0][k]!=(k*TEST_HI_STEP)/10) ||
+		(hit.lo[0][k]!=(255-k)/10)) {
+		errorMsg="hitBufferTest: error in REAL_DATA_DIV10";
+		return ERROR;
+	    }
+	}
+    }
+    hitGenerator_setFile(0);
+    waveformFile_close(&file);
+    unlink(TEST_FILE);
+
+    /* filter: odd coinc kept, quality under 5 and MSPE */
+    /*	downgraded */
+    hitFilter_init(&filter);
+    fc.minCoinc=1;
+    fc.minQuality=5;
+    fc.classes=HIT_FILTER_SPE;
+    fc.action[HIT_FILTER_COINC]=HIT_FILTER_DROP;
+    fc.action[HIT_FILTER_QUALITY]=HIT_FILTER_DOWNGRADE;
+    fc.action[HIT_FILTER_CLASS]=HIT_FILTER_DOWNGRADE;
+    hitFilter_set(&filter,&fc);
+    for(i=0;i<HIT_FILTER_BATCH;i++) {
+	fillHit(&batch[i],i);
+	batch[i].dom.trig.coinc=i&1;
+	batch[i].dom.trig.quality=i;
+	batch[i].dom.trig.SPE=(i<HIT_FILTER_BATCH/2);
+    }
+    if((hitFilter_run(&filter,batch,HIT_FILTER_BATCH,verdict)!=8) ||
+	(verdict[0]!=HIT_FILTER_DROP) || (verdict[1]!=HIT_FILTER_DOWNGRADE) ||
+	(verdict[5]!=HIT_FILTER_KEEP) || (verdict[9]!=HIT_FILTER_DOWNGRADE) ||
+	batch[1].dom.atwd0.lo || !batch[5].dom.atwd0.hi ||
+	(filter.kept!=8) || (filter.downgraded!=6) || (filter.dropped!=8) ||
+	(filter.rejected[HIT_FILTER_COINC]!=8) ||
+	(filter.rejected[HIT_FILTER_QUALITY]!=5) ||
+	(filter.accepted[HIT_FILTER_QUALITY]!=11) ||
+	(filter.rejected[HIT_FILTER_CLASS]!=8)) {
+	errorMsg="hitBufferTest: error in hit filter";
+	return ERROR;
+    }
+    hitBuffer_init(&testHits,HIT_OVERWRITE);
+    hitFilter_get(&filter,&fc);
+    if((hitFilter_put(&filter,&testHits,batch,HIT_FILTER_BATCH)!=8) ||
+	(testHits.head!=8) || (fc.minQuality!=5) ||
+	(fc.action[HIT_FILTER_COINC]!=HIT_FILTER_DROP)) {
+	errorMsg="hitBufferTest: error in filtered put";
+	return ERROR;
+    }
+
+    /* generated hits pass the DA filter; SPE only drops */
+    /*	the MSPE share */
+    dataAccess_init();
+    if(setFilter(&m,body,HIT_FILTER_SPE,2)==0) {
+	errorMsg="hitBufferTest: bad filter action taken";
+	return ERROR;
+    }
+    if(setFilter(&m,body,HIT_FILTER_SPE,HIT_FILTER_DROP)<0) {
+	errorMsg="hitBufferTest: error in DATA_ACC_SET_FILTER";
+	return ERROR;
+    }
+    i=runGenerator(&m,body,0);
+    k=filterKept(&m,body,&dropped);
+    if((i<=0) || (k+dropped!=i) || (dropped<i/10) || (k<i/2)) {
+	errorMsg="hitBufferTest: error in generator filtering";
+	return ERROR;
+    }
+    setFilter(&m,body,HIT_FILTER_SPE|HIT_FILTER_MSPE,HIT_FILTER_KEEP);
+
+    /* scaler: 100 tick bins, 10 dead; one hit dead, two */
+    /*	bins empty, then a bin held at SCALER_MAX */
+    scaler_init(&scaler,100,10);
+    scaler_add(&scaler,1000);
+    scaler_add(&scaler,1005);
+    scaler_add(&scaler,1020);
+    scaler_add(&scaler,1040);
+    scaler_add(&scaler,1150);
+    scaler_add(&scaler,1450);
+    scaler_set(&scaler,1000,0);
+    for(i=0;i<20;i++) {
+	scaler_add(&scaler,2000+i);
+    }
+    scaler_add(&scaler,1999);
+    scaler_add(&scaler,3000);
+    if((scaler_read(&scaler,lo,ATWD_LO_LEN,&first,&lost)!=3) ||
+	(lo[0]!=0x31) || (lo[1]!=0x00) || (lo[2]!=0x1f) ||
+	(first!=0) || (lost!=0) || (scaler.dead!=2) ||
+	(scaler.saturated!=1) ||
+	(scaler_read(&scaler,lo,ATWD_LO_LEN,&first,&lost)!=0) ||
+	(first!=6)) {
+	errorMsg="hitBufferTest: error in scaler bins";
+	return ERROR;
+    }
+    /* across the clock wrap */
+    scaler_init(&scaler,100,0);
+    scaler_add(&scaler,0xffffffc0UL);
+    scaler_add(&scaler,0x40);
+    scaler_add(&scaler,200);
+    if((scaler_read(&scaler,lo,ATWD_LO_LEN,&first,&lost)!=1) ||
+	(lo[0]!=0x11)) {
+	errorMsg="hitBufferTest: error in scaler clock wrap";
+	return ERROR;
+    }
+    /* a gap of two rings; a reader a ring behind loses */
+    /*	the byte the producer writes next too */
+    scaler_init(&scaler,1,0);
+    scaler_add(&scaler,0);
+    scaler_add(&scaler,4*SCALER_RING_LEN+1);
+    if((scaler.head!=2*SCALER_RING_LEN) ||
+	(scaler_read(&scaler,lo,ATWD_LO_LEN,&first,&lost)!=ATWD_LO_LEN-1) ||
+	(lost!=SCALER_RING_LEN+1) || (first!=2*SCALER_RING_LEN+2) ||
+	(lo[0]!=0)) {
+	errorMsg="hitBufferTest: error in scaler overflow";
+	return ERROR;
+    }
+
+    /* DA scaler stream, 0.8 ms bins and no dead time */
+    dataAccess_init();
+    Message_init(&m);
+    Message_setType(&m,DATA_ACCESS);
+    Message_setSubtype(&m,DATA_ACC_SET_SCALER);
+    Message_setData(&m,body,MAXDATA_VALUE);
+    formatLong(0,&body[0]);
+    formatLong(0,&body[4]);
+    Message_setDataLen(&m,DATA_ACC_SET_SCALER_LEN);
+    if(dataAccess_serve(&m)==SUCCESS) {
+	errorMsg="hitBufferTest: bad scaler bins taken";
+	return ERROR;
+    }
+    formatLong(HIT_GEN_CLOCK_HZ/1250,&body[0]);
+    Message_setDataLen(&m,DATA_ACC_SET_SCALER_LEN);
+    if(dataAccess_serve(&m)!=SUCCESS) {
+	errorMsg="hitBufferTest: error in DATA_ACC_SET_SCALER";
+	return ERROR;
+    }
+
+    /* histograms: energy linear from 0 in 10s, two */
+    /*	threads, one leaving and coming back */
+    axis.scale=HIST_LINEAR;
+    axis.shift=0;
+    axis.bins=4;
+    axis.lo=0;
+    axis.width=10;
+    histogram_init(&hist,HIST_ENERGY,&axis);
+    part=histogram_join(&hist);
+    other=histogram_join(&hist);
+    batch[0].dom.trig.energy=-5;
+    batch[1].dom.trig.energy=0;
+    batch[2].dom.trig.energy=9;
+    batch[3].dom.trig.energy=10;
+    batch[4].dom.trig.energy=39;
+    batch[5].dom.trig.energy=40;
+    batch[6].dom.trig.energy=15;
+    histogram_add(&hist,part,batch,6);
+    histogram_add(&hist,other,&batch[6],1);
+    histogram_leave(&hist,part);
+    if((histogram_join(&hist)!=part) ||
+	(histogram_sum(&hist,counts)!=4) || (counts[0]!=1) ||
+	(counts[1]!=2) || (counts[2]!=2) || (counts[3]!=0) ||
+	(counts[4]!=1) || (counts[5]!=1)) {
+	errorMsg="hitBufferTest: error in linear histogram";
+	return ERROR;
+    }
+    /* intervals in half octaves from 4 ticks, across */
+    /*	the clock wrap */
+    axis.scale=HIST_LOG;
+    axis.shift=1;
+    axis.bins=6;
+    axis.lo=4;
+    histogram_init(&hist,HIST_INTERVAL,&axis);
+    part=histogram_join(&hist);
+    batch[0].dom.trig.time=100;
+    batch[1].dom.trig.time=104;
+    batch[2].dom.trig.time=110;
+    batch[3].dom.trig.time=118;
+    batch[4].dom.trig.time=130;
+    batch[5].dom.trig.time=131;
+    batch[6].dom.trig.time=100000;
+    batch[7].dom.trig.time=0xfffffffeUL;
+    batch[8].dom.trig.time=2;
+    histogram_add(&hist,part,batch,9);
+    histogram_sum(&hist,counts);
+    if((counts[0]!=1) || (counts[1]!=2) || (counts[2]!=1) ||
+	(counts[3]!=1) || (counts[4]!=1) || (counts[5]!=0) ||
+	(counts[7]!=2)) {
+	errorMsg="hitBufferTest: error in log histogram";
+	return ERROR;
+    }
+    histogram_set(&hist,&axis);
+    histogram_sum(&hist,counts);
+    for(i=0;i<axis.bins+2;i++) {
+	if(counts[i]!=0) {
+	    errorMsg="hitBufferTest: histogram kept after set";
+	    return ERROR;
+	}
+    }
+    /* readout formats */
+    counts[0]=0;
+    counts[1]=3;
+    counts[2]=3;
+    counts[3]=0;
+    counts[4]=200;
+    if((histogram_encode(counts,5,HIST_SPARSE,lo)!=20) ||
+	(unformatShort(lo)!=3) || (unformatShort(&lo[14])!=4) ||
+	(unformatLong(&lo[16])!=200) ||
+	(histogram_encode(counts,5,HIST_DELTA,lo)!=6) ||
+	(lo[1]!=6) || (lo[3]!=5) || (lo[4]!=0x90) || (lo[5]!=3)) {
+	errorMsg="hitBufferTest: error in histogram readout";
+	return ERROR;
+    }
+
+    /* DA energy in 100s from 50, a bad axis refused */
+    axis.lo=0;
+    if(setHistogram(&m,body,HIST_INTERVAL,&axis)==0) {
+	errorMsg="hitBufferTest: bad histogram axis taken";
+	return ERROR;
+    }
+    axis.scale=HIST_LINEAR;
+    axis.bins=8;
+    axis.lo=50;
+    axis.width=100;
+    if(setHistogram(&m,body,HIST_ENERGY,&axis)<0) {
+	errorMsg="hitBufferTest: error in DATA_ACC_SET_HISTOGRAM";
+	return ERROR;
+    }
+
+    /* paced, then as fast as the buffer takes; the rates */
+    /*	themselves are timed by generatorBench */
+    i=runGenerator(&m,body,TEST_RATE);
+    if(i<=0) {
+	errorMsg="hitBufferTest: paced generator made no hits";
+	return ERROR;
+    }
+    /* every hit in a closed bin but the last two */
+    Message_init(&m);
+    Message_setType(&m,DATA_ACCESS);
+    Message_setSubtype(&m,DATA_ACC_GET_SCALERS);
+    Message_setData(&m,body,MAXDATA_VALUE);
+    Message_setDataLen(&m,0);
+    if(dataAccess_serve(&m)!=SUCCESS) {
+	errorMsg="hitBufferTest: error in DATA_ACC_GET_SCALERS";
+	return ERROR;
+    }
+    sum=0;
+    for(k=0;k<unformatShort(&body[12]);k++) {
+	sum+=(body[DATA_ACC_SCALER_HDR_LEN+k]>>4)+
+	    (body[DATA_ACC_SCALER_HDR_LEN+k]&0xf);
+    }
+    if((Message_dataLen(&m)!=DATA_ACC_SCALER_HDR_LEN+k) || (k==0) ||
+	(unformatLong(&body[0])!=0) || (unformatLong(&body[4])!=0) ||
+	(unformatLong(&body[8])!=0) || (sum>i) ||
+	(sum+2*SCALER_MAX<i)) {
+	errorMsg="hitBufferTest: error in scaler stream";
+	return ERROR;
+    }
+    /* and every hit in the histograms, SPE charge in the */
+    /*	first energy bin and 4000 ticks, 11 octaves and */
+    /*	3 quarters, between them all */
+    if((getHistogram(&m,body,HIST_ENERGY,HIST_SPARSE,counts)!=i) ||
+	(counts[1]==0) || (counts[0]!=0) || (counts[9]!=0) ||
+	(getHistogram(&m,body,HIST_INTERVAL,HIST_DELTA,counts)!=i-1) ||
+	(counts[1+11*4+3]!=i-1) ||
+	(getHistogram(&m,body,HIST_ENERGY,HIST_DELTA,counts)!=0) ||
+	(Message_dataLen(&m)!=DATA_ACC_HISTOGRAM_HDR_LEN+8)) {
+	errorMsg="hitBufferTest: error in DA histograms";
+	return ERROR;
+    }
+    if(runGenerator(&m,body,0)<=i) {
+	errorMsg="hitBufferTest: paced generator not slower";
+	return ERROR;
+    }
+
+    errorMsg="hitBufferTest: success";
+    return 0;
+}
+
+char *hitBufferTest_status() {
+    return errorMsg;
+}
@@ -0,0 +1,482 @@
+/* hitGenerator.c */
+
+/* Synthetic hits in the DOMdata.h patterns,
+   see dataAccess/hitGenerator.h */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/hitFilter.h"
+#include "dataAccess/scaler.h"
+#include "dataAccess/histogram.h"
+#include "dataAccess/DAmessageAPIstatus.h"
+#include "dataAccess/waveformFile.h"
+#include "dataAccess/hitGenerator.h"
+
+/* pulse shape: rise at PULSE_START, peak PULSE_TAU later */
+#define PULSE_START 10
+#define PULSE_TAU 6.0
+/* peak of one photoelectron per channel */
+#define LO_PE_PEAK 12
+#define HI_PE_PEAK 120
+#define CLK_HALF_CYCLE 5
+#define SAWTOOTH_LEN 32
+/* sleep once the thread is this far ahead of its rate */
+#define PACE_AHEAD_NSEC 1000000
+/* x/10 is (x*DIV10_MUL)>>DIV10_SHIFT for any 16 bit x */
+#define DIV10_MUL 0xcccd
+#define DIV10_SHIFT 19
+
+HIT_GEN hitGen;
+WAVEFORM_FILE *genFile=0;
+HIT_BUFFER *genBuffer;
+HIT_FILTER *genFilter;
+SCALER *genScaler;
+HISTOGRAM *genHists;
+int genHistCnt;
+pthread_t genThreadID;
+volatile int genRunning=FALSE;
+volatile ULONG genCount=0;
+
+static unsigned int nextRandom(HIT_GEN *g) {
+	/* xorshift32 */
+	g->rng^=g->rng<<13;
+	g->rng^=g->rng>>17;
+	g->rng^=g->rng<<5;
+	return g->rng;
+}
+
+/* uniform in (0,1] */
+static double uniform(HIT_GEN *g) {
+	return ((double)nextRandom(g)+1.0)/4294967296.0;
+}
+
+int hitGenerator_init(HIT_GEN *g, HIT_GEN_CONFIG *cfg) {
+	double x;
+	double shape;
+	int div=1;
+	int ped=HIT_GEN_PEDESTAL;
+	int i;
+
+	memset(g,0,sizeof(HIT_GEN));
+	g->cfg=*cfg;
+	g->rng=(cfg->seed!=0) ? (unsigned int)cfg->seed : 1;
+
+	switch(cfg->pattern) {
+	    case ZERO:
+		break;
+	    case RAW_CNT:
+		for(i=0;i<ATWD_LO_LEN;i++) {
+		    g->lo[i]=(UBYTE)i;
+		}
+		for(i=0;i<ATWD_HI_LEN;i++) {
+		    ((UBYTE *)g->hi)[i]=(UBYTE)i;
+		}
+		break;
+	    case FMT_CNT:
+		for(i=0;i<ATWD_LO_LEN;i++) {
+		    g->lo[i]=(UBYTE)i;
+		}
+		for(i=0;i<ATWD_HI_LEN/2;i++) {
+		    g->hi[i]=(USHORT)i;
+		}
+		break;
+	    case CLK_32MHTZ:
+		for(i=0;i<ATWD_LO_LEN;i++) {
+		    g->lo[i]=((i/CLK_HALF_CYCLE)&1) ? 0xff : 0;
+		}
+		for(i=0;i<ATWD_HI_LEN/2;i++) {
+		    g->hi[i]=((i/CLK_HALF_CYCLE)&1) ? HIT_GEN_HI_MAX : 0;
+		}
+		break;
+	    case REAL_DATA_DIV10:
+		div=10;
+		/* fall through */
+	    case REAL_DATA:
+		if((genFile!=0) && (genFile->cnt>0)) {
+		    g->file=genFile;
+		}
+		g->div10=(div==10);
+		/* fall through, the pattern fills what a
+		   record does not have */
+	    case ATWD_TEST_DATA:
+		if(cfg->pattern==ATWD_TEST_DATA) {
+		    ped=0;
+		}
+		for(i=0;i<ATWD_LO_LEN;i++) {
+		    g->lo[i]=(UBYTE)(ped/div);
+		}
+		for(i=0;i<ATWD_HI_LEN/2;i++) {
+		    g->hi[i]=(USHORT)(ped/div);
+		}
+		for(i=PULSE_START;i<ATWD_HI_LEN/2;i++) {
+		    x=(i-PULSE_START)/PULSE_TAU;
+		    shape=x*exp(1.0-x);
+		    if(i<ATWD_LO_LEN) {
+			g->loPulse[i]=(USHORT)(LO_PE_PEAK*shape/div+0.5);
+		    }
+		    g->hiPulse[i]=(USHORT)(HI_PE_PEAK*shape/div+0.5);
+		}
+		g->pulsed=TRUE;
+		break;
+	    case SLOWADC_TEST_DATA:
+	    case COMADC_TEST_DATA:
+		for(i=0;i<ATWD_LO_LEN;i++) {
+		    g->lo[i]=(UBYTE)((i%SAWTOOTH_LEN)*8);
+		}
+		for(i=0;i<ATWD_HI_LEN/2;i++) {
+		    g->hi[i]=(USHORT)((i%SAWTOOTH_LEN)*32);
+		}
+		break;
+	    default:
+		return -1;
+	}
+	return 0;
+}
+
+/* out=base+npe*pulse, lo saturating at 8 bits */
+static void fillLo(UBYTE *out, const UBYTE *base,
+	const USHORT *pulse, int npe) {
+#ifdef __SSE2__
+	__m128i zero=_mm_setzero_si128();
+	__m128i n=_mm_set1_epi16((short)npe);
+	__m128i b;
+	__m128i lo;
+	__m128i hi;
+	int i;
+
+	for(i=0;i<ATWD_LO_LEN;i+=16) {
+	    b=_mm_loadu_si128((const __m128i *)&base[i]);
+	    lo=_mm_add_epi16(_mm_unpacklo_epi8(b,zero),_mm_mullo_epi16(
+		_mm_loadu_si128((const __m128i *)&pulse[i]),n));
+	    hi=_mm_add_epi16(_mm_unpackhi_epi8(b,zero),_mm_mullo_epi16(
+		_mm_loadu_si128((const __m128i *)&pulse[i+8]),n));
+	    _mm_storeu_si128((__m128i *)&out[i],_mm_packus_epi16(lo,hi));
+	}
+#else
+	int v;
+	int i;
+
+	for(i=0;i<ATWD_LO_LEN;i++) {
+	    v=base[i]+npe*pulse[i];
+	    out[i]=(UBYTE)((v>0xff) ? 0xff : v);
+	}
+#endif
+}
+
+/* out=base+npe*pulse, hi saturating at 16 bits */
+static void fillHi(USHORT *out, const USHORT *base,
+	const USHORT *pulse, int npe) {
+#ifdef __SSE2__
+	__m128i n=_mm_set1_epi16((short)npe);
+	__m128i v;
+	int i;
+
+	for(i=0;i<ATWD_HI_LEN/2;i+=8) {
+	    v=_mm_adds_epu16(_mm_loadu_si128((const __m128i *)&base[i]),
+		_mm_mullo_epi16(_mm_loadu_si128((const __m128i *)&pulse[i]),n));
+	    _mm_storeu_si128((__m128i *)&out[i],v);
+	}
+#else
+	int v;
+	int i;
+
+	for(i=0;i<ATWD_HI_LEN/2;i++) {
+	    v=base[i]+npe*pulse[i];
+	    out[i]=(USHORT)((v>0xffff) ? 0xffff : v);
+	}
+#endif
+}
+
+void hitGenerator_setFile(WAVEFORM_FILE *f) {
+	genFile=f;
+}
+
+/* 8 bit samples of a record, divided by 10 if asked */
+static void loadLo(UBYTE *out, const UBYTE *in, int div10) {
+#ifdef __SSE2__
+	__m128i zero=_mm_setzero_si128();
+	__m128i mul=_mm_set1_epi16((short)DIV10_MUL);
+	__m128i b;
+	__m128i lo;
+	__m128i hi;
+	int i;
+
+	if(!div10) {
+	    memcpy(out,in,ATWD_LO_LEN);
+	    return;
+	}
+	for(i=0;i<ATWD_LO_LEN;i+=16) {
+	    b=_mm_loadu_si128((const __m128i *)&in[i]);
+	    lo=_mm_srli_epi16(_mm_mulhi_epu16(_mm_unpacklo_epi8(b,zero),mul),
+		DIV10_SHIFT-16);
+	    hi=_mm_srli_epi16(_mm_mulhi_epu16(_mm_unpackhi_epi8(b,zero),mul),
+		DIV10_SHIFT-16);
+	    _mm_storeu_si128((__m128i *)&out[i],_mm_packus_epi16(lo,hi));
+	}
+#else
+	int i;
+
+	if(!div10) {
+	    memcpy(out,in,ATWD_LO_LEN);
+	    return;
+	}
+	for(i=0;i<ATWD_LO_LEN;i++) {
+	    out[i]=(UBYTE)((in[i]*DIV10_MUL)>>DIV10_SHIFT);
+	}
+#endif
+}
+
+/* big endian 16 bit samples of a record, divided by 10
+   if asked */
+static void loadHi(USHORT *out, const UBYTE *in, int div10) {
+#ifdef __SSE2__
+	__m128i mul=_mm_set1_epi16((short)DIV10_MUL);
+	__m128i v;
+	int i;
+
+	for(i=0;i<ATWD_HI_LEN/2;i+=8) {
+	    v=_mm_loadu_si128((const __m128i *)&in[2*i]);
+	    v=_mm_or_si128(_mm_slli_epi16(v,8),_mm_srli_epi16(v,8));
+	    if(div10) {
+		v=_mm_srli_epi16(_mm_mulhi_epu16(v,mul),DIV10_SHIFT-16);
+	    }
+	    _mm_storeu_si128((__m128i *)&out[i],v);
+	}
+#else
+	ULONG v;
+	int i;
+
+	for(i=0;i<ATWD_HI_LEN/2;i++) {
+	    v=((ULONG)in[2*i]<<8)|in[2*i+1];
+	    out[i]=(USHORT)(div10 ? (v*DIV10_MUL)>>DIV10_SHIFT : v);
+	}
+#endif
+}
+
+/* waveforms, charge and SPE flag from a random record;
+   channels the record lacks keep the pattern */
+static void fillFromFile(HIT_GEN *g, HIT_RECORD *h, ATWD_DESC **atwd) {
+	UBYTE *rec=waveformFile_record(g->file,nextRandom(g)%g->file->cnt);
+	UBYTE *in=rec+DATA_ACC_HIT_HDR_LEN;
+	UBYTE present=rec[2];
+	UBYTE lo;
+	UBYTE hi;
+	int i;
+
+	h->dom.trig.energy=(int)(((ULONG)rec[12]<<24)|((ULONG)rec[13]<<16)|
+	    ((ULONG)rec[14]<<8)|rec[15]);
+	h->dom.trig.SPE=(rec[3]==SPE_MASK);
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    lo=ATWD0_LO_PRES<<(2*i);
+	    hi=ATWD0_HI_PRES<<(2*i);
+	    if(g->cfg.present&lo) {
+		atwd[i]->lo=TRUE;
+		if(present&lo) {
+		    loadLo(h->lo[i],in,g->div10);
+		}
+		else {
+		    memcpy(h->lo[i],g->lo,ATWD_LO_LEN);
+		}
+	    }
+	    if(present&lo) {
+		in+=ATWD_LO_LEN;
+	    }
+	    if(g->cfg.present&hi) {
+		atwd[i]->hi=TRUE;
+		if(present&hi) {
+		    loadHi(h->hi[i],in,g->div10);
+		}
+		else {
+		    memcpy(h->hi[i],g->hi,ATWD_HI_LEN);
+		}
+	    }
+	    if(present&hi) {
+		in+=ATWD_HI_LEN;
+	    }
+	}
+}
+
+ULONG hitGenerator_next(HIT_GEN *g, HIT_RECORD *h) {
+	ATWD_DESC *atwd[HIT_ATWD_CNT];
+	ULONG ticks;
+	int mspe;
+	int npe=1;
+	int i;
+
+	if(g->cfg.rateHz==0) {
+	    ticks=1;
+	}
+	else if(g->cfg.poisson) {
+	    ticks=(ULONG)(-log(uniform(g))*HIT_GEN_CLOCK_HZ/g->cfg.rateHz)+1;
+	}
+	else {
+	    ticks=HIT_GEN_CLOCK_HZ/g->cfg.rateHz;
+	}
+	g->time+=ticks;
+
+	mspe=(int)(nextRandom(g)%100)<g->cfg.mspePercent;
+	if(mspe) {
+	    npe=2+(int)(nextRandom(g)%(HIT_GEN_MAX_PE-1));
+	}
+
+	memset(&h->dom,0,sizeof(DOM_DATA));
+	h->dom.trig.time=g->time;
+	h->dom.trig.energy=npe*HIT_GEN_SPE_CHARGE;
+	h->dom.trig.SPE=!mspe;
+	atwd[0]=&h->dom.atwd0;
+	atwd[1]=&h->dom.atwd1;
+	atwd[2]=&h->dom.atwd2;
+	atwd[3]=&h->dom.atwd3;
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    atwd[i]->contents=(BYTE)g->cfg.pattern;
+	}
+	if(g->file!=0) {
+	    fillFromFile(g,h,atwd);
+	    return ticks;
+	}
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(g->cfg.present&(ATWD0_LO_PRES<<(2*i))) {
+		atwd[i]->lo=TRUE;
+		if(g->pulsed) {
+		    fillLo(h->lo[i],g->lo,g->loPulse,npe);
+		}
+		else {
+		    memcpy(h->lo[i],g->lo,ATWD_LO_LEN);
+		}
+	    }
+	    if(g->cfg.present&(ATWD0_HI_PRES<<(2*i))) {
+		atwd[i]->hi=TRUE;
+		if(g->pulsed) {
+		    fillHi(h->hi[i],g->hi,g->hiPulse,npe);
+		}
+		else {
+		    memcpy(h->hi[i],g->hi,ATWD_HI_LEN);
+		}
+	    }
+	}
+	return ticks;
+}
+
+static long long monotonicNsec(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (long long)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+/* the n hits at h into this thread's partials */
+static void histogramHits(HIST_PART **part, HIT_RECORD *h, int n) {
+	int i;
+
+	for(i=0;i<genHistCnt;i++) {
+	    if(part[i]!=0) {
+		histogram_add(&genHists[i],part[i],h,n);
+	    }
+	}
+}
+
+static void *generatorThread(void *arg) {
+	/* hits the buffer refuses are made here, and a
+	   batch for the filter */
+	static HIT_RECORD spare;
+	static HIT_RECORD batch[HIT_FILTER_BATCH];
+	HIST_PART *part[HIST_QUANTITIES];
+	struct timespec ts;
+	HIT_RECORD *h;
+	long long due=monotonicNsec();
+	long long ahead;
+	ULONG ticks;
+	int n;
+	int i;
+
+	for(i=0;i<genHistCnt;i++) {
+	    part[i]=histogram_join(&genHists[i]);
+	}
+	while(genRunning) {
+	    if(genFilter!=0) {
+		/* paced hits go one at a time, not to wait */
+		n=(hitGen.cfg.rateHz==0) ? HIT_FILTER_BATCH : 1;
+		ticks=0;
+		for(i=0;i<n;i++) {
+		    ticks+=hitGenerator_next(&hitGen,&batch[i]);
+		    if(genScaler!=0) {
+			scaler_add(genScaler,batch[i].dom.trig.time);
+		    }
+		}
+		histogramHits(part,batch,n);
+		hitFilter_put(genFilter,genBuffer,batch,n);
+		genCount+=n;
+	    }
+	    else {
+		h=hitBuffer_claim(genBuffer);
+		if(h==0) {
+		    h=&spare;
+		}
+		ticks=hitGenerator_next(&hitGen,h);
+		if(genScaler!=0) {
+		    scaler_add(genScaler,h->dom.trig.time);
+		}
+		histogramHits(part,h,1);
+		if(h!=&spare) {
+		    hitBuffer_publish(genBuffer);
+		}
+		genCount++;
+	    }
+	    if(hitGen.cfg.rateHz==0) {
+		continue;
+	    }
+	    due+=(long long)ticks*(1000000000/HIT_GEN_CLOCK_HZ);
+	    ahead=due-monotonicNsec();
+	    if(ahead>PACE_AHEAD_NSEC) {
+		ts.tv_sec=ahead/1000000000;
+		ts.tv_nsec=ahead%1000000000;
+		nanosleep(&ts,0);
+	    }
+	}
+	for(i=0;i<genHistCnt;i++) {
+	    if(part[i]!=0) {
+		histogram_leave(&genHists[i],part[i]);
+	    }
+	}
+	return 0;
+}
+
+int hitGenerator_start(HIT_BUFFER *b, HIT_FILTER *f, SCALER *s,
+	HISTOGRAM *h, int histograms, HIT_GEN_CONFIG *cfg) {
+	if(genRunning || (hitGenerator_init(&hitGen,cfg)<0)) {
+	    return -1;
+	}
+	genBuffer=b;
+	genFilter=f;
+	genScaler=s;
+	genHists=h;
+	genHistCnt=histograms;
+	genCount=0;
+	genRunning=TRUE;
+	if(pthread_create(&genThreadID,NULL,generatorThread,0)!=0) {
+	    genRunning=FALSE;
+	    return -1;
+	}
+	return 0;
+}
+
+void hitGenerator_stop(void) {
+	if(!genRunning) {
+	    return;
+	}
+	genRunning=FALSE;
+	pthread_join(genThreadID,NULL);
+}
+
+ULONG hitGenerator_count(void) {
+	return genCount;
+}
@@ -0,0 +1,201 @@
+/* pedestal.c */
+
+/* Pedestal averaging on a worker thread,
+   see dataAccess/pedestal.h */
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/pedestal.h"
+
+/* wait between looks at an empty buffer */
+#define IDLE_NSEC 1000000
+
+PED_SUMS pedSums;
+HIT_BUFFER *pedBuffer;
+HIT_READER pedReader;
+pthread_t pedThreadID;
+volatile int pedState=PED_IDLE;
+volatile int pedRunning=FALSE;
+volatile ULONG pedDone=0;
+ULONG pedTarget=0;
+
+void pedestal_clear(PED_SUMS *s) {
+	memset(s,0,sizeof(PED_SUMS));
+}
+
+#ifdef __SSE2__
+/* to[0..3]+=the 4 32 bit lanes of x, widened */
+static void add32to64(unsigned long long *to, __m128i x) {
+	__m128i zero=_mm_setzero_si128();
+
+	_mm_storeu_si128((__m128i *)&to[0],_mm_add_epi64(
+	    _mm_loadu_si128((__m128i *)&to[0]),_mm_unpacklo_epi32(x,zero)));
+	_mm_storeu_si128((__m128i *)&to[2],_mm_add_epi64(
+	    _mm_loadu_si128((__m128i *)&to[2]),_mm_unpackhi_epi32(x,zero)));
+}
+#endif
+
+/* sum+=v, sumSq+=v*v over n samples, v widened first */
+static void add16(const USHORT *v, int n, unsigned long long *sum,
+	unsigned long long *sumSq) {
+	int i;
+#ifdef __SSE2__
+	__m128i zero=_mm_setzero_si128();
+	__m128i x;
+	__m128i lo;
+	__m128i hi;
+
+	for(i=0;i<n;i+=8) {
+	    x=_mm_loadu_si128((const __m128i *)&v[i]);
+	    add32to64(&sum[i],_mm_unpacklo_epi16(x,zero));
+	    add32to64(&sum[i+4],_mm_unpackhi_epi16(x,zero));
+	    /* 32 bit squares from their low and high halves */
+	    lo=_mm_mullo_epi16(x,x);
+	    hi=_mm_mulhi_epu16(x,x);
+	    add32to64(&sumSq[i],_mm_unpacklo_epi16(lo,hi));
+	    add32to64(&sumSq[i+4],_mm_unpackhi_epi16(lo,hi));
+	}
+#else
+	for(i=0;i<n;i++) {
+	    sum[i]+=v[i];
+	    sumSq[i]+=(unsigned int)v[i]*v[i];
+	}
+#endif
+}
+
+void pedestal_add(PED_SUMS *s, HIT_RECORD *h, UBYTE present) {
+	USHORT wide[ATWD_LO_LEN];
+	int a;
+	int i;
+
+	for(a=0;a<HIT_ATWD_CNT;a++) {
+	    if(present&(ATWD0_LO_PRES<<(2*a))) {
+		for(i=0;i<ATWD_LO_LEN;i++) {
+		    wide[i]=h->lo[a][i];
+		}
+		add16(wide,ATWD_LO_LEN,s->sum[a][PED_LO],s->sumSq[a][PED_LO]);
+		s->n[a][PED_LO]++;
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*a))) {
+		add16(h->hi[a],ATWD_HI_LEN/2,s->sum[a][PED_HI],
+		    s->sumSq[a][PED_HI]);
+		s->n[a][PED_HI]++;
+	    }
+	}
+}
+
+static USHORT held(double x) {
+	return (x>=65535.0) ? 65535 : (USHORT)(x+0.5);
+}
+
+ULONG pedestal_mean(PED_SUMS *s, int atwd, int channel, USHORT *mean,
+	USHORT *variance) {
+	ULONG n=s->n[atwd][channel];
+	int len=(channel==PED_LO) ? ATWD_LO_LEN : ATWD_HI_LEN/2;
+	double m;
+	double v;
+	int i;
+
+	for(i=0;i<len;i++) {
+	    m=(n==0) ? 0.0 : (double)s->sum[atwd][channel][i]/n;
+	    mean[i]=held(m*PED_SCALE);
+	    if(variance!=0) {
+		v=(n==0) ? 0.0 :
+		    (double)s->sumSq[atwd][channel][i]/n-m*m;
+		variance[i]=held(((v<0.0) ? 0.0 : v)*PED_SCALE);
+	    }
+	}
+	return n;
+}
+
+/* present bits of h, as the hit buffer keeps them */
+static UBYTE presentOf(HIT_RECORD *h) {
+	ATWD_DESC *atwd[HIT_ATWD_CNT];
+	UBYTE bits=0;
+	int i;
+
+	atwd[0]=&h->dom.atwd0;
+	atwd[1]=&h->dom.atwd1;
+	atwd[2]=&h->dom.atwd2;
+	atwd[3]=&h->dom.atwd3;
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(atwd[i]->lo) {
+		bits|=ATWD0_LO_PRES<<(2*i);
+	    }
+	    if(atwd[i]->hi) {
+		bits|=ATWD0_HI_PRES<<(2*i);
+	    }
+	}
+	return bits;
+}
+
+static void *pedestalThread(void *arg) {
+	/* one run at a time uses it */
+	static HIT_RECORD hit;
+	struct timespec idle;
+
+	idle.tv_sec=0;
+	idle.tv_nsec=IDLE_NSEC;
+	while(pedRunning && (pedDone<pedTarget)) {
+	    if(!hitBuffer_peek(pedBuffer,&pedReader,&hit)) {
+		nanosleep(&idle,0);
+		continue;
+	    }
+	    hitBuffer_next(&pedReader);
+	    pedestal_add(&pedSums,&hit,presentOf(&hit));
+	    pedDone++;
+	}
+	hitBuffer_removeReader(pedBuffer,&pedReader);
+	pedState=PED_DONE;
+	return 0;
+}
+
+int pedestal_start(HIT_BUFFER *b, ULONG hits) {
+	if(pedState==PED_RUNNING) {
+	    return -1;
+	}
+	/* the last run's thread, if it ended by itself */
+	pedestal_stop();
+	pedestal_clear(&pedSums);
+	pedBuffer=b;
+	pedDone=0;
+	pedTarget=hits;
+	/* only hits from now on */
+	if(hitBuffer_addReader(b,&pedReader,HIT_FROM_NEW)<0) {
+	    return -1;
+	}
+	pedState=PED_RUNNING;
+	pedRunning=TRUE;
+	if(pthread_create(&pedThreadID,NULL,pedestalThread,0)!=0) {
+	    hitBuffer_removeReader(b,&pedReader);
+	    pedRunning=FALSE;
+	    pedState=PED_IDLE;
+	    return -1;
+	}
+	return 0;
+}
+
+void pedestal_stop(void) {
+	if(!pedRunning) {
+	    return;
+	}
+	pedRunning=FALSE;
+	pthread_join(pedThreadID,NULL);
+}
+
+int pedestal_state(ULONG *done, ULONG *target) {
+	*done=pedDone;
+	*target=pedTarget;
+	return pedState;
+}
+
+PED_SUMS *pedestal_sums(void) {
+	return &pedSums;
+}
@@ -0,0 +1,14 @@
+/* runHitBufferTest.c */
+
+#include "dataAccess/hitBufferTest.h"
+	
+
+int main() {
+
+    int i;
+
+    i=hitBufferTest();
+
+    printf("runHitBufferTest: return status= %s\n",
+	hitBufferTest_status());
+}
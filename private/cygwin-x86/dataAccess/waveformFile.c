@@ -0,0 +1,92 @@
+/* waveformFile.c */
+
+/* Memory mapped recorded waveforms,
+   see dataAccess/waveformFile.h */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/DAmessageAPIstatus.h"
+#include "dataAccess/waveformFile.h"
+
+/* record length its waveform bits call for */
+static ULONG recordLen(UBYTE present) {
+	ULONG len=DATA_ACC_HIT_HDR_LEN;
+	int i;
+
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(present&(ATWD0_LO_PRES<<(2*i))) {
+		len+=ATWD_LO_LEN;
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*i))) {
+		len+=ATWD_HI_LEN;
+	    }
+	}
+	return len;
+}
+
+long waveformFile_open(WAVEFORM_FILE *f, const char *path) {
+	struct stat st;
+	ULONG pos=0;
+	ULONG len;
+	ULONG max;
+	int fd;
+
+	f->map=0;
+	f->offset=0;
+	f->cnt=0;
+	fd=open(path,O_RDONLY);
+	if(fd<0) {
+	    return -1;
+	}
+	if((fstat(fd,&st)<0) || (st.st_size<DATA_ACC_HIT_HDR_LEN)) {
+	    close(fd);
+	    return -1;
+	}
+	f->size=(ULONG)st.st_size;
+	f->map=(UBYTE *)mmap(0,f->size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(f->map==(UBYTE *)MAP_FAILED) {
+	    f->map=0;
+	    return -1;
+	}
+
+	/* room for the smallest records, trimmed below */
+	max=f->size/DATA_ACC_HIT_HDR_LEN;
+	f->offset=(ULONG *)malloc(max*sizeof(ULONG));
+	if(f->offset==0) {
+	    waveformFile_close(f);
+	    return -1;
+	}
+	while(pos+DATA_ACC_HIT_HDR_LEN<=f->size) {
+	    len=((ULONG)f->map[pos]<<8)|f->map[pos+1];
+	    if((len!=recordLen(f->map[pos+2])) || (pos+len>f->size)) {
+		break;
+	    }
+	    f->offset[f->cnt++]=pos;
+	    pos+=len;
+	}
+	if(f->cnt==0) {
+	    waveformFile_close(f);
+	    return -1;
+	}
+	f->offset=(ULONG *)realloc(f->offset,f->cnt*sizeof(ULONG));
+	/* records are picked at random */
+	madvise(f->map,f->size,MADV_RANDOM);
+	return (long)f->cnt;
+}
+
+void waveformFile_close(WAVEFORM_FILE *f) {
+	if(f->map!=0) {
+	    munmap(f->map,f->size);
+	}
+	free(f->offset);
+	f->map=0;
+	f->offset=0;
+	f->cnt=0;
+}
@@ -0,0 +1,164 @@
+/* domLog.c */
+
+/* Per-thread binary log rings and their drainer,
+   see domLog.h */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "domapp_common/DOMtypes.h"
+#include "domLog/domLog.h"
+
+#define DOMLOG_RING_MASK (DOMLOG_RING_LEN-1)
+#define DOMLOG_DRAIN_MSEC 10
+/* myRing before a thread's first record, and after the
+   ring table ran out */
+#define RING_UNSET (-1)
+#define RING_NONE (-2)
+
+typedef struct {
+    DOMLOG_SITE *site;
+    ULONG sec;
+    ULONG usec;
+    int suppressed;
+    long arg[DOMLOG_MAX_ARGS];
+} DOMLOG_RECORD;
+
+/* written by one thread, read by the drainer */
+typedef struct {
+    DOMLOG_RECORD rec[DOMLOG_RING_LEN];
+    volatile ULONG head;
+    volatile ULONG tail;
+} __attribute__((aligned(64))) DOMLOG_RING;
+
+DOMLOG_RING logRings[DOMLOG_MAX_THREADS];
+int logRingCnt=0;
+__thread int myRing=RING_UNSET;
+ULONG logDropped=0;
+
+FILE *logOut=0;
+pthread_mutex_t logDrainMutex=PTHREAD_MUTEX_INITIALIZER;
+pthread_t logDrainID;
+
+static const char *levelName[]={"ERROR","WARN","INFO","DEBUG"};
+
+void domLog_put(DOMLOG_SITE *site, long a0, long a1,
+    long a2, long a3)
+{
+    struct timespec ts;
+    DOMLOG_RING *r;
+    DOMLOG_RECORD *rec;
+    ULONG head;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+
+    /* rate limit per call site, one second windows.  The
+       window reset may race, which only shifts a count. */
+    if(site->windowSec!=(ULONG)ts.tv_sec) {
+	site->windowSec=(ULONG)ts.tv_sec;
+	site->windowCnt=0;
+    }
+    if(__sync_add_and_fetch(&site->windowCnt,1)>DOMLOG_SITE_RATE) {
+	__sync_fetch_and_add(&site->suppressed,1);
+	return;
+    }
+
+    if(myRing==RING_UNSET) {
+	myRing=__sync_fetch_and_add(&logRingCnt,1);
+	if(myRing>=DOMLOG_MAX_THREADS) {
+	    myRing=RING_NONE;
+	}
+    }
+    if(myRing==RING_NONE) {
+	__sync_fetch_and_add(&logDropped,1);
+	return;
+    }
+
+    r=&logRings[myRing];
+    head=r->head;
+    if((head-r->tail)>=DOMLOG_RING_LEN) {
+	/* never wait for the drainer */
+	__sync_fetch_and_add(&logDropped,1);
+	return;
+    }
+    rec=&r->rec[head&DOMLOG_RING_MASK];
+    rec->site=site;
+    rec->sec=(ULONG)ts.tv_sec;
+    rec->usec=(ULONG)(ts.tv_nsec/1000);
+    rec->suppressed=__sync_fetch_and_and(&site->suppressed,0);
+    rec->arg[0]=a0;
+    rec->arg[1]=a1;
+    rec->arg[2]=a2;
+    rec->arg[3]=a3;
+    __sync_synchronize();
+    r->head=head+1;
+}
+
+void domLog_setOutput(FILE *out)
+{
+    logOut=out;
+}
+
+static void writeRecord(FILE *out, DOMLOG_RECORD *rec)
+{
+    DOMLOG_SITE *site=rec->site;
+
+    fprintf(out,"[%lu.%06lu] %s ",rec->sec,rec->usec,
+	levelName[site->level]);
+    fprintf(out,site->fmt,rec->arg[0],rec->arg[1],
+	rec->arg[2],rec->arg[3]);
+    if(rec->suppressed>0) {
+	fprintf(out," (%d more suppressed)",rec->suppressed);
+    }
+    fputc('\n',out);
+}
+
+void domLog_flush(void)
+{
+    FILE *out=(logOut!=0) ? logOut : stderr;
+    DOMLOG_RING *r;
+    DOMLOG_RECORD rec;
+    int cnt;
+    int i;
+
+    pthread_mutex_lock(&logDrainMutex);
+    cnt=logRingCnt;
+    if(cnt>DOMLOG_MAX_THREADS) {
+	cnt=DOMLOG_MAX_THREADS;
+    }
+    for(i=0;i<cnt;i++) {
+	r=&logRings[i];
+	while(r->tail!=r->head) {
+	    __sync_synchronize();
+	    rec=r->rec[r->tail&DOMLOG_RING_MASK];
+	    __sync_synchronize();
+	    r->tail++;
+	    writeRecord(out,&rec);
+	}
+    }
+    fflush(out);
+    pthread_mutex_unlock(&logDrainMutex);
+}
+
+ULONG domLog_dropped(void)
+{
+    return logDropped;
+}
+
+static void *logDrainer(void *arg)
+{
+    for(;;) {
+	domLog_flush();
+	usleep(DOMLOG_DRAIN_MSEC*1000);
+    }
+    return 0;
+}
+
+int domLog_start(void)
+{
+    if(pthread_create(&logDrainID,NULL,logDrainer,0)!=0) {
+	return -1;
+    }
+    return 0;
+}
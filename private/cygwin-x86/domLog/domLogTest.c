@@ -0,0 +1,90 @@
+/* domLogTest.c */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "domapp_common/DOMtypes.h"
+#include "domLog/domLog.h"
+#include "domLog/domLogTest.h"
+
+#define ERROR -1
+#define TEST_THREADS 4
+#define TEST_RECORDS 20
+#define TEST_BURST (DOMLOG_SITE_RATE+50)
+
+/* storage */
+char *errorMsg;
+
+/* all threads share one call site, stay under its rate */
+static void *logThread(void *arg) {
+    int i;
+
+    for(i=0;i<TEST_RECORDS;i++) {
+	DOMLOG2(DOMLOG_INFO,"thread %ld record %ld",(long)arg,i);
+    }
+    return 0;
+}
+
+/* lines written to out since the start */
+static int countLines(FILE *out) {
+    char line[128];
+    int cnt=0;
+
+    rewind(out);
+    while(fgets(line,sizeof(line),out)!=0) {
+	cnt++;
+    }
+    return cnt;
+}
+
+/* test entry point */
+int domLogTest() {
+    pthread_t ids[TEST_THREADS];
+    FILE *out=tmpfile();
+    int i;
+
+    if(out==0) {
+	errorMsg="domLogTest: cannot open output";
+	return ERROR;
+    }
+    domLog_setOutput(out);
+
+    /* compiled out above DOMLOG_LEVEL */
+    DOMLOG(DOMLOG_LEVEL+1,"never");
+
+    for(i=0;i<TEST_THREADS;i++) {
+	if(pthread_create(&ids[i],NULL,logThread,(void *)(long)i)!=0) {
+	    errorMsg="domLogTest: cannot start threads";
+	    return ERROR;
+	}
+    }
+    for(i=0;i<TEST_THREADS;i++) {
+	pthread_join(ids[i],NULL);
+    }
+    domLog_flush();
+    if(countLines(out)!=TEST_THREADS*TEST_RECORDS) {
+	errorMsg="domLogTest: records lost";
+	return ERROR;
+    }
+
+    /* one call site is held to DOMLOG_SITE_RATE a second */
+    for(i=0;i<TEST_BURST;i++) {
+	DOMLOG1(DOMLOG_WARN,"burst %ld",i);
+	if((i%64)==0) {
+	    domLog_flush();
+	}
+    }
+    domLog_flush();
+    i=countLines(out)-TEST_THREADS*TEST_RECORDS;
+    if((i<1) || (i>DOMLOG_SITE_RATE) || (domLog_dropped()!=0)) {
+	errorMsg="domLogTest: rate limit not applied";
+	return ERROR;
+    }
+
+    errorMsg="domLogTest: success";
+    return 0;
+}
+
+char *domLogTest_status() {
+    return errorMsg;
+}
@@ -0,0 +1,14 @@
+/* runDomLogTest.c */
+
+#include "domLog/domLogTest.h"
+	
+
+int main() {
+
+    int i;
+
+    i=domLogTest();
+
+    printf("runDomLogTest: return status= %s\n",
+	domLogTest_status());
+}
@@ -0,0 +1,224 @@
+/* domTrace.c */
+
+/* Per-thread trace stamp rings and the Chrome trace
+   writer, see domTrace.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domTrace/domTrace.h"
+
+#define DOMTRACE_RING_MASK (DOMTRACE_RING_LEN-1)
+/* time for stamps in progress to land after tracing
+   is turned off */
+#define DOMTRACE_GRACE_USEC 1000
+#define RING_UNSET (-1)
+#define RING_NONE (-2)
+
+typedef struct {
+    ULONG id;
+    long long nsec;
+    UBYTE point;
+    UBYTE type;
+    UBYTE subtype;
+    UBYTE tid;
+} DOMTRACE_STAMP;
+
+typedef struct {
+    DOMTRACE_STAMP stamp[DOMTRACE_RING_LEN];
+    ULONG head;
+} __attribute__((aligned(64))) DOMTRACE_RING;
+
+volatile int domTraceOn=0;
+DOMTRACE_RING traceRings[DOMTRACE_MAX_THREADS];
+int traceRingCnt=0;
+__thread int myTraceRing=RING_UNSET;
+/* request id of the buffer in each pool slot */
+ULONG traceSlotId[DOMTRACE_MAX_SLOTS];
+ULONG traceNextId=0;
+
+/* span name, by the stamp that ends it */
+static const char *hopName[DOMTRACE_POINT_CNT]={
+    "link receive",
+    "RD queue",
+    "route",
+    "service",
+    "reply",
+    "SD queue and send"
+};
+
+static void addStamp(ULONG id, MESSAGE_STRUCT *M, int point)
+{
+    struct timespec ts;
+    DOMTRACE_RING *r;
+    DOMTRACE_STAMP *s;
+
+    if(myTraceRing==RING_UNSET) {
+	myTraceRing=__sync_fetch_and_add(&traceRingCnt,1);
+	if(myTraceRing>=DOMTRACE_MAX_THREADS) {
+	    myTraceRing=RING_NONE;
+	}
+    }
+    if(myTraceRing==RING_NONE) {
+	return;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    r=&traceRings[myTraceRing];
+    s=&r->stamp[r->head&DOMTRACE_RING_MASK];
+    s->id=id;
+    s->nsec=(long long)ts.tv_sec*1000000000+ts.tv_nsec;
+    s->point=(UBYTE)point;
+    s->type=Message_getType(M);
+    s->subtype=Message_getSubtype(M);
+    s->tid=(UBYTE)myTraceRing;
+    r->head++;
+}
+
+void domTrace_begin(MESSAGE_STRUCT *M, int point)
+{
+    int slot=messageBuffers_index(M);
+    ULONG id;
+
+    if((slot<0) || (slot>=DOMTRACE_MAX_SLOTS)) {
+	return;
+    }
+    id=__sync_add_and_fetch(&traceNextId,1);
+    traceSlotId[slot]=id;
+    addStamp(id,M,point);
+}
+
+void domTrace_stamp(MESSAGE_STRUCT *M, int point)
+{
+    int slot=messageBuffers_index(M);
+
+    if((slot<0) || (slot>=DOMTRACE_MAX_SLOTS) ||
+	(traceSlotId[slot]==0)) {
+	return;
+    }
+    addStamp(traceSlotId[slot],M,point);
+}
+
+void domTrace_end(MESSAGE_STRUCT *M, int point)
+{
+    int slot=messageBuffers_index(M);
+
+    if((slot<0) || (slot>=DOMTRACE_MAX_SLOTS) ||
+	(traceSlotId[slot]==0)) {
+	return;
+    }
+    addStamp(traceSlotId[slot],M,point);
+    traceSlotId[slot]=0;
+}
+
+void domTrace_start(void)
+{
+    int i;
+
+    domTraceOn=0;
+    usleep(DOMTRACE_GRACE_USEC);
+    for(i=0;i<DOMTRACE_MAX_THREADS;i++) {
+	traceRings[i].head=0;
+    }
+    memset(traceSlotId,0,sizeof(traceSlotId));
+    __sync_synchronize();
+    domTraceOn=1;
+}
+
+void domTrace_stop(void)
+{
+    domTraceOn=0;
+}
+
+/* request order, then time */
+static int compareStamps(const void *a, const void *b)
+{
+    const DOMTRACE_STAMP *x=(const DOMTRACE_STAMP *)a;
+    const DOMTRACE_STAMP *y=(const DOMTRACE_STAMP *)b;
+
+    if(x->id!=y->id) {
+	return (x->id<y->id) ? -1 : 1;
+    }
+    if(x->nsec!=y->nsec) {
+	return (x->nsec<y->nsec) ? -1 : 1;
+    }
+    return (int)x->point-(int)y->point;
+}
+
+int domTrace_dump(const char *path)
+{
+    DOMTRACE_STAMP *all;
+    DOMTRACE_STAMP *from;
+    DOMTRACE_STAMP *to;
+    DOMTRACE_RING *r;
+    FILE *out;
+    long long base;
+    ULONG n;
+    ULONG j;
+    int rings;
+    int cnt=0;
+    int spans=0;
+    int i;
+
+    domTraceOn=0;
+    usleep(DOMTRACE_GRACE_USEC);
+
+    all=(DOMTRACE_STAMP *)malloc(sizeof(DOMTRACE_STAMP)*
+	DOMTRACE_RING_LEN*DOMTRACE_MAX_THREADS);
+    if(all==0) {
+	return -1;
+    }
+    rings=traceRingCnt;
+    if(rings>DOMTRACE_MAX_THREADS) {
+	rings=DOMTRACE_MAX_THREADS;
+    }
+    for(i=0;i<rings;i++) {
+	r=&traceRings[i];
+	n=(r->head<DOMTRACE_RING_LEN) ? r->head : DOMTRACE_RING_LEN;
+	for(j=r->head-n;j!=r->head;j++) {
+	    all[cnt++]=r->stamp[j&DOMTRACE_RING_MASK];
+	}
+    }
+    qsort(all,cnt,sizeof(DOMTRACE_STAMP),compareStamps);
+
+    out=fopen(path,"w");
+    if(out==0) {
+	free(all);
+	return -1;
+    }
+    base=(cnt>0) ? all[0].nsec : 0;
+    for(i=1;i<cnt;i++) {
+	if(all[i].nsec<base) {
+	    base=all[i].nsec;
+	}
+    }
+
+    fprintf(out,"{\"traceEvents\":[\n");
+    fprintf(out,"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+	"\"args\":{\"name\":\"domapp\"}}");
+    /* one span between consecutive stamps of a request,
+       on the thread that made the later stamp */
+    for(i=1;i<cnt;i++) {
+	from=&all[i-1];
+	to=&all[i];
+	if((from->id!=to->id) || (to->point<=from->point)) {
+	    continue;
+	}
+	fprintf(out,",\n{\"name\":\"%s\",\"cat\":\"msg\",\"ph\":\"X\","
+	    "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+	    "\"args\":{\"req\":%lu,\"type\":%d,\"subtype\":%d}}",
+	    hopName[to->point],
+	    (double)(from->nsec-base)/1000.0,
+	    (double)(to->nsec-from->nsec)/1000.0,
+	    to->tid,to->id,to->type,to->subtype);
+	spans++;
+    }
+    fprintf(out,"\n]}\n");
+    fclose(out);
+    free(all);
+    return spans;
+}
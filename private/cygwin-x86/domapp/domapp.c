@@ -3,6 +3,8 @@
 #include <pthread.h>
 #include <sys/socket.h>
 #include <stdio.h>
+#include <time.h>
+#include <unistd.h>
 #include "msgHandler/msgHandlerTest.h"
 #include "domapp_common/DOMtypes.h"
 #include "domapp_common/PacketFormatInfo.h"
@@ -12,6 +14,24 @@
 #include "message/messageBuffers.h"
 #include "msgHandler/msgHandler.h"
 #include "msgHandler/MSGHANDLERmessageAPIstatus.h"
+#include "msgHandler/msgDispatch.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/DOMstats.h"
+#include "msgHandler/msgSubscribe.h"
+#include "domapp_common/commonServices.h"
+#include "service/serviceRuntime.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/hitFilter.h"
+#include "dataAccess/scaler.h"
+#include "dataAccess/histogram.h"
+#include "dataAccess/dataAccess.h"
+#include "dataAccess/waveformFile.h"
+#include "dataAccess/hitGenerator.h"
+#include "statsPage/statsPage.h"
+#include "domLog/domLog.h"
+#include "domTrace/domTrace.h"
+#include "warmRestart/warmRestart.h"
 	
 #define STDIN 0
 #define STDOUT 1
@@ -43,23 +63,39 @@ int EC;
 int DA;
 int TM;
 
-/* packet driver counters, etc. */
-ULONG PKTrecv;
-ULONG PKTsent;
-ULONG NoStorage;
-ULONG FreeListCorrupt;
-ULONG PKTbufOvr;
-ULONG PKTbadFmt;
-ULONG PKTspare;
-
-ULONG MSGrecv;
-ULONG MSGsent;
-ULONG tooMuchData;
-ULONG IDMismatch;
-ULONG CRCproblem;
-
 pthread_mutex_t msgHandlerMutex=PTHREAD_MUTEX_INITIALIZER;
 
+/* common info for the services run by the worker threads */
+COMMON_SERVICE_INFO slowCntl;
+COMMON_SERVICE_INFO expCntl;
+COMMON_SERVICE_INFO testMgr;
+
+SERVICE_DESC serviceTable[] = {
+    {"slow control", &SC, &slowCntl, 0, MSGBUF_OWNER_SC},
+    {"data access", &DA, &dataAcc, dataAccess_serve, MSGBUF_OWNER_DA},
+    {"experiment control", &EC, &expCntl, 0, MSGBUF_OWNER_EC},
+    {"test manager", &TM, &testMgr, 0, MSGBUF_OWNER_TM},
+};
+#define SERVICE_TABLE_CNT (sizeof(serviceTable)/sizeof(SERVICE_DESC))
+
+/* REAL_DATA source for the hit generator */
+WAVEFORM_FILE waveforms;
+
+/* message handler's own common info */
+extern COMMON_SERVICE_INFO msgHand;
+
+/* drives the counter subscriptions */
+static void *subscriptionPusher(void *arg) {
+    struct timespec ts;
+
+    for (;;) {
+	usleep(MSG_SUBSCRIBE_TICK_MSEC * 1000);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	msgSubscribe_tick((ULONG)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000));
+    }
+    return 0;
+}
+
 /* main code that starts communications driver and then domapp */
 int main(int argc, char* argv[]) {
 
@@ -73,13 +109,18 @@ int main(int argc, char* argv[]) {
     int send;
     int receive;
     pthread_t msgHandlerID;
+    pthread_t pusherID;
     int domID;
     int port;
     fd_set fds;
     struct timeval timeout;
     int nready;
+    int workers;
+    int warm;
 
-    fprintf(stderr,"domapp: argc=%d, argv[0]=%s\n\r", argc, argv[0]);
+    /* log records are formatted off the hot path */
+    domLog_start();
+    DOMLOG2(DOMLOG_INFO, "domapp: argc=%ld, argv[0]=%s", argc, argv[0]);
     /* read args and configure communications */
     if (argc >= 1) {
         sscanf(argv[0], "%i", &domID);
@@ -89,58 +130,136 @@ int main(int argc, char* argv[]) {
   	domID=1234;
     }
 
-    /* show what dom we're running as */
-    fprintf(stderr,"domapp: executing as DOM #%d\n\r",domID);
+    /* optional size of the service worker pool */
+    workers = SERVICE_DEFAULT_WORKERS;
+    if (argc >= 2) {
+        sscanf(argv[1], "%i", &workers);
+    }
 
-    /* init messageBuffers */
-    messageBuffers_init();
+    /* show what dom we're running as */
+    DOMLOG1(DOMLOG_INFO, "domapp: executing as DOM #%ld", domID);
+
+    /* init messageBuffers and counters, in shared memory */
+    /* when it is there so a restart can pick them up */
+    warm = warmRestart_attach(WARM_SHM_NAME);
+    if (warm < 0) {
+	DOMLOG(DOMLOG_WARN, "domapp: no warm restart segment");
+	messageBuffers_init();
+	DOMstats_init();
+    }
+    else if (warm) {
+	DOMLOG1(DOMLOG_INFO, "domapp: warm start%s",
+	    warmRestart_crashed() ? ", previous run did not stop" : "");
+    }
 
     /* create message queues for msgHandler */
     RD = Message_createQueue(RD_QUEUE);
     if (RD < 0) {
 	errorMsg="domapp: cannot create message queue RD";
-	fprintf(stderr,"%s\n\r",errorMsg);
+	DOMLOG1(DOMLOG_ERROR, "%s", errorMsg);
+	domLog_flush();
 	return ERROR;
     }
 
     SD = Message_createQueue(SD_QUEUE);
     if (SD < 0) {
 	errorMsg="domapp: cannot create message queue SD";
-	fprintf(stderr,"%s\n\r",errorMsg);
+	DOMLOG1(DOMLOG_ERROR, "%s", errorMsg);
+	domLog_flush();
 	return ERROR;
     }
 
     SC = Message_createQueue(SC_QUEUE);
     if (SC < 0) {
 	errorMsg="domapp: cannot create message queue SC";
-	fprintf(stderr,"%s\n\r",errorMsg);
+	DOMLOG1(DOMLOG_ERROR, "%s", errorMsg);
+	domLog_flush();
 	return ERROR;
     }
 
     EC = Message_createQueue(EC_QUEUE);
     if (EC < 0) {
 	errorMsg="domapp: cannot create message queue EC";
-	fprintf(stderr,"%s\n\r",errorMsg);
+	DOMLOG1(DOMLOG_ERROR, "%s", errorMsg);
+	domLog_flush();
 	return ERROR;
     }
 
     DA = Message_createQueue(DA_QUEUE);
     if (DA < 0) {
 	errorMsg="domapp: cannot create message queue DA";
-	fprintf(stderr,"%s\n\r",errorMsg);
+	DOMLOG1(DOMLOG_ERROR, "%s", errorMsg);
+	domLog_flush();
 	return ERROR;
     }
 
     TM = Message_createQueue(TM_QUEUE);
     if (TM < 0) {
 	errorMsg="domapp: cannot create message queue TM";
-	fprintf(stderr,"%s\n\r",errorMsg);
+	DOMLOG1(DOMLOG_ERROR, "%s", errorMsg);
+	domLog_flush();
 	return ERROR;
     }
 
+    /* entries left on the queues point into the old mapping */
+    if (warm > 0) {
+	k = warmRestart_flushQueue(RD) + warmRestart_flushQueue(SD) +
+	    warmRestart_flushQueue(SC) + warmRestart_flushQueue(EC) +
+	    warmRestart_flushQueue(DA) + warmRestart_flushQueue(TM);
+	DOMLOG2(DOMLOG_INFO, "domapp: %ld stale entries, %ld replies resent",
+	    k, warmRestart_resume(SD));
+    }
+
+    /* start the service workers before anything is routed */
+    for (i = 0; i < SERVICE_TABLE_CNT; i++) {
+	commonServices_init(serviceTable[i].info, 0, 1);
+	serviceRuntime_register(&serviceTable[i]);
+    }
+    dataAccess_init();
+    /* recorded waveforms for generated REAL_DATA hits */
+    if (waveformFile_open(&waveforms, WAVEFORM_FILE_DEFAULT) > 0) {
+	hitGenerator_setFile(&waveforms);
+	DOMLOG1(DOMLOG_INFO, "domapp: %ld recorded waveforms", waveforms.cnt);
+    }
+    msgDispatch_setForwardHook(serviceRuntime_notify);
+    workers = serviceRuntime_start(workers);
+    DOMLOG1(DOMLOG_INFO, "domapp: %ld service workers", workers);
+
+    /* counter groups for subscriptions, in the order */
+    /* given in MSGHANDLERextAPIstatus.h */
+    msgSubscribe_addGroup(&pktStats);
+    msgSubscribe_addGroup(&msgStats);
+    msgSubscribe_addGroup(&ovflStats);
+    msgSubscribe_addGroup(&msgHand.stats);
+    for (i = 0; i < SERVICE_TABLE_CNT; i++) {
+	msgSubscribe_addGroup(&serviceTable[i].info->stats);
+    }
+
     i = pthread_create(&msgHandlerID, NULL, msgHandler, 0);
+    if (pthread_create(&pusherID, NULL, subscriptionPusher, 0) != 0) {
+	DOMLOG(DOMLOG_WARN, "domapp: no subscription pushes");
+    }
+
+    /* publish live statistics for local monitoring, */
+    /* domapp runs without it if it cannot be created */
+    if (statsPage_create() == 0) {
+	statsPage_addService("msgHandler", &msgHand);
+	for (i = 0; i < SERVICE_TABLE_CNT; i++) {
+	    statsPage_addService(serviceTable[i].name, serviceTable[i].info);
+	}
+	statsPage_addQueue("RD", &RD);
+	statsPage_addQueue("SD", &SD);
+	statsPage_addQueue("SC", &SC);
+	statsPage_addQueue("EC", &EC);
+	statsPage_addQueue("DA", &DA);
+	statsPage_addQueue("TM", &TM);
+	statsPage_start(STATS_PAGE_PERIOD_USEC);
+    }
+    else {
+	DOMLOG(DOMLOG_WARN, "domapp: no live statistics page");
+    }
 
-    fprintf(stderr, "Read to go\n");
+    DOMLOG(DOMLOG_INFO, "Read to go");
 
     /* set up the select so that we can do read timeouts */
     FD_ZERO(&fds);
@@ -153,18 +272,19 @@ int main(int argc, char* argv[]) {
 	nready = select(FD_SETSIZE, &fds, (fd_set *)0, (fd_set *)0, 
 	    &timeout);
 
-	fprintf(stderr, "out of select, nready=%d\n",nready);
+	DOMLOG1(DOMLOG_DEBUG, "out of select, nready=%ld", nready);
 
 	/* always reset timeout value to larger value */
 	timeout.tv_usec = TIMEOUT_100MSEC;
 	if (nready < 0) {
-	    fprintf(stderr, "domapp: com error on read\n");
+	    DOMLOG(DOMLOG_ERROR, "domapp: com error on read");
+	    domLog_flush();
 	    return COM_ERROR;
 	}
 
 	/* see if we have anything to read */
 	if (nready > 0) {
-	    fprintf(stderr, "domapp: performing read\n");
+	    DOMLOG(DOMLOG_DEBUG, "domapp: performing read");
 	    if (FD_ISSET(STDIN, &fds)) {
 	    	if (recvMsg() < 0) {
 		    /* error reported from receive */
@@ -175,7 +295,7 @@ int main(int argc, char* argv[]) {
 	  
 	/* see if msgHandler has something to send out */
 	else {
-	    fprintf(stderr, "domapp: performing write\n");
+	    DOMLOG(DOMLOG_DEBUG, "domapp: performing write");
 	    if (sendMsg() < 0) {
 	        /* error reported from send */
 	        /* try a reconnect */
@@ -187,7 +307,9 @@ int main(int argc, char* argv[]) {
     }
 
     errorMsg="domapp: lost socket connection";
-    fprintf(stderr,"%s\n\r",errorMsg);
+    DOMLOG1(DOMLOG_ERROR, "%s", errorMsg);
+    domLog_flush();
+    warmRestart_stop();
     return 0;
 }
 
@@ -211,6 +333,7 @@ int recvMsg() {
 	    return sts;
 	}
 
+	STAT_INC(&pktStats, PKT_RECV);
 	targetLength -= sts;
 	if(targetLength == 0) {
 	    break;
@@ -218,23 +341,25 @@ int recvMsg() {
 	buffer_p += sts;
     }
     
-    fprintf(stderr, "domapp: starting receive of message of length=%d\n",
+    DOMLOG1(DOMLOG_DEBUG, "domapp: starting receive of message of length=%ld",
 	msgLength);
 
     /* check for illegal length value */
-    if (msgLength > (sizeof(MESSAGE_STRUCT) + MAXDATA_VALUE)) {
+    if (msgLength > (MESSAGE_WIRE_LEN + MAXDATA_VALUE)) {
+	STAT_INC(&msgStats, MSG_TOO_MUCH_DATA);
 	return ERROR;
     }
     
     /* receive the message header */
     recvBuffer_p = messageBuffers_allocate();
     if (recvBuffer_p == NULL) {
+	STAT_INC(&pktStats, PKT_NO_STORAGE);
 	return ERROR;
     }
     /* save data buffer address for  this message buffer */
     dataBuffer_p = Message_getData(recvBuffer_p);
 
-    targetLength = sizeof(MESSAGE_STRUCT);
+    targetLength = MESSAGE_WIRE_LEN;
     buffer_p = (char *)recvBuffer_p;
 
     while (targetLength != 0) {
@@ -247,6 +372,7 @@ int recvMsg() {
 	    return sts;
 	}
 
+	STAT_INC(&pktStats, PKT_RECV);
 	targetLength -= sts;
 	if(targetLength == 0) {
 	    break;
@@ -255,16 +381,24 @@ int recvMsg() {
     }
     
 
-    fprintf(stderr, "domapp: header received, starting data portion of length=%d\n",
+    /* the wire header carries the sender's data pointer, */
+    /* put back our own so the body lands in this buffer */
+    Message_setData(recvBuffer_p, dataBuffer_p, Message_dataLen(recvBuffer_p));
+    /* reserved bytes are ours, they mark internal requests */
+    recvBuffer_p->head.hd.res[0] = 0;
+    recvBuffer_p->head.hd.res[1] = 0;
+
+    DOMLOG1(DOMLOG_DEBUG, "domapp: header received, starting data portion of length=%ld",
    	Message_dataLen(recvBuffer_p));
 
     /* check internal message header length */
-    if ((msgLength - sizeof(MESSAGE_STRUCT) -
+    if ((msgLength - MESSAGE_WIRE_LEN -
 	Message_dataLen(recvBuffer_p)) != 0) {
 
 	/* patch up message buffer and release it */
 	Message_setData(recvBuffer_p, dataBuffer_p, MAXDATA_VALUE);
 	messageBuffers_release(recvBuffer_p);
+	STAT_INC(&pktStats, PKT_BAD_FMT);
 	return ERROR;
     }
 
@@ -283,6 +417,7 @@ int recvMsg() {
 	    return sts;
 	}
 
+	STAT_INC(&pktStats, PKT_RECV);
 	targetLength -= sts;
 	if(targetLength == 0) {
 	    break;
@@ -291,7 +426,11 @@ int recvMsg() {
     }
     
 
+    STAT_INC(&msgStats, MSG_RECV);
+
     /* send it off to the msgHandler */
+    messageBuffers_setOwner(recvBuffer_p, MSGBUF_OWNER_HANDLER);
+    DOMTRACE_BEGIN(recvBuffer_p, DOMTRACE_LINK_RECV);
     Message_send(recvBuffer_p, RD);
 
     return 0;
@@ -303,29 +442,40 @@ int sendMsg() {
     MESSAGE_STRUCT *sendBuffer_p;
 
     if(Message_receive_nonblock(&sendBuffer_p, SD) > 0) {
-	fprintf(stderr, "domapp: have a message to send\n");
-	sendLen = sizeof(long) + sizeof(MESSAGE_STRUCT) +
+	DOMLOG(DOMLOG_DEBUG, "domapp: have a message to send");
+	messageBuffers_setOwner(sendBuffer_p, MSGBUF_OWNER_LINK_TX);
+	sendLen = sizeof(long) + MESSAGE_WIRE_LEN +
 	    (long)Message_dataLen(sendBuffer_p);
 
 	/* send out the message length */
-	fprintf(stderr, "domapp: sent message length=%d\n", sendLen);
+	DOMLOG1(DOMLOG_DEBUG, "domapp: sent message length=%ld", sendLen);
         sts = send(STDOUT, &sendLen, sizeof(long), 0);
 	if(sts < 0) {
 	    return sts;
 	}
 
-	/* send out the message header */
-	fprintf(stderr, "domapp: sent message header\n");
-	sts = send(STDOUT, sendBuffer_p, sizeof(MESSAGE_STRUCT), 0);
-	if(sts < 0) {
-	    return sts;
+	if (Message_getData(sendBuffer_p) == sendBuffer_p->inl) {
+	    /* header and body are contiguous, send both at once */
+	    DOMLOG1(DOMLOG_DEBUG, "domapp: sent header and %ld data bytes",
+		Message_dataLen(sendBuffer_p));
+	    sts = send(STDOUT, sendBuffer_p, sendLen - sizeof(long), 0);
+	}
+	else {
+	    /* send out the message header */
+	    DOMLOG(DOMLOG_DEBUG, "domapp: sent message header");
+	    sts = send(STDOUT, sendBuffer_p, MESSAGE_WIRE_LEN, 0);
+	    if(sts < 0) {
+		return sts;
+	    }
+
+	    /* send out the optional data body, so length could be 0 */
+	    DOMLOG1(DOMLOG_DEBUG, "domapp: sent data portion of %ld bytes",
+		Message_dataLen(sendBuffer_p));
+	    sts = send(STDOUT, Message_getData(sendBuffer_p), 
+		Message_dataLen(sendBuffer_p), 0);
 	}
 
-	/* send out the optional data body, so length could be 0 */
-	fprintf(stderr, "domapp: sent data portion of %d bytes\n",
-	    Message_dataLen(sendBuffer_p));
-	sts = send(STDOUT, Message_getData(sendBuffer_p), 
-	    Message_dataLen(sendBuffer_p), 0);
+	DOMTRACE_END(sendBuffer_p, DOMTRACE_LINK_SENT);
 
 	/* always delete the message buffer-even if there was a com error */
     	messageBuffers_release(sendBuffer_p);
@@ -333,9 +483,10 @@ int sendMsg() {
 	if(sts < 0) {
 	    return sts;
 	}
+	STAT_INC(&msgStats, MSG_SENT);
     }
     else {
-	fprintf(stderr, "domapp: sendMsg: nothing to send\n");
+	DOMLOG(DOMLOG_DEBUG, "domapp: sendMsg: nothing to send");
 	return 0;
     }
 }
@@ -0,0 +1,14 @@
+/* runStatCountersTest.c */
+
+#include "domapp_common/statCountersTest.h"
+	
+
+int main() {
+
+    int i;
+
+    i=statCountersTest();
+
+    printf("runStatCountersTest: return status= %s\n",
+	statCountersTest_status());
+}
@@ -0,0 +1,86 @@
+/* statCountersTest.c */
+
+#include <pthread.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/statCountersTest.h"
+	
+#define ERROR -1
+#define TEST_THREADS 4
+#define TEST_COUNTS 100000
+
+/* storage */
+char *errorMsg;
+STAT_GROUP testStats;
+
+/* each thread bumps counter 0 by one and counter 1 by two */
+static void *countThread(void *arg) {
+    int i;
+
+    for(i=0;i<TEST_COUNTS;i++) {
+	STAT_INC(&testStats,0);
+	STAT_ADD(&testStats,1,2);
+    }
+    return 0;
+}
+
+static int runThreads() {
+    pthread_t ids[TEST_THREADS];
+    int i;
+
+    for(i=0;i<TEST_THREADS;i++) {
+	if(pthread_create(&ids[i],NULL,countThread,0)!=0) {
+	    return ERROR;
+	}
+    }
+    for(i=0;i<TEST_THREADS;i++) {
+	pthread_join(ids[i],NULL);
+    }
+    return 0;
+}
+
+/* test entry point */
+int statCountersTest() {
+
+    /* storage */
+    ULONG values[STAT_MAX_COUNTERS];
+
+    statCounters_init(&testStats,"test",2);
+
+    /* counts from all threads must add up */
+    if(runThreads()!=0) {
+	errorMsg="statCountersTest: cannot start threads";
+	return ERROR;
+    }
+    statCounters_snapshot(&testStats,values);
+    if((values[0]!=TEST_THREADS*TEST_COUNTS) ||
+	(values[1]!=2*TEST_THREADS*TEST_COUNTS)) {
+	errorMsg="statCountersTest: sharded counts lost increments";
+	return ERROR;
+    }
+
+    /* reset starts a new epoch at zero */
+    statCounters_reset(&testStats);
+    if((statCounters_read(&testStats,0)!=0) ||
+	(statCounters_read(&testStats,1)!=0)) {
+	errorMsg="statCountersTest: reset did not zero counters";
+	return ERROR;
+    }
+
+    /* and counting continues from there */
+    if(runThreads()!=0) {
+	errorMsg="statCountersTest: cannot start threads";
+	return ERROR;
+    }
+    if(statCounters_read(&testStats,0)!=TEST_THREADS*TEST_COUNTS) {
+	errorMsg="statCountersTest: count after reset error";
+	return ERROR;
+    }
+
+    errorMsg="statCountersTest: success";
+    return 0;
+}
+
+char *statCountersTest_status() {
+    return errorMsg;
+}
@@ -1,5 +1,6 @@
 /* message.c */
 
+#include <string.h>
 #include "domapp_common/DOMtypes.h"
 #include "domapp_common/PacketFormatInfo.h"
 #include "domapp_common/MessageAPIstatus.h"
@@ -22,11 +23,16 @@ void Message_init(MESSAGE_STRUCT *msg) {
   msg->head.hd.mt= 0; 	      
   msg->head.hd.dlenLO= 0;
   msg->head.hd.dlenHI= 0;
-  msg->data= (UBYTE*) 0;   
+  msg->data= msg->inl;   
 }
 
-/* cygwin msg struct to use for transfers */
-struct msgbuf message;
+/* cygwin msg struct to use for transfers.  Queues carry
+   only the message pointer.  Senders and receivers run on
+   several threads, so each call uses its own copy. */
+typedef struct {
+    long mtype;
+    MESSAGE_STRUCT *msg;
+} MSG_QUEUE_BUF;
 size_t msgLen=sizeof(MESSAGE_STRUCT *);
 
 
@@ -52,6 +58,14 @@ UBYTE* Message_getData(MESSAGE_STRUCT *msgStruct)
 	return msgStruct->data;
 }
 
+/* TRUE if the data body lives entirely in the header
+   cache line. */
+int Message_isInline(MESSAGE_STRUCT *msgStruct)
+{
+	return (msgStruct->data == msgStruct->inl) &&
+	    (Message_dataLen(msgStruct) <= MESSAGE_INLINE_LEN);
+}
+
 int Message_dataLen(MESSAGE_STRUCT *msgStruct)
 {
 	return (msgStruct->head.hd.dlenLO + 
@@ -75,10 +89,21 @@ void Message_setStatus(MESSAGE_STRUCT *msgStruct,
  msgStruct->head.hd.status= status;
 }
 
+/* see message.h.  d may point into the inline area
+   itself, so the copy has to allow overlap. */
 void Message_setData(MESSAGE_STRUCT *msgStruct,
 	UBYTE *d, int l)
 {
- msgStruct->data = d;
+ if(d == msgStruct->inl || d == msgStruct->data) {
+    msgStruct->data = d;
+ }
+ else if(l <= MESSAGE_INLINE_LEN) {
+    memmove(msgStruct->inl, d, l);
+    msgStruct->data = msgStruct->inl;
+ }
+ else {
+    msgStruct->data = d;
+ }
  msgStruct->head.hd.dlenLO= l & 0xff;
  msgStruct->head.hd.dlenHI= ( l >> 8) & 0xff;
 }
@@ -106,8 +131,10 @@ int Message_createQueue(int q) {
 int Message_send(MESSAGE_STRUCT *msgStruct,
 	int queue)
 {
+    MSG_QUEUE_BUF message;
+
     message.mtype=NORMAL_MSG;
-    memcpy(&message.mtext[0],&msgStruct,msgLen);
+    message.msg=msgStruct;
 
     return msgsnd(queue,&message,msgLen,IPC_NOWAIT);
 }
@@ -122,14 +149,15 @@ int Message_receive(MESSAGE_STRUCT **msgStruct,
 	int queue)
 {
     int sts;
+    MSG_QUEUE_BUF message;
 
-    sts=msgrcv(queue,&message,MSGMAX,NORMAL_MSG,WAIT);
+    sts=msgrcv(queue,&message,msgLen,NORMAL_MSG,WAIT);
 
     if(sts<0) {
 	return sts;
     }
     else {
-	memcpy(msgStruct,&message.mtext[0],msgLen);
+	*msgStruct=message.msg;
   	return sts;
     }
 }
@@ -138,14 +166,15 @@ int Message_receive_nonblock(MESSAGE_STRUCT **msgStruct,
 	int queue)
 {
     int sts;
+    MSG_QUEUE_BUF message;
 
-    sts=msgrcv(queue,&message,MSGMAX,NORMAL_MSG,IPC_NOWAIT);
+    sts=msgrcv(queue,&message,msgLen,NORMAL_MSG,IPC_NOWAIT);
 
     if(sts<=0) {
 	return sts;
     }
     else {
-	memcpy(msgStruct,&message.mtext[0],msgLen);
+	*msgStruct=message.msg;
   	return sts;
     }
 }
@@ -1,5 +1,6 @@
-/* message.c */
+/* messageBuffers.c */
 
+#include <time.h>
 #include "domapp_common/DOMtypes.h"
 #include "domapp_common/PacketFormatInfo.h"
 #include "domapp_common/MessageAPIstatus.h"
@@ -9,41 +10,206 @@
 /* declare how many message and data buffers we will create */
 #define MAX_MSG 16
 	
-/* static storage for message headers and data buffers */
+/* static storage for message headers and data buffers.
+   Each slot holds a header followed directly by the rest
+   of its data body, so the body starts in the header's
+   inline area and small payloads share its cache line. */
+typedef struct {
+    MESSAGE_STRUCT hdr;
+    UBYTE spill[MAXDATA_VALUE-MESSAGE_INLINE_LEN];
+} __attribute__((aligned(MESSAGE_CACHE_LINE))) MESSAGE_SLOT;
 
-MESSAGE_STRUCT *msgFreeList[MAX_MSG];
-MESSAGE_STRUCT msgHdr[MAX_MSG];
-UBYTE msgData[MAX_MSG][MAXDATA_VALUE];
-int nextMsgFree=0;
-int lastMsgFree=0;
-int freeListCorrupt=0;
+/* all pool state, in one block so that it can be kept in
+   shared memory across a restart (messageBuffers_attach).
+   The free list holds slot indexes, which stay valid
+   wherever the block is mapped. */
+typedef struct {
+    MESSAGE_SLOT slot[MAX_MSG];
+    int freeList[MAX_MSG];
+    int nextFree;
+    int lastFree;
+    /* taken around free list updates, which can come
+       from several threads */
+    int lock;
+    int freeListCorrupt;
+
+    /* pool telemetry */
+    ULONG allocCnt;
+    ULONG releaseCnt;
+    ULONG allocFail;
+    int lowWater;
+
+    /* current owner of each slot and the per stage census */
+    UBYTE owner[MAX_MSG];
+    int census[MSGBUF_OWNER_CNT];
+} MSGBUF_ARENA;
+
+#define FREE_NONE (-1)
+
+MSGBUF_ARENA localArena;
+MSGBUF_ARENA *arena=&localArena;
+
+#ifdef MESSAGE_BUFFERS_DEBUG
+/* allocation site and time of each outstanding slot */
+const char *msgAllocFile[MAX_MSG];
+int msgAllocLine[MAX_MSG];
+ULONG msgAllocTime[MAX_MSG];
+
+static ULONG msecNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (ULONG)ts.tv_sec*1000+ts.tv_nsec/1000000;
+}
+#endif
+
+/* start of the contiguous data body of a slot */
+static UBYTE *slotData(int i) {
+    return (UBYTE *)&arena->slot[i]+offsetof(MESSAGE_STRUCT,inl);
+}
+
+/* slot index of a pool buffer, -1 if not from the pool */
+static int slotIndex(MESSAGE_STRUCT *m) {
+    int i=(MESSAGE_SLOT *)m-arena->slot;
+    if((i<0) || (i>=MAX_MSG) || (&arena->slot[i].hdr != m)) {
+	return -1;
+    }
+    return i;
+}
+
+static void lockFreeList(void) {
+    while(__sync_lock_test_and_set(&arena->lock,1)) {
+	;
+    }
+}
+
+static void unlockFreeList(void) {
+    __sync_lock_release(&arena->lock);
+}
+
+/* free list of every slot whose owner is FREE, in index
+   order, and the census from the owners */
+static void rebuildFreeList(void)
+{
+    int i;
+    int n=0;
+
+    for(i=0;i<MSGBUF_OWNER_CNT;i++) {
+	arena->census[i]=0;
+    }
+    for(i=0;i<MAX_MSG;i++) {
+	arena->freeList[i]=FREE_NONE;
+    }
+    for(i=0;i<MAX_MSG;i++) {
+	if(arena->owner[i]>=MSGBUF_OWNER_CNT) {
+	    arena->owner[i]=MSGBUF_OWNER_FREE;
+	}
+	arena->census[arena->owner[i]]++;
+	if(arena->owner[i]==MSGBUF_OWNER_FREE) {
+	    arena->freeList[n++]=i;
+	}
+    }
+    arena->nextFree=0;
+    arena->lastFree=(n<MAX_MSG) ? n : 0;
+    arena->lock=0;
+}
 
 void messageBuffers_init()
 {
     int i;
 
     for(i=0;i<MAX_MSG;i++) {
-	msgFreeList[i]=&msgHdr[i];
-	msgHdr[i].data=&msgData[i][0];
+	arena->slot[i].hdr.data=slotData(i);
+	arena->owner[i]=MSGBUF_OWNER_FREE;
+    }
+    rebuildFreeList();
+    messageBuffers_clearStats();
+}
+
+int messageBuffers_arenaSize() {
+    return sizeof(MSGBUF_ARENA);
+}
+
+int messageBuffers_attach(void *mem, int warm, void *oldMem)
+{
+    long delta=(UBYTE *)mem-(UBYTE *)oldMem;
+    int i;
+
+    arena=(MSGBUF_ARENA *)mem;
+    if(!warm) {
+	messageBuffers_init();
+	return FALSE;
+    }
+
+    /* owners are the truth: a slot is taken off the free
+       list before it gets an owner and freed before it goes
+       back, so a crash between the two leaves it FREE */
+    for(i=0;i<MAX_MSG;i++) {
+	if(arena->owner[i]==MSGBUF_OWNER_FREE) {
+	    arena->slot[i].hdr.data=slotData(i);
+	    continue;
+	}
+	/* data pointed into the old mapping; a buffer that
+	   referenced memory outside its slot cannot be kept */
+	if((arena->slot[i].hdr.data+delta)!=slotData(i)) {
+	    arena->slot[i].hdr.data=slotData(i);
+	    arena->owner[i]=MSGBUF_OWNER_FREE;
+	    arena->freeListCorrupt++;
+	    continue;
+	}
+	arena->slot[i].hdr.data=slotData(i);
     }
-    nextMsgFree=0;
-    lastMsgFree=0;
+    rebuildFreeList();
+    return TRUE;
 }
 
+MESSAGE_STRUCT *messageBuffers_slot(int i) {
+    if((i<0) || (i>=MAX_MSG)) {
+	return 0;
+    }
+    return &arena->slot[i].hdr;
+}
+
+#ifdef MESSAGE_BUFFERS_DEBUG
+MESSAGE_STRUCT *messageBuffers_allocateAt(const char *file, int line)
+#else
 MESSAGE_STRUCT *messageBuffers_allocate()
+#endif
 {
     
-    MESSAGE_STRUCT *m;
+    MESSAGE_STRUCT *m=0;
+    int i;
+    int freeCnt;
 
-    m=msgFreeList[nextMsgFree];
-    if(m!=0) {
+    lockFreeList();
+    i=arena->freeList[arena->nextFree];
+    if(i!=FREE_NONE) {
+	arena->freeList[arena->nextFree]=FREE_NONE;
+	arena->nextFree++;
+	if(arena->nextFree>=MAX_MSG) {
+	    arena->nextFree=0;
+	}
+	arena->allocCnt++;
+	freeCnt=messageBuffers_freeCnt();
+	if(freeCnt<arena->lowWater) {
+	    arena->lowWater=freeCnt;
+	}
+    }
+    else {
+	arena->allocFail++;
+    }
+    unlockFreeList();
+
+    if(i!=FREE_NONE) {
+	m=&arena->slot[i].hdr;
 	m->head.hd.dlenHI=0;
 	m->head.hd.dlenLO=0;
-	msgFreeList[nextMsgFree]=0;
-	nextMsgFree++;
-	if(nextMsgFree>=MAX_MSG) {
-	    nextMsgFree=0;
-	}
+	/* whoever allocates is receiving from the link */
+	messageBuffers_setOwner(m,MSGBUF_OWNER_LINK_RX);
+#ifdef MESSAGE_BUFFERS_DEBUG
+	msgAllocFile[slotIndex(m)]=file;
+	msgAllocLine[slotIndex(m)]=line;
+	msgAllocTime[slotIndex(m)]=msecNow();
+#endif
     }
     return m;
 }
@@ -51,19 +217,53 @@ MESSAGE_STRUCT *messageBuffers_allocate()
 void messageBuffers_release(MESSAGE_STRUCT *m)
 {
 
-    if(msgFreeList[lastMsgFree]==0) {
-	msgFreeList[lastMsgFree]=m;
-	lastMsgFree++;
-	if(lastMsgFree>=MAX_MSG) {
-	    lastMsgFree=0;
+    int i=slotIndex(m);
+
+    /* refuse anything that did not come from this pool */
+    if(i<0) {
+	__sync_fetch_and_add(&arena->freeListCorrupt,1);
+	return;
+    }
+    /* undo any Message_setData() to an external buffer */
+    m->data=slotData(i);
+
+    lockFreeList();
+    if(arena->freeList[arena->lastFree]==FREE_NONE) {
+	messageBuffers_setOwner(m,MSGBUF_OWNER_FREE);
+	arena->freeList[arena->lastFree]=i;
+	arena->lastFree++;
+	if(arena->lastFree>=MAX_MSG) {
+	    arena->lastFree=0;
 	}
+	arena->releaseCnt++;
     }
     else {
-    	freeListCorrupt++;
+    	arena->freeListCorrupt++;
+    }
+    unlockFreeList();
+}
+
+/* record the pipeline stage now holding a buffer.  Stages
+   run on different threads, so the census is kept with
+   atomic adds. */
+void messageBuffers_setOwner(MESSAGE_STRUCT *m, int owner)
+{
+    int i=slotIndex(m);
+    int old;
+
+    if((i<0) || (owner<0) || (owner>=MSGBUF_OWNER_CNT)) {
+	return;
     }
+    old=arena->owner[i];
+    arena->owner[i]=(UBYTE)owner;
+    __sync_fetch_and_sub(&arena->census[old],1);
+    __sync_fetch_and_add(&arena->census[owner],1);
 }
 
 int messageBuffers_freeCnt() {
+    int nextMsgFree=arena->nextFree;
+    int lastMsgFree=arena->lastFree;
+
     if(nextMsgFree < lastMsgFree) {
 	return (lastMsgFree-nextMsgFree);
     }
@@ -71,7 +271,7 @@ int messageBuffers_freeCnt() {
 	return (MAX_MSG-nextMsgFree+lastMsgFree);
     }
     else {
-    	if(msgFreeList[nextMsgFree] == 0) {
+    	if(arena->freeList[nextMsgFree] == FREE_NONE) {
 	    return 0;
     	}
 	else {
@@ -83,3 +283,71 @@ int messageBuffers_freeCnt() {
 int messageBuffers_totalCnt() {
     return MAX_MSG;
 }
+
+int messageBuffers_index(MESSAGE_STRUCT *m) {
+    return slotIndex(m);
+}
+
+void messageBuffers_getStats(MSGBUF_STATS *s)
+{
+    int i;
+
+    s->totalCnt=MAX_MSG;
+    s->freeCnt=messageBuffers_freeCnt();
+    s->lowWater=arena->lowWater;
+    s->allocCnt=arena->allocCnt;
+    s->releaseCnt=arena->releaseCnt;
+    s->allocFail=arena->allocFail;
+    s->freeListCorrupt=arena->freeListCorrupt;
+    for(i=0;i<MSGBUF_OWNER_CNT;i++) {
+	s->census[i]=arena->census[i];
+    }
+}
+
+/* reset counters and restart the low-water mark from the
+   current free count.  The census is state, not a counter,
+   and is left alone. */
+void messageBuffers_clearStats()
+{
+    arena->allocCnt=0;
+    arena->releaseCnt=0;
+    arena->allocFail=0;
+    arena->freeListCorrupt=0;
+    arena->lowWater=messageBuffers_freeCnt();
+}
+
+int messageBuffers_corruptCnt() {
+    return arena->freeListCorrupt;
+}
+
+void messageBuffers_clearCorrupt() {
+    arena->freeListCorrupt=0;
+}
+
+int messageBuffers_outstanding(MSGBUF_OUTSTANDING *list, int max)
+{
+    int i;
+    int n=0;
+#ifdef MESSAGE_BUFFERS_DEBUG
+    ULONG now=msecNow();
+#endif
+
+    for(i=0;(i<MAX_MSG) && (n<max);i++) {
+	if(arena->owner[i]==MSGBUF_OWNER_FREE) {
+	    continue;
+	}
+	list[n].slot=i;
+	list[n].owner=arena->owner[i];
+#ifdef MESSAGE_BUFFERS_DEBUG
+	list[n].file=msgAllocFile[i];
+	list[n].line=msgAllocLine[i];
+	list[n].ageMsec=now-msgAllocTime[i];
+#else
+	list[n].file=NULL_ALLOC_SITE;
+	list[n].line=0;
+	list[n].ageMsec=0;
+#endif
+	n++;
+    }
+    return n;
+}
@@ -1,4 +1,4 @@
-/* message.c */
+/* messageBuffersTest.c */
 
 #include "domapp_common/DOMtypes.h"
 #include "domapp_common/PacketFormatInfo.h"
@@ -20,6 +20,8 @@ int messageBuffersTest() {
     int allocateCnt;
     MESSAGE_STRUCT *oneBuffer;
     MESSAGE_STRUCT *buffers[16];
+    MSGBUF_STATS stats;
+    MSGBUF_OUTSTANDING outstanding[16];
 
     /* init messageBuffers */
     messageBuffers_init();
@@ -48,6 +50,32 @@ int messageBuffersTest() {
 	return ERROR;
     }
 
+    /* telemetry should have seen one allocate/release pair */
+    messageBuffers_getStats(&stats);
+    if((stats.allocCnt != 1) || (stats.releaseCnt != 1) ||
+	(stats.lowWater != (maxNumBufs-1))) {
+	errorMsg="messageBuffersTest: pool counters not tracking";
+	return ERROR;
+    }
+
+    /* census follows a buffer through the pipeline stages */
+    oneBuffer=messageBuffers_allocate();
+    messageBuffers_setOwner(oneBuffer,MSGBUF_OWNER_SD);
+    messageBuffers_getStats(&stats);
+    if((stats.census[MSGBUF_OWNER_SD] != 1) ||
+	(stats.census[MSGBUF_OWNER_FREE] != (maxNumBufs-1)) ||
+	(messageBuffers_outstanding(outstanding,16) != 1) ||
+	(outstanding[0].owner != MSGBUF_OWNER_SD)) {
+	errorMsg="messageBuffersTest: owner census error";
+	return ERROR;
+    }
+    messageBuffers_release(oneBuffer);
+    messageBuffers_getStats(&stats);
+    if(stats.census[MSGBUF_OWNER_FREE] != maxNumBufs) {
+	errorMsg="messageBuffersTest: release did not update census";
+	return ERROR;
+    }
+
     /* allocate all buffers and see if count tracks */ 
     allocateCnt=0;
     while(messageBuffers_freeCnt() != 0) {
@@ -60,10 +88,21 @@ int messageBuffersTest() {
 	return ERROR;
     }
 
+    /* an empty pool refuses and counts the failure */
+    if(messageBuffers_allocate() != 0) {
+	errorMsg="messageBuffersTest: allocate from empty pool";
+	return ERROR;
+    }
+    messageBuffers_getStats(&stats);
+    if((stats.allocFail != 1) || (stats.lowWater != 0)) {
+	errorMsg="messageBuffersTest: allocation failure not counted";
+	return ERROR;
+    }
+
     /* release buffers and see if count tracks  correctly */
     while(messageBuffers_freeCnt() != messageBuffers_totalCnt()) {
-	messageBuffers_release(buffers[allocateCnt]);
 	allocateCnt--;
+	messageBuffers_release(buffers[allocateCnt]);
     }
 
     if(allocateCnt != 0) {
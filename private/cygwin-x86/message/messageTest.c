@@ -1,5 +1,6 @@
 /* messageTest.c */
 
+#include <string.h>
 #include "domapp_common/DOMtypes.h"
 #include "domapp_common/PacketFormatInfo.h"
 #include "domapp_common/MessageAPIstatus.h"
@@ -31,6 +32,8 @@ int messageTest() {
     int queue;
     int send;
     int receive;
+    UBYTE smallData[MESSAGE_INLINE_LEN];
+    static UBYTE largeData[MAXDATA_VALUE];
 
     /* init messageBuffers */
     messageBuffers_init();
@@ -91,6 +94,45 @@ int messageTest() {
 	return ERROR;
     }
 
+    /* pool buffers start their data body in the inline area */
+    if(Message_getData(oneBuffer) != oneBuffer->inl) {
+	errorMsg="messageTest: pool buffer data not inline";
+	return ERROR;
+    }
+
+    /* small payloads are copied inline, large ones referenced */
+    for(i=0;i<MESSAGE_INLINE_LEN;i++) {
+	smallData[i]=(UBYTE)i;
+    }
+    Message_setData(oneBuffer,smallData,MESSAGE_INLINE_LEN);
+    if((!Message_isInline(oneBuffer)) ||
+	(memcmp(Message_getData(oneBuffer),smallData,
+	MESSAGE_INLINE_LEN) != 0)) {
+	errorMsg="messageTest: small payload not carried inline";
+	return ERROR;
+    }
+    /* a payload already in the inline area may overlap */
+    Message_setData(oneBuffer,oneBuffer->inl+4,8);
+    if((Message_getData(oneBuffer) != oneBuffer->inl) ||
+	(memcmp(Message_getData(oneBuffer),smallData+4,8) != 0)) {
+	errorMsg="messageTest: overlapping payload not moved inline";
+	return ERROR;
+    }
+    Message_setData(oneBuffer,largeData,MAXDATA_VALUE);
+    if((Message_isInline(oneBuffer)) ||
+	(Message_getData(oneBuffer) != largeData)) {
+	errorMsg="messageTest: large payload not referenced";
+	return ERROR;
+    }
+
+    /* release must restore the buffer's own data body */
+    messageBuffers_release(oneBuffer);
+    oneBuffer=messageBuffers_allocate();
+    if(Message_getData(oneBuffer) != oneBuffer->inl) {
+	errorMsg="messageTest: release did not restore data body";
+	return ERROR;
+    }
+
     /* create a message queue */
     queue=Message_createQueue(TEST_QUEUE);
     if(queue < 0) {
@@ -10,6 +10,12 @@
 #include "message/messageBuffers.h"
 #include "msgHandler/msgHandler.h"
 #include "msgHandler/MSGHANDLERmessageAPIstatus.h"
+#include "msgHandler/MSGHANDLERextAPIstatus.h"
+#include "msgHandler/msgDispatch.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/DOMstats.h"
+#include "domTrace/domTrace.h"
+#include "msgHandler/msgSubscribe.h"
 	
 #define ERROR -1
 #define MAX_TYPE 255
@@ -22,8 +28,14 @@
 #define EC_QUEUE 3
 #define DA_QUEUE 4
 #define TM_QUEUE 5
+/* any slow control subtype, the test answers it */
+#define TEST_SUBTYPE 7
 
 void *msgHandlerThread(void *arg);
+extern void formatLong(ULONG value, UBYTE *buf);
+extern void formatShort(USHORT value, UBYTE *buf);
+extern USHORT unformatShort(UBYTE *buf);
+extern ULONG unformatLong(UBYTE *buf);
 
 /* storage */
 char *errorMsg;
@@ -34,39 +46,55 @@ int EC;
 int DA;
 int TM;
 
-/* packet driver counters, etc. */
-ULONG PKTrecv;
-ULONG PKTsent;
-ULONG NoStorage;
-ULONG FreeListCorrupt;
-ULONG PKTbufOvr;
-ULONG PKTbadFmt;
-ULONG PKTspare;
-
-ULONG MSGrecv;
-ULONG MSGsent;
-ULONG tooMuchData;
-ULONG IDMismatch;
-ULONG CRCproblem;
-
 pthread_mutex_t msgHandlerMutex=PTHREAD_MUTEX_INITIALIZER;
 
+/* a MSGHAND_GET_BUF_STATS reply, field by field */
+static void decodeBufStats(UBYTE *data, MSGBUF_STATS *s) {
+    int i;
+
+    s->totalCnt=unformatLong(&data[0]);
+    s->freeCnt=unformatLong(&data[4]);
+    s->lowWater=unformatLong(&data[8]);
+    s->allocCnt=unformatLong(&data[12]);
+    s->releaseCnt=unformatLong(&data[16]);
+    s->allocFail=unformatLong(&data[20]);
+    s->freeListCorrupt=unformatLong(&data[24]);
+    for(i=0;i<MSGBUF_OWNER_CNT;i++) {
+	s->census[i]=unformatLong(&data[28+4*i]);
+    }
+}
+
+/* send an empty MESSAGE_HANDLER request, wait for the reply */
+static MESSAGE_STRUCT *ask(MESSAGE_STRUCT *M, UBYTE subtype) {
+    Message_setType(M,MESSAGE_HANDLER);
+    Message_setSubtype(M,subtype);
+    Message_setDataLen(M,0);
+    Message_send(M,RD);
+    Message_receive(&M,SD);
+    return M;
+}
+
 /* test entry point */
 int msgHandlerTest() {
 
     /* storage */
     MESSAGE_STRUCT *oneBuffer;
     MESSAGE_STRUCT *twoBuffer;
+    MESSAGE_STRUCT *subBuffer;
+    MSGBUF_STATS before;
+    MSGBUF_STATS got;
     int i;
     int j;
     int k;
     int dataLen;
     int send;
     int receive;
+    UBYTE *data;
     pthread_t msgHandlerID;
 
-    /* init messageBuffers */
+    /* init messageBuffers and counters */
     messageBuffers_init();
+    DOMstats_init();
 
     /* create message queues for msgHandler */
     RD=Message_createQueue(RD_QUEUE);
@@ -105,6 +133,9 @@ int msgHandlerTest() {
 	return ERROR;
     }
 
+    msgSubscribe_addGroup(&pktStats);
+    msgSubscribe_addGroup(&msgStats);
+
     i=pthread_create(&msgHandlerID,NULL,msgHandler,0);
 
     /* allocate a buffer for use during tests */
@@ -136,6 +167,320 @@ int msgHandlerTest() {
 	    return ERROR;
     }
 
+    /* a request whose length disagrees with the catalog */
+    /*	is refused without running the handler */
+    Message_setType(twoBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(twoBuffer,GET_SERVICE_STATS);
+    Message_setDataLen(twoBuffer,3);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    if ((Message_getStatus(twoBuffer)!=
+	(SERVER_PROTOCOL_ERROR|WARNING_ERROR)) ||
+	(Message_dataLen(twoBuffer)!=0)) {
+
+   	    errorMsg="msgHandlerTest: bad length not refused";
+	    return ERROR;
+    }
+
+    /* unknown types are returned undeliverable */
+    Message_setType(twoBuffer,MAX_TYPE);
+    Message_setSubtype(twoBuffer,GET_SERVICE_STATE);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    if (Message_getStatus(twoBuffer)!=(UNKNOWN_SERVER|WARNING_ERROR)) {
+   	    errorMsg="msgHandlerTest: unknown type not rejected";
+	    return ERROR;
+    }
+
+    /* both refusals are kept as events, oldest first */
+    Message_setType(twoBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(twoBuffer,GET_SERVICE_EVENTS);
+    Message_setDataLen(twoBuffer,0);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    data=Message_getData(twoBuffer);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=GET_SERVICE_EVENTS_HDR_LEN+
+	2*GET_SERVICE_EVENT_REC_LEN) ||
+	(data[3]!=0) || (data[7]!=1) ||
+	(data[12]!=COMMON_Bad_Msg_Format) ||
+	(data[14]!=MESSAGE_HANDLER) || (data[15]!=GET_SERVICE_STATS) ||
+	(data[19]!=2) || (data[26]!=MAX_TYPE)) {
+
+   	    errorMsg="msgHandlerTest: error in GET_SERVICE_EVENTS";
+	    return ERROR;
+    }
+
+    /* compound request: two sub-requests, one reply */
+    data=Message_getData(twoBuffer);
+    data[0]=MESSAGE_HANDLER;
+    data[1]=GET_SERVICE_STATE;
+    data[2]=0;
+    data[3]=0;
+    data[4]=MESSAGE_HANDLER;
+    data[5]=GET_SERVICE_VERSION_INFO;
+    data[6]=0;
+    data[7]=0;
+    Message_setType(twoBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(twoBuffer,MSGHAND_COMPOUND);
+    Message_setDataLen(twoBuffer,8);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    data=Message_getData(twoBuffer);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=MSGHAND_COMPOUND_RSP_HDR_LEN+
+	2*MSGHAND_COMPOUND_RSP_ENTRY_LEN+GET_SERVICE_STATE_LEN+
+	GET_SERVICE_VERSION_INFO_LEN) ||
+	(data[1]!=2) || (data[3]!=GET_SERVICE_STATE) ||
+	(data[4]!=SUCCESS) || (data[6]!=GET_SERVICE_STATE_LEN) ||
+	(data[9]!=GET_SERVICE_VERSION_INFO)) {
+
+   	    errorMsg="msgHandlerTest: error in MSGHAND_COMPOUND";
+	    return ERROR;
+    }
+
+    /* an entry for a service is queued to it, and other */
+    /*	requests are routed while it is answered */
+    data=Message_getData(twoBuffer);
+    data[0]=MESSAGE_HANDLER;
+    data[1]=GET_SERVICE_STATE;
+    data[2]=0;
+    data[3]=0;
+    data[4]=DOM_SLOW_CONTROL;
+    data[5]=TEST_SUBTYPE;
+    data[6]=0;
+    data[7]=1;
+    data[8]=21;
+    Message_setType(twoBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(twoBuffer,MSGHAND_COMPOUND);
+    Message_setDataLen(twoBuffer,9);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&subBuffer,SC);
+    if ((Message_getType(subBuffer)!=DOM_SLOW_CONTROL) ||
+	(Message_getSubtype(subBuffer)!=TEST_SUBTYPE) ||
+	(Message_dataLen(subBuffer)!=1) ||
+	(Message_getData(subBuffer)[0]!=21) ||
+	!(subBuffer->head.hd.res[0]&MSG_DISPATCH_RETURN_FLAG)) {
+
+   	    errorMsg="msgHandlerTest: compound entry not queued";
+	    return ERROR;
+    }
+    oneBuffer=messageBuffers_allocate();
+    Message_setType(oneBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(oneBuffer,GET_SERVICE_STATE);
+    Message_setDataLen(oneBuffer,0);
+    Message_send(oneBuffer,RD);
+    receive=Message_receive(&oneBuffer,SD);
+    if ((Message_getSubtype(oneBuffer)!=GET_SERVICE_STATE) ||
+	(Message_getStatus(oneBuffer)!=SUCCESS)) {
+
+   	    errorMsg="msgHandlerTest: routing held by a compound request";
+	    return ERROR;
+    }
+    messageBuffers_release(oneBuffer);
+    /* answer as the service would */
+    Message_getData(subBuffer)[0]=42;
+    Message_setStatus(subBuffer,SUCCESS);
+    Message_send(subBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    data=Message_getData(twoBuffer);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=MSGHAND_COMPOUND_RSP_HDR_LEN+
+	2*MSGHAND_COMPOUND_RSP_ENTRY_LEN+GET_SERVICE_STATE_LEN+1) ||
+	(data[1]!=2) || (data[3]!=GET_SERVICE_STATE) ||
+	(data[8]!=DOM_SLOW_CONTROL) || (data[9]!=TEST_SUBTYPE) ||
+	(data[10]!=SUCCESS) || (data[12]!=1) || (data[13]!=42)) {
+
+   	    errorMsg="msgHandlerTest: error in queued compound entry";
+	    return ERROR;
+    }
+
+    /* a service reply that does not fit is listed without */
+    /*	its data, and nothing runs after it */
+    data[0]=DOM_SLOW_CONTROL;
+    data[1]=TEST_SUBTYPE;
+    data[2]=0;
+    data[3]=0;
+    data[4]=MESSAGE_HANDLER;
+    data[5]=GET_SERVICE_STATE;
+    data[6]=0;
+    data[7]=0;
+    Message_setType(twoBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(twoBuffer,MSGHAND_COMPOUND);
+    Message_setDataLen(twoBuffer,8);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&subBuffer,SC);
+    Message_setDataLen(subBuffer,MAXDATA_VALUE);
+    Message_setStatus(subBuffer,SUCCESS);
+    Message_send(subBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    data=Message_getData(twoBuffer);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=MSGHAND_COMPOUND_RSP_HDR_LEN+
+	MSGHAND_COMPOUND_RSP_ENTRY_LEN) ||
+	(data[1]!=1) || (data[2]!=DOM_SLOW_CONTROL) ||
+	(data[4]!=SUCCESS) ||
+	(unformatShort(&data[5])!=MSGHAND_COMPOUND_NO_REPLY)) {
+
+   	    errorMsg="msgHandlerTest: compound reply overflow not listed";
+	    return ERROR;
+    }
+
+    /* buffer pool telemetry: one buffer held here, the */
+    /*	request itself held by msgHandler */
+    oneBuffer=messageBuffers_allocate();
+    messageBuffers_getStats(&before);
+    twoBuffer=ask(twoBuffer,MSGHAND_GET_BUF_STATS);
+    decodeBufStats(Message_getData(twoBuffer),&got);
+    k=0;
+    for(i=0;i<MSGBUF_OWNER_CNT;i++) {
+	k+=got.census[i];
+    }
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=MSGHAND_GET_BUF_STATS_LEN) ||
+	(got.totalCnt!=before.totalCnt) || (got.freeCnt!=before.freeCnt) ||
+	(got.lowWater>got.freeCnt) || (got.allocCnt!=before.allocCnt) ||
+	(got.releaseCnt!=before.releaseCnt) || (got.allocFail!=0) ||
+	(got.freeListCorrupt!=0) || (k!=got.totalCnt) ||
+	(got.census[MSGBUF_OWNER_FREE]!=got.freeCnt) ||
+	(got.census[MSGBUF_OWNER_HANDLER]!=1) ||
+	(got.census[MSGBUF_OWNER_LINK_RX]!=
+	before.census[MSGBUF_OWNER_LINK_RX])) {
+
+   	    errorMsg="msgHandlerTest: error in MSGHAND_GET_BUF_STATS";
+	    return ERROR;
+    }
+
+    /* clearing resets the counters, not the census */
+    twoBuffer=ask(twoBuffer,MSGHAND_CLR_BUF_STATS);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=0)) {
+   	    errorMsg="msgHandlerTest: error in MSGHAND_CLR_BUF_STATS";
+	    return ERROR;
+    }
+    twoBuffer=ask(twoBuffer,MSGHAND_GET_BUF_STATS);
+    decodeBufStats(Message_getData(twoBuffer),&got);
+    if ((got.allocCnt!=0) || (got.releaseCnt!=0) ||
+	(got.allocFail!=0) || (got.freeListCorrupt!=0) ||
+	(got.lowWater!=got.freeCnt) || (got.freeCnt!=before.freeCnt) ||
+	(got.census[MSGBUF_OWNER_FREE]!=got.freeCnt) ||
+	(got.census[MSGBUF_OWNER_HANDLER]!=1) ||
+	(got.census[MSGBUF_OWNER_LINK_RX]!=
+	before.census[MSGBUF_OWNER_LINK_RX])) {
+
+   	    errorMsg="msgHandlerTest: MSGHAND_CLR_BUF_STATS cleared too much";
+	    return ERROR;
+    }
+
+    /* one owner record per buffer not free, the one held */
+    /*	here among them */
+    twoBuffer=ask(twoBuffer,MSGHAND_GET_BUF_OWNERS);
+    data=Message_getData(twoBuffer);
+    dataLen=Message_dataLen(twoBuffer);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(dataLen!=(got.totalCnt-got.freeCnt)*MSGHAND_BUF_OWNER_REC_LEN)) {
+   	    errorMsg="msgHandlerTest: error in MSGHAND_GET_BUF_OWNERS";
+	    return ERROR;
+    }
+    for(i=0;i<dataLen;i+=MSGHAND_BUF_OWNER_REC_LEN) {
+	if((data[i]==(UBYTE)messageBuffers_index(oneBuffer)) &&
+	    (data[i+1]==MSGBUF_OWNER_LINK_RX)) {
+	    break;
+	}
+    }
+    if(i>=dataLen) {
+   	    errorMsg="msgHandlerTest: held buffer not listed";
+	    return ERROR;
+    }
+    messageBuffers_release(oneBuffer);
+
+    /* a traced request gives one span per hop */
+    Message_setType(twoBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(twoBuffer,MSGHAND_TRACE);
+    Message_getData(twoBuffer)[0]=MSGHAND_TRACE_START;
+    Message_setDataLen(twoBuffer,1);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    Message_setSubtype(twoBuffer,GET_SERVICE_STATE);
+    Message_setDataLen(twoBuffer,0);
+    DOMTRACE_BEGIN(twoBuffer,DOMTRACE_LINK_RECV);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    DOMTRACE_END(twoBuffer,DOMTRACE_LINK_SENT);
+    Message_setSubtype(twoBuffer,MSGHAND_TRACE);
+    Message_getData(twoBuffer)[0]=MSGHAND_TRACE_DUMP;
+    Message_setDataLen(twoBuffer,1);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    data=Message_getData(twoBuffer);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=MSGHAND_TRACE_LEN) ||
+	(data[3]!=DOMTRACE_POINT_CNT-1)) {
+
+   	    errorMsg="msgHandlerTest: error in MSGHAND_TRACE";
+	    return ERROR;
+    }
+
+    /* subscribe to two counters, pushed every 10 msec */
+    data=Message_getData(twoBuffer);
+    formatShort(MSGHAND_SUBSCRIBE_MIN_PERIOD,&data[0]);
+    formatLong(0,&data[2]);
+    data[6]=MSGHAND_LANE_HIGH;
+    data[7]=2;
+    formatShort((0<<8)|PKT_RECV,&data[8]);
+    formatShort((1<<8)|MSG_RECV,&data[10]);
+    Message_setType(twoBuffer,MESSAGE_HANDLER);
+    Message_setSubtype(twoBuffer,MSGHAND_SUBSCRIBE);
+    Message_setDataLen(twoBuffer,MSGHAND_SUBSCRIBE_HDR_LEN+4);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(Message_dataLen(twoBuffer)!=MSGHAND_SUBSCRIBE_LEN)) {
+
+   	    errorMsg="msgHandlerTest: error in MSGHAND_SUBSCRIBE";
+	    return ERROR;
+    }
+    k=Message_getData(twoBuffer)[0];
+
+    /* the first push is a key push of the values, the */
+    /*	next one a zigzag delta */
+    STAT_ADD(&pktStats,PKT_RECV,5);
+    if((msgSubscribe_tick(1000)!=1) || (msgSubscribe_tick(1005)!=0)) {
+	errorMsg="msgHandlerTest: subscription not pushed on time";
+	return ERROR;
+    }
+    receive=Message_receive(&oneBuffer,SD);
+    data=Message_getData(oneBuffer);
+    if ((Message_getSubtype(oneBuffer)!=MSGHAND_SUBSCRIPTION_PUSH) ||
+	(Message_dataLen(oneBuffer)!=MSGHAND_PUSH_HDR_LEN+2) ||
+	(data[0]!=k) || (data[1]!=MSGHAND_PUSH_KEY) ||
+	(data[8]!=5) || (data[9]!=0)) {
+
+   	    errorMsg="msgHandlerTest: error in key push";
+	    return ERROR;
+    }
+    messageBuffers_release(oneBuffer);
+    STAT_ADD(&pktStats,PKT_RECV,-2);
+    msgSubscribe_tick(1010);
+    receive=Message_receive(&oneBuffer,SD);
+    data=Message_getData(oneBuffer);
+    if ((data[1]!=0) || (data[3]!=1) || (data[8]!=3) || (data[9]!=0)) {
+   	    errorMsg="msgHandlerTest: error in delta push";
+	    return ERROR;
+    }
+    messageBuffers_release(oneBuffer);
+
+    Message_setSubtype(twoBuffer,MSGHAND_UNSUBSCRIBE);
+    Message_setDataLen(twoBuffer,1);
+    Message_send(twoBuffer,RD);
+    receive=Message_receive(&twoBuffer,SD);
+    data=Message_getData(twoBuffer);
+    if ((Message_getStatus(twoBuffer)!=SUCCESS) ||
+	(data[3]!=2) || (msgSubscribe_tick(1020)!=0)) {
+   	    errorMsg="msgHandlerTest: error in MSGHAND_UNSUBSCRIBE";
+	    return ERROR;
+    }
+
     printf("type: %d\n",Message_getType(twoBuffer));
     printf("subtype: %d\n",Message_getSubtype(twoBuffer));
     printf("status: %d\n",Message_getStatus(twoBuffer));
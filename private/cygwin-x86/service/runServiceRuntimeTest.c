@@ -0,0 +1,14 @@
+/* runServiceRuntimeTest.c */
+
+#include "service/serviceRuntimeTest.h"
+	
+
+int main() {
+
+    int i;
+
+    i=serviceRuntimeTest();
+
+    printf("runServiceRuntimeTest: return status= %s\n",
+	serviceRuntimeTest_status());
+}
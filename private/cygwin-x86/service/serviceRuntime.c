@@ -0,0 +1,658 @@
+/* serviceRuntime.c */
+
+/* Service worker threads with work stealing and
+   suspended requests, see serviceRuntime.h */
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "msgHandler/msgDispatch.h"
+#include "service/serviceRuntime.h"
+#include "domTrace/domTrace.h"
+
+/* longest a worker sleeps before rescanning the queues,
+   covers messages queued without a notify */
+#define IDLE_WAIT_MSEC 10
+
+/* res[0] of an internal request carries this flag and
+   the high bits of its pending index, res[1] the rest.
+   Clear of MSG_DISPATCH_RETURN_FLAG while the index fits
+   in 12 bits. */
+#define INTERNAL_FLAG 0x80
+#define PENDING_NONE (-1)
+
+extern int RD;
+extern int SD;
+
+typedef struct {
+    SERVICE_DESC desc;
+    /* held while one of this service's messages is served */
+    pthread_mutex_t busy;
+    /* messages queued but not yet taken, approximate */
+    int pending;
+} SERVICE_SLOT;
+
+SERVICE_SLOT services[SERVICE_MAX];
+int serviceCnt=0;
+int workerCnt=0;
+pthread_t workerIDs[SERVICE_MAX_WORKERS];
+
+/* idle workers wait here for a notify */
+pthread_mutex_t idleMutex=PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t idleCond=PTHREAD_COND_INITIALIZER;
+/* bumped by every notify, so a worker that scanned
+   before a notify does not go to sleep on it */
+ULONG notifyGen=0;
+
+enum {
+    PEND_FREE,
+    PEND_WAITING,
+    PEND_READY
+};
+
+/* one suspended request */
+typedef struct {
+    int state;
+    ULONG gen;
+    int service;
+    MESSAGE_STRUCT *M;
+    SERVICE_CONT cont;
+    void *ctx;
+    void *result;
+    /* internal request in flight, 0 if none */
+    MESSAGE_STRUCT *sub;
+    /* place of its timeout in the timer heap, or
+       PENDING_NONE */
+    int timer;
+    /* free or ready list */
+    int next;
+} SERVICE_PENDING;
+
+typedef struct {
+    long long deadline;
+    int idx;
+} SERVICE_TIMER;
+
+/* pendMutex covers the pending table, its lists and the
+   timer heap.  A waiting entry has at most one timer,
+   removed when the entry leaves waiting, so the heap never
+   holds more than SERVICE_MAX_PENDING. */
+pthread_mutex_t pendMutex=PTHREAD_MUTEX_INITIALIZER;
+SERVICE_PENDING pending[SERVICE_MAX_PENDING];
+int pendFree=PENDING_NONE;
+int pendReadyHead=PENDING_NONE;
+int pendReadyTail=PENDING_NONE;
+SERVICE_TIMER timers[SERVICE_MAX_PENDING];
+int timerCnt=0;
+pthread_cond_t timerCond;
+pthread_t timerID;
+
+/* service of the request being handled on this thread */
+__thread int curService=-1;
+
+static long long nowUsec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+int serviceRuntime_register(SERVICE_DESC *desc)
+{
+    if(serviceCnt>=SERVICE_MAX) {
+	return -1;
+    }
+    services[serviceCnt].desc=*desc;
+    pthread_mutex_init(&services[serviceCnt].busy,NULL);
+    services[serviceCnt].pending=0;
+    serviceCnt++;
+    return 0;
+}
+
+static void wakeWorker(void)
+{
+    pthread_mutex_lock(&idleMutex);
+    notifyGen++;
+    pthread_cond_signal(&idleCond);
+    pthread_mutex_unlock(&idleMutex);
+}
+
+void serviceRuntime_notify(int queue)
+{
+    int i;
+
+    for(i=0;i<serviceCnt;i++) {
+	if(*services[i].desc.queue==queue) {
+	    __sync_fetch_and_add(&services[i].pending,1);
+	    break;
+	}
+    }
+    wakeWorker();
+}
+
+/* timer heap, ordered on deadline, pendMutex held.  Each
+   entry's pending slot knows where it is. */
+static void timerPlace(int i, SERVICE_TIMER t)
+{
+    timers[i]=t;
+    pending[t.idx].timer=i;
+}
+
+static void timerSift(int i, SERVICE_TIMER t)
+{
+    int parent;
+    int child;
+
+    while(i>0) {
+	parent=(i-1)/2;
+	if(timers[parent].deadline<=t.deadline) {
+	    break;
+	}
+	timerPlace(i,timers[parent]);
+	i=parent;
+    }
+    for(;;) {
+	child=2*i+1;
+	if(child>=timerCnt) {
+	    break;
+	}
+	if((child+1<timerCnt) &&
+	    (timers[child+1].deadline<timers[child].deadline)) {
+	    child++;
+	}
+	if(t.deadline<=timers[child].deadline) {
+	    break;
+	}
+	timerPlace(i,timers[child]);
+	i=child;
+    }
+    timerPlace(i,t);
+}
+
+static void timerPush(long long deadline, int idx)
+{
+    SERVICE_TIMER t;
+
+    t.deadline=deadline;
+    t.idx=idx;
+    timerSift(timerCnt++,t);
+}
+
+/* drop the timer at heap place i */
+static void timerRemove(int i)
+{
+    int idx=timers[i].idx;
+
+    timerCnt--;
+    if(i<timerCnt) {
+	timerSift(i,timers[timerCnt]);
+    }
+    pending[idx].timer=PENDING_NONE;
+}
+
+/* move a waiting entry to the ready list, pendMutex held.
+   gen and sub are checked unless 0.  Returns 0, or -1 if
+   the entry is no longer waiting for this. */
+static int makeReady(int idx, ULONG gen, MESSAGE_STRUCT *sub,
+    void *result)
+{
+    SERVICE_PENDING *p;
+
+    if((idx<0) || (idx>=SERVICE_MAX_PENDING)) {
+	return -1;
+    }
+    p=&pending[idx];
+    if((p->state!=PEND_WAITING) ||
+	((gen!=0) && (p->gen!=gen)) ||
+	((sub!=0) && (p->sub!=sub))) {
+	return -1;
+    }
+    if(p->timer!=PENDING_NONE) {
+	timerRemove(p->timer);
+    }
+    p->state=PEND_READY;
+    p->result=result;
+    p->next=PENDING_NONE;
+    if(pendReadyTail==PENDING_NONE) {
+	pendReadyHead=idx;
+    }
+    else {
+	pending[pendReadyTail].next=idx;
+    }
+    pendReadyTail=idx;
+    return 0;
+}
+
+/* suspend the current request M.  Returns the pending
+   index, or -1 outside a handler or if the table is full. */
+static int suspend(MESSAGE_STRUCT *M, SERVICE_CONT cont,
+    void *ctx, int timeoutMsec, MESSAGE_STRUCT *sub)
+{
+    SERVICE_PENDING *p;
+    int idx;
+
+    if(curService<0) {
+	return -1;
+    }
+    pthread_mutex_lock(&pendMutex);
+    idx=pendFree;
+    if(idx==PENDING_NONE) {
+	pthread_mutex_unlock(&pendMutex);
+	return -1;
+    }
+    p=&pending[idx];
+    pendFree=p->next;
+    p->state=PEND_WAITING;
+    /* never 0, so a gen of 0 means "any" in makeReady() */
+    if(++p->gen==0) {
+	p->gen=1;
+    }
+    p->service=curService;
+    p->M=M;
+    p->cont=cont;
+    p->ctx=ctx;
+    p->result=0;
+    p->sub=sub;
+    p->timer=PENDING_NONE;
+    if(timeoutMsec>0) {
+	timerPush(nowUsec()+(long long)timeoutMsec*1000,idx);
+	pthread_cond_signal(&timerCond);
+    }
+    pthread_mutex_unlock(&pendMutex);
+    return idx;
+}
+
+/* run a service's handlers on one message, returns the
+   message status */
+static UBYTE runService(SERVICE_SLOT *s, MESSAGE_STRUCT *M)
+{
+    COMMON_SERVICE_INFO *info=s->desc.info;
+    UBYTE status=0;
+
+    STAT_INC(&info->stats,SVC_MSG_RECEIVED);
+    curService=s-services;
+    if(s->desc.serve!=0) {
+	status=(*s->desc.serve)(M);
+    }
+    if(status==0) {
+	status=commonServices_serve(info,M);
+    }
+    curService=-1;
+    return status;
+}
+
+/* send the reply to a request that was handled, to the
+   service that asked with serviceRuntime_call(), back to
+   msgHandler, or to the DAQ */
+static void finishRequest(MESSAGE_STRUCT *M, UBYTE status)
+{
+    int idx;
+    int rc;
+
+    DOMTRACE(M,DOMTRACE_SERVICE_DONE);
+    Message_setStatus(M,status);
+    if(M->head.hd.res[0]&INTERNAL_FLAG) {
+	idx=((M->head.hd.res[0]&~INTERNAL_FLAG)<<8)|M->head.hd.res[1];
+	pthread_mutex_lock(&pendMutex);
+	rc=makeReady(idx,0,M,M);
+	pthread_mutex_unlock(&pendMutex);
+	if(rc!=0) {
+	    /* the caller gave up on it */
+	    messageBuffers_release(M);
+	    return;
+	}
+	wakeWorker();
+	return;
+    }
+    if(M->head.hd.res[0]&MSG_DISPATCH_RETURN_FLAG) {
+	/* an entry of a compound request */
+	messageBuffers_setOwner(M,MSGBUF_OWNER_HANDLER);
+	Message_send(M,RD);
+	return;
+    }
+
+    /* Sender will perform the free() on */
+    /* the data buffer. */
+    messageBuffers_setOwner(M,MSGBUF_OWNER_SD);
+    DOMTRACE(M,DOMTRACE_SD_ENQUEUE);
+    Message_send(M,SD);
+}
+
+/* answer one message for a service */
+static void serveMessage(SERVICE_SLOT *s, MESSAGE_STRUCT *M)
+{
+    UBYTE status;
+
+    messageBuffers_setOwner(M,s->desc.owner);
+    DOMTRACE(M,DOMTRACE_DISPATCH);
+    status=runService(s,M);
+    if(status!=SERVICE_SUSPENDED) {
+	finishRequest(M,status);
+    }
+}
+
+/* run one ready continuation whose service is free.
+   Returns TRUE if one was run. */
+static int runReady(void)
+{
+    SERVICE_PENDING p;
+    SERVICE_SLOT *s;
+    UBYTE status;
+    int idx;
+    int prev=PENDING_NONE;
+
+    pthread_mutex_lock(&pendMutex);
+    for(idx=pendReadyHead;idx!=PENDING_NONE;idx=pending[idx].next) {
+	s=&services[pending[idx].service];
+	if(pthread_mutex_trylock(&s->busy)==0) {
+	    break;
+	}
+	prev=idx;
+    }
+    if(idx==PENDING_NONE) {
+	pthread_mutex_unlock(&pendMutex);
+	return FALSE;
+    }
+    /* unlink and free the entry before running it, the
+       continuation may suspend again */
+    if(prev==PENDING_NONE) {
+	pendReadyHead=pending[idx].next;
+    }
+    else {
+	pending[prev].next=pending[idx].next;
+    }
+    if(pendReadyTail==idx) {
+	pendReadyTail=prev;
+    }
+    p=pending[idx];
+    pending[idx].state=PEND_FREE;
+    pending[idx].sub=0;
+    pending[idx].next=pendFree;
+    pendFree=idx;
+    pthread_mutex_unlock(&pendMutex);
+
+    curService=p.service;
+    status=(*p.cont)(p.M,p.ctx,p.result);
+    curService=-1;
+    if((p.sub!=0) && (p.result!=0)) {
+	/* the reply to serviceRuntime_call() */
+	messageBuffers_release(p.sub);
+    }
+    if(status!=SERVICE_SUSPENDED) {
+	finishRequest(p.M,status);
+    }
+    pthread_mutex_unlock(&s->busy);
+    return TRUE;
+}
+
+/* expires timers and timeouts */
+static void *serviceTimer(void *arg)
+{
+    struct timespec until;
+    long long now;
+    int fired;
+
+    pthread_mutex_lock(&pendMutex);
+    for(;;) {
+	now=nowUsec();
+	fired=FALSE;
+	while((timerCnt>0) && (timers[0].deadline<=now)) {
+	    /* takes the timer off the heap */
+	    if(makeReady(timers[0].idx,0,0,0)==0) {
+		fired=TRUE;
+	    }
+	    else {
+		timerRemove(0);
+	    }
+	}
+	if(fired) {
+	    pthread_mutex_unlock(&pendMutex);
+	    wakeWorker();
+	    pthread_mutex_lock(&pendMutex);
+	    continue;
+	}
+	if(timerCnt==0) {
+	    pthread_cond_wait(&timerCond,&pendMutex);
+	    continue;
+	}
+	until.tv_sec=timers[0].deadline/1000000;
+	until.tv_nsec=(timers[0].deadline%1000000)*1000;
+	pthread_cond_timedwait(&timerCond,&pendMutex,&until);
+    }
+    return 0;
+}
+
+UBYTE serviceRuntime_call(MESSAGE_STRUCT *M, int queue,
+    UBYTE type, UBYTE subtype, UBYTE *args, int len,
+    int timeoutMsec, SERVICE_CONT cont, void *ctx)
+{
+    MESSAGE_STRUCT *sub;
+    int idx;
+    int rc;
+
+    if((len<0) || (len>MAXDATA_VALUE)) {
+	return SERVER_PROTOCOL_ERROR|WARNING_ERROR;
+    }
+    sub=messageBuffers_allocate();
+    if(sub==0) {
+	return SERVER_STACK_FULL|SEVERE_ERROR;
+    }
+    Message_setType(sub,type);
+    Message_setSubtype(sub,subtype);
+    Message_setStatus(sub,0);
+    memcpy(Message_getData(sub),args,len);
+    Message_setDataLen(sub,len);
+    /* traced as a request that starts at routing */
+    DOMTRACE_BEGIN(sub,DOMTRACE_RD_DEQUEUE);
+
+    idx=suspend(M,cont,ctx,timeoutMsec,sub);
+    if(idx<0) {
+	messageBuffers_release(sub);
+	return SERVER_STACK_FULL|SEVERE_ERROR;
+    }
+    sub->head.hd.res[0]=INTERNAL_FLAG|(UBYTE)(idx>>8);
+    sub->head.hd.res[1]=(UBYTE)(idx&0xff);
+
+    if(Message_send(sub,queue)<0) {
+	/* continue at once, as after a timeout */
+	pthread_mutex_lock(&pendMutex);
+	rc=makeReady(idx,0,sub,0);
+	pthread_mutex_unlock(&pendMutex);
+	if(rc==0) {
+	    messageBuffers_release(sub);
+	    wakeWorker();
+	}
+	return SERVICE_SUSPENDED;
+    }
+    serviceRuntime_notify(queue);
+    return SERVICE_SUSPENDED;
+}
+
+UBYTE serviceRuntime_after(MESSAGE_STRUCT *M, int msec,
+    SERVICE_CONT cont, void *ctx)
+{
+    if(suspend(M,cont,ctx,(msec>0) ? msec : 1,0)<0) {
+	return SERVER_STACK_FULL|SEVERE_ERROR;
+    }
+    return SERVICE_SUSPENDED;
+}
+
+SERVICE_WAIT serviceRuntime_wait(MESSAGE_STRUCT *M,
+    int timeoutMsec, SERVICE_CONT cont, void *ctx)
+{
+    int idx=suspend(M,cont,ctx,timeoutMsec,0);
+
+    if(idx<0) {
+	return -1;
+    }
+    /* low bits index, the rest a check on the generation */
+    return (SERVICE_WAIT)((pending[idx].gen&0x7ffff)<<12)|idx;
+}
+
+int serviceRuntime_wake(SERVICE_WAIT w, void *result)
+{
+    int idx=w&(SERVICE_MAX_PENDING-1);
+    ULONG genBits=((ULONG)w>>12)&0x7ffff;
+    int rc=-1;
+
+    if(w<0) {
+	return -1;
+    }
+    pthread_mutex_lock(&pendMutex);
+    if((pending[idx].gen&0x7ffff)==genBits) {
+	rc=makeReady(idx,pending[idx].gen,0,result);
+    }
+    pthread_mutex_unlock(&pendMutex);
+    if(rc==0) {
+	wakeWorker();
+    }
+    return rc;
+}
+
+/* serve one message from service s if nobody else is
+   serving it.  Returns TRUE if a message was served. */
+static int serveOne(SERVICE_SLOT *s)
+{
+    MESSAGE_STRUCT *M;
+    int served=FALSE;
+
+    if(pthread_mutex_trylock(&s->busy)!=0) {
+	return FALSE;
+    }
+    if(Message_receive_nonblock(&M,*s->desc.queue)>0) {
+	if(s->pending>0) {
+	    __sync_fetch_and_sub(&s->pending,1);
+	}
+	serveMessage(s,M);
+	served=TRUE;
+    }
+    pthread_mutex_unlock(&s->busy);
+    return served;
+}
+
+static void *serviceWorker(void *arg)
+{
+    int id=(int)(long)arg;
+    int i;
+    int best;
+    int tried;
+    int served;
+    ULONG gen;
+    struct timespec until;
+
+    for(;;) {
+	served=FALSE;
+	pthread_mutex_lock(&idleMutex);
+	gen=notifyGen;
+	pthread_mutex_unlock(&idleMutex);
+
+	/* resumed requests go ahead of new ones */
+	if(runReady()) {
+	    continue;
+	}
+
+	/* home services are those with index == id
+	   modulo the worker count */
+	for(i=id;i<serviceCnt;i+=workerCnt) {
+	    served|=serveOne(&services[i]);
+	}
+	if(served) {
+	    continue;
+	}
+
+	/* steal: take the service with the most pending
+	   messages that no other worker is serving, the
+	   next one down if it is held */
+	tried=0;
+	for(;;) {
+	    best=-1;
+	    for(i=0;i<serviceCnt;i++) {
+		if((services[i].pending>0) && !(tried&(1<<i)) &&
+		    ((best<0) ||
+		    (services[i].pending>services[best].pending))) {
+		    best=i;
+		}
+	    }
+	    if(best<0) {
+		break;
+	    }
+	    if(serveOne(&services[best])) {
+		served=TRUE;
+		break;
+	    }
+	    tried|=1<<best;
+	}
+	if(served) {
+	    continue;
+	}
+
+	/* idle, wait for a notify or rescan after a while */
+	pthread_mutex_lock(&idleMutex);
+	clock_gettime(CLOCK_REALTIME,&until);
+	until.tv_nsec+=IDLE_WAIT_MSEC*1000000L;
+	if(until.tv_nsec>=1000000000L) {
+	    until.tv_sec++;
+	    until.tv_nsec-=1000000000L;
+	}
+	if(gen==notifyGen) {
+	    pthread_cond_timedwait(&idleCond,&idleMutex,&until);
+	}
+	pthread_mutex_unlock(&idleMutex);
+    }
+    return 0;
+}
+
+/* build the pending free list and start the timer */
+static int pendingInit(void)
+{
+    pthread_condattr_t attr;
+    int i;
+
+    for(i=0;i<SERVICE_MAX_PENDING;i++) {
+	pending[i].state=PEND_FREE;
+	pending[i].gen=0;
+	pending[i].timer=PENDING_NONE;
+	pending[i].next=(i+1<SERVICE_MAX_PENDING) ? i+1 : PENDING_NONE;
+    }
+    pendFree=0;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr,CLOCK_MONOTONIC);
+    pthread_cond_init(&timerCond,&attr);
+    pthread_condattr_destroy(&attr);
+    if(pthread_create(&timerID,NULL,serviceTimer,0)!=0) {
+	return -1;
+    }
+    return 0;
+}
+
+int serviceRuntime_start(int nWorkers)
+{
+    int i;
+
+    if(pendingInit()!=0) {
+	return 0;
+    }
+
+    if(nWorkers<1) {
+	nWorkers=1;
+    }
+    if(nWorkers>SERVICE_MAX_WORKERS) {
+	nWorkers=SERVICE_MAX_WORKERS;
+    }
+    workerCnt=nWorkers;
+    for(i=0;i<nWorkers;i++) {
+	if(pthread_create(&workerIDs[i],NULL,serviceWorker,
+	    (void *)(long)i)!=0) {
+	    workerCnt=i;
+	    break;
+	}
+    }
+    return workerCnt;
+}
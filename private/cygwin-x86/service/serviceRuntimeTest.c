@@ -0,0 +1,285 @@
+/* serviceRuntimeTest.c */
+
+#include <pthread.h>
+#include <unistd.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "msgHandler/msgDispatch.h"
+#include "service/serviceRuntime.h"
+#include "service/serviceRuntimeTest.h"
+
+#define ERROR -1
+#define RD_QUEUE 20
+#define SD_QUEUE 21
+#define FRONT_QUEUE 22
+#define BACK_QUEUE 23
+#define TEST_WORKERS 2
+#define TEST_REQUESTS 6
+#define TEST_SLOW_MSEC 50
+#define TEST_TIMEOUT_MSEC 20
+/* res[1] of the requests sent */
+#define TEST_RES 5
+
+/* front service subtypes */
+#define TEST_ASK 50
+#define TEST_WAIT 52
+#define TEST_TIMEOUT 53
+#define TEST_ASK_FAST 54
+/* back service subtypes */
+#define TEST_SLOW 51
+#define TEST_FAST 55
+/* calls answered long before their timeout, more than
+   there are pending entries, TEST_BATCH at a time */
+#define TEST_FAST_CALLS (SERVICE_MAX_PENDING+SERVICE_MAX_PENDING/2)
+#define TEST_BATCH 4
+#define TEST_LONG_MSEC 60000
+
+/* storage */
+char *errorMsg;
+int RD;
+int SD;
+int FRONT;
+int BACK;
+COMMON_SERVICE_INFO frontInfo;
+COMMON_SERVICE_INFO backInfo;
+volatile SERVICE_WAIT waitToken=-1;
+int inFlight=0;
+int maxInFlight=0;
+/* timeouts waiting in serviceRuntime.c */
+extern int timerCnt;
+
+/* back: answer with twice the argument, after a while */
+static UBYTE slowDone(MESSAGE_STRUCT *M, void *ctx, void *result) {
+    Message_getData(M)[0]*=2;
+    __sync_fetch_and_sub(&inFlight,1);
+    return SUCCESS;
+}
+
+static UBYTE backServe(MESSAGE_STRUCT *M) {
+    int n;
+
+    if(Message_getSubtype(M)==TEST_FAST) {
+	Message_getData(M)[0]*=2;
+	return SUCCESS;
+    }
+    if(Message_getSubtype(M)!=TEST_SLOW) {
+	return 0;
+    }
+    n=__sync_add_and_fetch(&inFlight,1);
+    if(n>maxInFlight) {
+	maxInFlight=n;
+    }
+    return serviceRuntime_after(M,TEST_SLOW_MSEC,slowDone,0);
+}
+
+/* front: ask back, add one to its answer */
+static UBYTE askDone(MESSAGE_STRUCT *M, void *ctx, void *result) {
+    MESSAGE_STRUCT *reply=(MESSAGE_STRUCT *)result;
+
+    if((reply==0) || (Message_getStatus(reply)!=SUCCESS)) {
+	Message_setDataLen(M,0);
+	return DATA_NOT_FOUND|WARNING_ERROR;
+    }
+    Message_getData(M)[0]=Message_getData(reply)[0]+1;
+    Message_setDataLen(M,1);
+    return SUCCESS;
+}
+
+static UBYTE waitDone(MESSAGE_STRUCT *M, void *ctx, void *result) {
+    if(result==0) {
+	Message_setDataLen(M,0);
+	return SUCCESS;
+    }
+    Message_getData(M)[0]=*(UBYTE *)result;
+    Message_setDataLen(M,1);
+    return SUCCESS;
+}
+
+static UBYTE frontServe(MESSAGE_STRUCT *M) {
+    SERVICE_WAIT w;
+
+    switch(Message_getSubtype(M)) {
+	case TEST_ASK:
+	    return serviceRuntime_call(M,BACK,DOM_SLOW_CONTROL,TEST_SLOW,
+		Message_getData(M),1,1000,askDone,0);
+	case TEST_ASK_FAST:
+	    return serviceRuntime_call(M,BACK,DOM_SLOW_CONTROL,TEST_FAST,
+		Message_getData(M),1,TEST_LONG_MSEC,askDone,0);
+	case TEST_WAIT:
+	    w=serviceRuntime_wait(M,0,waitDone,0);
+	    if(w<0) {
+		return SERVER_STACK_FULL|SEVERE_ERROR;
+	    }
+	    waitToken=w;
+	    return SERVICE_SUSPENDED;
+	case TEST_TIMEOUT:
+	    if(serviceRuntime_wait(M,TEST_TIMEOUT_MSEC,waitDone,0)<0) {
+		return SERVER_STACK_FULL|SEVERE_ERROR;
+	    }
+	    return SERVICE_SUSPENDED;
+	default:
+	    return 0;
+    }
+}
+
+SERVICE_DESC testServices[] = {
+    {"front", &FRONT, &frontInfo, frontServe, MSGBUF_OWNER_EC},
+    {"back", &BACK, &backInfo, backServe, MSGBUF_OWNER_SC},
+};
+
+/* send one request to front, res[0] as given */
+static int request(UBYTE subtype, UBYTE arg, UBYTE res) {
+    MESSAGE_STRUCT *M=messageBuffers_allocate();
+
+    if(M==0) {
+	return ERROR;
+    }
+    M->head.hd.res[0]=res;
+    M->head.hd.res[1]=TEST_RES;
+    Message_setType(M,EXPERIMENT_CONTROL);
+    Message_setSubtype(M,subtype);
+    Message_getData(M)[0]=arg;
+    Message_setDataLen(M,1);
+    Message_send(M,FRONT);
+    serviceRuntime_notify(FRONT);
+    return 0;
+}
+
+/* test entry point */
+int serviceRuntimeTest() {
+    MESSAGE_STRUCT *M;
+    UBYTE value=77;
+    int seen[TEST_REQUESTS];
+    int i;
+    int x;
+
+    messageBuffers_init();
+    DOMstats_init();
+
+    RD=Message_createQueue(RD_QUEUE);
+    SD=Message_createQueue(SD_QUEUE);
+    FRONT=Message_createQueue(FRONT_QUEUE);
+    BACK=Message_createQueue(BACK_QUEUE);
+    if((RD<0) || (SD<0) || (FRONT<0) || (BACK<0)) {
+	errorMsg="serviceRuntimeTest: cannot create message queues";
+	return ERROR;
+    }
+
+    for(i=0;i<2;i++) {
+	commonServices_init(testServices[i].info,0,1);
+	serviceRuntime_register(&testServices[i]);
+    }
+    if(serviceRuntime_start(TEST_WORKERS)!=TEST_WORKERS) {
+	errorMsg="serviceRuntimeTest: cannot start workers";
+	return ERROR;
+    }
+
+    /* each request waits on back's timer, none of them
+       holds a worker while it waits */
+    for(i=0;i<TEST_REQUESTS;i++) {
+	seen[i]=FALSE;
+	if(request(TEST_ASK,(UBYTE)i,0)!=0) {
+	    errorMsg="serviceRuntimeTest: unable to allocate message buffer";
+	    return ERROR;
+	}
+    }
+    for(i=0;i<TEST_REQUESTS;i++) {
+	Message_receive(&M,SD);
+	x=(Message_getData(M)[0]-1)/2;
+	if((Message_getStatus(M)!=SUCCESS) || (Message_dataLen(M)!=1) ||
+	    (x<0) || (x>=TEST_REQUESTS) || seen[x]) {
+	    errorMsg="serviceRuntimeTest: bad reply to a call";
+	    return ERROR;
+	}
+	seen[x]=TRUE;
+	messageBuffers_release(M);
+    }
+    if(maxInFlight<=TEST_WORKERS) {
+	errorMsg="serviceRuntimeTest: suspended requests held workers";
+	return ERROR;
+    }
+
+    /* completion from another thread */
+    if(request(TEST_WAIT,0,0)!=0) {
+	errorMsg="serviceRuntimeTest: unable to allocate message buffer";
+	return ERROR;
+    }
+    while(waitToken<0) {
+	usleep(1000);
+    }
+    if(serviceRuntime_wake(waitToken,&value)!=0) {
+	errorMsg="serviceRuntimeTest: wake refused";
+	return ERROR;
+    }
+    Message_receive(&M,SD);
+    if((Message_getStatus(M)!=SUCCESS) || (Message_dataLen(M)!=1) ||
+	(Message_getData(M)[0]!=value)) {
+	errorMsg="serviceRuntimeTest: bad reply after wake";
+	return ERROR;
+    }
+    messageBuffers_release(M);
+    if(serviceRuntime_wake(waitToken,&value)==0) {
+	errorMsg="serviceRuntimeTest: stale wake accepted";
+	return ERROR;
+    }
+
+    /* a wait nobody completes times out */
+    if(request(TEST_TIMEOUT,0,0)!=0) {
+	errorMsg="serviceRuntimeTest: unable to allocate message buffer";
+	return ERROR;
+    }
+    Message_receive(&M,SD);
+    if((Message_getStatus(M)!=SUCCESS) || (Message_dataLen(M)!=0)) {
+	errorMsg="serviceRuntimeTest: bad reply after timeout";
+	return ERROR;
+    }
+    messageBuffers_release(M);
+
+    /* a request msgHandler sent on its own behalf is
+       answered back to RD, even after a call */
+    if(request(TEST_ASK,3,MSG_DISPATCH_RETURN_FLAG)!=0) {
+	errorMsg="serviceRuntimeTest: unable to allocate message buffer";
+	return ERROR;
+    }
+    Message_receive(&M,RD);
+    if((Message_getStatus(M)!=SUCCESS) || (Message_dataLen(M)!=1) ||
+	(Message_getData(M)[0]!=7) || (M->head.hd.res[1]!=TEST_RES)) {
+	errorMsg="serviceRuntimeTest: reply not returned to RD";
+	return ERROR;
+    }
+    messageBuffers_release(M);
+
+    /* a call answered early takes its timeout with it */
+    for(i=0;i<TEST_FAST_CALLS;i+=TEST_BATCH) {
+	for(x=0;x<TEST_BATCH;x++) {
+	    if(request(TEST_ASK_FAST,(UBYTE)x,0)!=0) {
+		errorMsg="serviceRuntimeTest: unable to allocate message buffer";
+		return ERROR;
+	    }
+	}
+	for(x=0;x<TEST_BATCH;x++) {
+	    Message_receive(&M,SD);
+	    if((Message_getStatus(M)!=SUCCESS) || (Message_dataLen(M)!=1) ||
+		!(Message_getData(M)[0]&1)) {
+		errorMsg="serviceRuntimeTest: bad reply to a fast call";
+		return ERROR;
+	    }
+	    messageBuffers_release(M);
+	}
+    }
+    if(timerCnt!=0) {
+	errorMsg="serviceRuntimeTest: timeouts left after their calls";
+	return ERROR;
+    }
+
+    errorMsg="serviceRuntimeTest: success";
+    return 0;
+}
+
+char *serviceRuntimeTest_status() {
+    return errorMsg;
+}
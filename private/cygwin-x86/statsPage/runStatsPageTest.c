@@ -0,0 +1,14 @@
+/* runStatsPageTest.c */
+
+#include "statsPage/statsPageTest.h"
+	
+
+int main() {
+
+    int i;
+
+    i=statsPageTest();
+
+    printf("runStatsPageTest: return status= %s\n",
+	statsPageTest_status());
+}
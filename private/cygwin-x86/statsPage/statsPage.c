@@ -0,0 +1,174 @@
+/* statsPage.c */
+
+/* Live statistics page publisher, see statsPage.h */
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "statsPage/statsPage.h"
+
+STATS_PAGE *statsPage=0;
+
+/* what to publish */
+const char *pageServiceName[STATS_PAGE_MAX_SERVICES];
+COMMON_SERVICE_INFO *pageServiceInfo[STATS_PAGE_MAX_SERVICES];
+int pageServiceCnt=0;
+const char *pageQueueName[STATS_PAGE_MAX_QUEUES];
+int *pageQueue[STATS_PAGE_MAX_QUEUES];
+int pageQueueCnt=0;
+
+ULONG pagePeriodUsec=STATS_PAGE_PERIOD_USEC;
+pthread_t pageThreadID;
+
+int statsPage_create()
+{
+    int fd;
+
+    fd=shm_open(STATS_PAGE_NAME,O_RDWR|O_CREAT,0644);
+    if(fd<0) {
+	return -1;
+    }
+    if(ftruncate(fd,sizeof(STATS_PAGE))<0) {
+	close(fd);
+	return -1;
+    }
+    statsPage=(STATS_PAGE *)mmap(0,sizeof(STATS_PAGE),
+	PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+    close(fd);
+    if(statsPage==(STATS_PAGE *)MAP_FAILED) {
+	statsPage=0;
+	return -1;
+    }
+
+    /* readers ignore the page until magic is set last */
+    statsPage->magic=0;
+    __sync_synchronize();
+    memset(statsPage,0,sizeof(STATS_PAGE));
+    statsPage->version=STATS_PAGE_VERSION;
+    statsPage->size=sizeof(STATS_PAGE);
+    __sync_synchronize();
+    statsPage->magic=STATS_PAGE_MAGIC;
+    return 0;
+}
+
+int statsPage_addService(const char *name, COMMON_SERVICE_INFO *info)
+{
+    if(pageServiceCnt>=STATS_PAGE_MAX_SERVICES) {
+	return -1;
+    }
+    pageServiceName[pageServiceCnt]=name;
+    pageServiceInfo[pageServiceCnt]=info;
+    pageServiceCnt++;
+    return 0;
+}
+
+int statsPage_addQueue(const char *name, int *queue)
+{
+    if(pageQueueCnt>=STATS_PAGE_MAX_QUEUES) {
+	return -1;
+    }
+    pageQueueName[pageQueueCnt]=name;
+    pageQueue[pageQueueCnt]=queue;
+    pageQueueCnt++;
+    return 0;
+}
+
+static ULONG usecNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (ULONG)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+static ULONG queueDepth(int queue)
+{
+    struct msqid_ds ds;
+
+    if(msgctl(queue,IPC_STAT,&ds)<0) {
+	return 0;
+    }
+    return ds.msg_qnum;
+}
+
+void statsPage_publish()
+{
+    STATS_PAGE *p=statsPage;
+    STATS_PAGE_SERVICE *s;
+    COMMON_SERVICE_INFO *info;
+    int i;
+
+    if(p==0) {
+	return;
+    }
+
+    p->seq++;
+    __sync_synchronize();
+
+    p->updateCnt++;
+    p->timeUsec=usecNow();
+    statCounters_snapshot(&pktStats,p->pkt);
+    statCounters_snapshot(&msgStats,p->msg);
+    statCounters_snapshot(&ovflStats,p->ovfl);
+    messageBuffers_getStats(&p->pool);
+
+    p->serviceCnt=pageServiceCnt;
+    for(i=0;i<pageServiceCnt;i++) {
+	s=&p->service[i];
+	info=pageServiceInfo[i];
+	strncpy(s->name,pageServiceName[i],STATS_PAGE_NAME_LEN-1);
+	s->state=info->state;
+	s->lastErrorID=info->lastErrorID;
+	s->lastErrorSeverity=info->lastErrorSeverity;
+	s->majorVersion=info->majorVersion;
+	s->minorVersion=info->minorVersion;
+	statCounters_snapshot(&info->stats,s->stats);
+	strncpy(s->lastErrorStr,
+	    commonServices_errorStr(info,s->lastErrorID),
+	    MAX_ERROR_STR_LEN-1);
+	s->lastErrorStr[MAX_ERROR_STR_LEN-1]=0;
+    }
+
+    p->queueCnt=pageQueueCnt;
+    for(i=0;i<pageQueueCnt;i++) {
+	strncpy(p->queue[i].name,pageQueueName[i],STATS_PAGE_NAME_LEN-1);
+	p->queue[i].depth=queueDepth(*pageQueue[i]);
+    }
+
+    __sync_synchronize();
+    p->seq++;
+}
+
+static void *statsPageThread(void *arg)
+{
+    struct timespec period;
+
+    period.tv_sec=pagePeriodUsec/1000000;
+    period.tv_nsec=(pagePeriodUsec%1000000)*1000;
+    for(;;) {
+	statsPage_publish();
+	nanosleep(&period,0);
+    }
+    return 0;
+}
+
+int statsPage_start(ULONG periodUsec)
+{
+    if(statsPage==0) {
+	return -1;
+    }
+    if(periodUsec>0) {
+	pagePeriodUsec=periodUsec;
+    }
+    return pthread_create(&pageThreadID,NULL,statsPageThread,0);
+}
@@ -0,0 +1,78 @@
+/* statsPageReader.c */
+
+/* Reader side of the live statistics page, for local
+   monitoring agents.  See statsPage.h */
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "statsPage/statsPage.h"
+
+/* give up after this many torn reads in a row, waiting
+   this long between them for the writer to finish */
+#define MAX_READ_TRIES 1000
+#define READ_RETRY_NSEC 10000
+
+const STATS_PAGE *statsPage_attach()
+{
+    int fd;
+    const STATS_PAGE *page;
+
+    fd=shm_open(STATS_PAGE_NAME,O_RDONLY,0);
+    if(fd<0) {
+	return 0;
+    }
+    page=(const STATS_PAGE *)mmap(0,sizeof(STATS_PAGE),PROT_READ,
+	MAP_SHARED,fd,0);
+    close(fd);
+    if(page==(const STATS_PAGE *)MAP_FAILED) {
+	return 0;
+    }
+
+    /* refuse a page written by a different layout */
+    if((page->magic!=STATS_PAGE_MAGIC) ||
+	(page->version!=STATS_PAGE_VERSION) ||
+	(page->size!=sizeof(STATS_PAGE))) {
+	munmap((void *)page,sizeof(STATS_PAGE));
+	return 0;
+    }
+    return page;
+}
+
+void statsPage_detach(const STATS_PAGE *page)
+{
+    munmap((void *)page,sizeof(STATS_PAGE));
+}
+
+int statsPage_read(const STATS_PAGE *page, STATS_PAGE *copy)
+{
+    struct timespec pause;
+    ULONG seq;
+    int tries;
+
+    pause.tv_sec=0;
+    pause.tv_nsec=READ_RETRY_NSEC;
+    for(tries=0;tries<MAX_READ_TRIES;tries++) {
+	if(tries>0) {
+	    nanosleep(&pause,0);
+	}
+	seq=page->seq;
+	if(seq&1) {
+	    continue;
+	}
+	__sync_synchronize();
+	memcpy(copy,(const void *)page,sizeof(STATS_PAGE));
+	__sync_synchronize();
+	if(seq==page->seq) {
+	    return 0;
+	}
+    }
+    return -1;
+}
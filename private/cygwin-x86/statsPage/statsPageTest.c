@@ -0,0 +1,136 @@
+/* statsPageTest.c */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "statsPage/statsPage.h"
+#include "statsPage/statsPageTest.h"
+
+#define ERROR -1
+#define TEST_PUBLISHES 20000
+
+/* storage */
+char *errorMsg;
+extern STATS_PAGE *statsPage;
+COMMON_SERVICE_INFO testService;
+const STATS_PAGE *testPage;
+volatile int testWriting;
+/* what the reader thread saw */
+long testReads;
+long testTorn;
+long testFailed;
+
+static int fail(char *msg) {
+    errorMsg=msg;
+    if(testPage!=0) {
+	statsPage_detach(testPage);
+    }
+    shm_unlink(STATS_PAGE_NAME);
+    return ERROR;
+}
+
+/* read while the page is published, every copy checked:
+   the writer counts a receive before each publish, so a
+   whole copy has seq, updateCnt and the count agreeing */
+static void *readerThread(void *arg) {
+    static STATS_PAGE copy;
+
+    while(testWriting) {
+	if(statsPage_read(testPage,&copy)<0) {
+	    testFailed++;
+	    continue;
+	}
+	testReads++;
+	if((copy.seq&1) || (copy.seq!=2*copy.updateCnt) ||
+	    (copy.serviceCnt!=1) ||
+	    (copy.service[0].stats[SVC_MSG_RECEIVED]!=copy.updateCnt)) {
+	    testTorn++;
+	}
+    }
+    return 0;
+}
+
+/* attach with one layout field of the page changed, TRUE
+   if it is refused */
+static int refused(ULONG *field, ULONG bad) {
+    const STATS_PAGE *page;
+    ULONG good=*field;
+
+    *field=bad;
+    page=statsPage_attach();
+    *field=good;
+    if(page!=0) {
+	statsPage_detach(page);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/* test entry point */
+int statsPageTest() {
+    pthread_t reader;
+    int i;
+
+    shm_unlink(STATS_PAGE_NAME);
+    testPage=0;
+    statCounters_init(&testService.stats,"test",SVC_STATS_CNT);
+    if((statsPage_create()<0) ||
+	(statsPage_addService("test",&testService)<0)) {
+	return fail("statsPageTest: cannot create page");
+    }
+    testPage=statsPage_attach();
+    if(testPage==0) {
+	return fail("statsPageTest: cannot attach page");
+    }
+
+    /* publish under a reader copying as fast as it can,
+       once first so it never sees the empty page */
+    STAT_INC(&testService.stats,SVC_MSG_RECEIVED);
+    statsPage_publish();
+    testWriting=TRUE;
+    if(pthread_create(&reader,NULL,readerThread,0)!=0) {
+	return fail("statsPageTest: cannot start reader");
+    }
+    for(i=1;i<TEST_PUBLISHES;i++) {
+	STAT_INC(&testService.stats,SVC_MSG_RECEIVED);
+	statsPage_publish();
+    }
+    testWriting=FALSE;
+    pthread_join(reader,NULL);
+    if(testTorn!=0) {
+	return fail("statsPageTest: torn copy read");
+    }
+    if((testReads==0) || (testFailed!=0)) {
+	return fail("statsPageTest: reader gave up");
+    }
+    if((testPage->updateCnt!=TEST_PUBLISHES) ||
+	(testPage->seq!=2*TEST_PUBLISHES)) {
+	return fail("statsPageTest: error in published page");
+    }
+
+    /* a page of another layout is not attached */
+    if(!refused(&statsPage->magic,~STATS_PAGE_MAGIC) ||
+	!refused(&statsPage->version,STATS_PAGE_VERSION+1) ||
+	!refused(&statsPage->size,sizeof(STATS_PAGE)-1)) {
+	return fail("statsPageTest: other layout attached");
+    }
+    if(refused(&statsPage->magic,STATS_PAGE_MAGIC)) {
+	return fail("statsPageTest: page refused");
+    }
+
+    statsPage_detach(testPage);
+    shm_unlink(STATS_PAGE_NAME);
+    errorMsg="statsPageTest: success";
+    return 0;
+}
+
+char *statsPageTest_status() {
+    return errorMsg;
+}
@@ -0,0 +1,76 @@
+/* statsPageTool.c */
+
+/* Sample domapp's live statistics page and print one
+   line per sample.
+
+   usage: statsPageTool [rateHz [count]]
+	rateHz	samples per second, default 1
+	count	samples to take, default forever */
+
+#include <stdio.h>
+#include <time.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "statsPage/statsPage.h"
+
+int main(int argc, char *argv[]) {
+
+    const STATS_PAGE *page;
+    STATS_PAGE copy;
+    int rate=1;
+    long count=-1;
+    long n;
+    int i;
+    struct timespec period;
+
+    if(argc>=2) {
+	sscanf(argv[1],"%i",&rate);
+    }
+    if(argc>=3) {
+	sscanf(argv[2],"%li",&count);
+    }
+    if(rate<1) {
+	rate=1;
+    }
+    period.tv_sec=(rate==1) ? 1 : 0;
+    period.tv_nsec=(rate==1) ? 0 : 1000000000L/rate;
+
+    page=statsPage_attach();
+    if(page==0) {
+	fprintf(stderr,"statsPageTool: no domapp statistics page\n");
+	return -1;
+    }
+
+    for(n=0;(count<0) || (n<count);n++) {
+	if(statsPage_read(page,&copy)<0) {
+	    fprintf(stderr,"statsPageTool: page busy\n");
+	}
+	else {
+	    printf("%lu upd=%lu msg rx=%lu tx=%lu pkt rx=%lu nostore=%lu"
+		" pool free=%d low=%d",
+		copy.timeUsec,copy.updateCnt,copy.msg[MSG_RECV],
+		copy.msg[MSG_SENT],copy.pkt[PKT_RECV],
+		copy.pkt[PKT_NO_STORAGE],copy.pool.freeCnt,
+		copy.pool.lowWater);
+	    for(i=0;i<copy.queueCnt;i++) {
+		printf(" %s=%lu",copy.queue[i].name,copy.queue[i].depth);
+	    }
+	    for(i=0;i<copy.serviceCnt;i++) {
+		printf(" [%s st=%d rx=%lu ref=%lu err=%lu]",
+		    copy.service[i].name,copy.service[i].state,
+		    copy.service[i].stats[SVC_MSG_RECEIVED],
+		    copy.service[i].stats[SVC_MSG_REFUSED],
+		    copy.service[i].stats[SVC_MSG_PROCESSING_ERR]);
+	    }
+	    printf("\n");
+	    fflush(stdout);
+	}
+	nanosleep(&period,0);
+    }
+
+    statsPage_detach(page);
+    return 0;
+}
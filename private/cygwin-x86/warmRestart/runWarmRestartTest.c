@@ -0,0 +1,14 @@
+/* runWarmRestartTest.c */
+
+#include "warmRestart/warmRestartTest.h"
+	
+
+int main() {
+
+    int i;
+
+    i=warmRestartTest();
+
+    printf("runWarmRestartTest: return status= %s\n",
+	warmRestartTest_status());
+}
@@ -0,0 +1,167 @@
+/* warmRestart.c */
+
+/* Pool and counters kept in shared memory across a
+   restart, see warmRestart.h */
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/DOMstats.h"
+#include "warmRestart/warmRestart.h"
+
+#define WARM_ALIGN 64
+#define WARM_ROUND(n) (((n)+WARM_ALIGN-1)&~(WARM_ALIGN-1))
+#define WARM_STATS_OFFSET WARM_ROUND(sizeof(WARM_HEADER))
+#define WARM_ARENA_OFFSET \
+	(WARM_STATS_OFFSET+WARM_ROUND(sizeof(DOM_STATS)))
+
+WARM_HEADER *warmHeader=0;
+ULONG warmSize=0;
+int warmCrashed=FALSE;
+
+/* FNV-1a over the header up to the check field */
+static ULONG headerCheck(WARM_HEADER *h)
+{
+    UBYTE *p=(UBYTE *)h;
+    ULONG sum=2166136261UL;
+    int i;
+
+    for(i=0;i<(int)offsetof(WARM_HEADER,check);i++) {
+	sum=(sum^p[i])*16777619UL;
+    }
+    return sum;
+}
+
+static int headerValid(WARM_HEADER *h)
+{
+    return (h->magic==WARM_MAGIC) &&
+	(h->version==WARM_VERSION) &&
+	(h->size==warmSize) &&
+	(h->arenaSize==(ULONG)messageBuffers_arenaSize()) &&
+	(h->check==headerCheck(h));
+}
+
+int warmRestart_attach(const char *name)
+{
+    UBYTE *base;
+    struct stat st;
+    int warm;
+    int fd;
+
+    warmSize=WARM_ARENA_OFFSET+WARM_ROUND(messageBuffers_arenaSize());
+    fd=shm_open(name,O_RDWR|O_CREAT,0600);
+    if(fd<0) {
+	return -1;
+    }
+    /* a segment of another size is from another layout */
+    if((fstat(fd,&st)<0) ||
+	((st.st_size!=(off_t)warmSize) &&
+	(ftruncate(fd,warmSize)<0))) {
+	close(fd);
+	return -1;
+    }
+    base=(UBYTE *)mmap(0,warmSize,PROT_READ|PROT_WRITE,
+	MAP_SHARED,fd,0);
+    close(fd);
+    if(base==(UBYTE *)MAP_FAILED) {
+	return -1;
+    }
+    warmHeader=(WARM_HEADER *)base;
+
+    warm=(st.st_size==(off_t)warmSize) && headerValid(warmHeader);
+    warmCrashed=warm && (warmHeader->state==WARM_RUNNING);
+    if(!warm) {
+	memset(warmHeader,0,sizeof(WARM_HEADER));
+	warmHeader->magic=WARM_MAGIC;
+	warmHeader->version=WARM_VERSION;
+	warmHeader->size=warmSize;
+	warmHeader->arenaSize=messageBuffers_arenaSize();
+    }
+
+    DOMstats_attach((DOM_STATS *)(base+WARM_STATS_OFFSET),warm);
+    messageBuffers_attach(base+WARM_ARENA_OFFSET,warm,
+	warm ? (UBYTE *)warmHeader->base+WARM_ARENA_OFFSET : 0);
+
+    if(warm) {
+	warmHeader->warmStarts++;
+    }
+    else {
+	warmHeader->coldStarts++;
+    }
+    warmHeader->base=base;
+    warmHeader->state=WARM_RUNNING;
+    warmHeader->check=headerCheck(warmHeader);
+    return warm;
+}
+
+int warmRestart_crashed()
+{
+    return warmCrashed;
+}
+
+int warmRestart_flushQueue(int queue)
+{
+    MESSAGE_STRUCT *stale;
+    int cnt=0;
+
+    /* only the entries are taken, the addresses they
+       hold are never used */
+    while(Message_receive_nonblock(&stale,queue)>0) {
+	cnt++;
+    }
+    return cnt;
+}
+
+int warmRestart_resume(int sd)
+{
+    MSGBUF_OUTSTANDING *held;
+    MESSAGE_STRUCT *m;
+    int cnt;
+    int queued=0;
+    int i;
+
+    held=(MSGBUF_OUTSTANDING *)malloc(sizeof(MSGBUF_OUTSTANDING)*
+	messageBuffers_totalCnt());
+    if(held==0) {
+	return -1;
+    }
+    cnt=messageBuffers_outstanding(held,messageBuffers_totalCnt());
+    for(i=0;i<cnt;i++) {
+	m=messageBuffers_slot(held[i].slot);
+	if((held[i].owner==MSGBUF_OWNER_SD) &&
+	    (Message_send(m,sd)>=0)) {
+	    queued++;
+	    continue;
+	}
+	messageBuffers_release(m);
+    }
+    free(held);
+    return queued;
+}
+
+void warmRestart_stop()
+{
+    if(warmHeader==0) {
+	return;
+    }
+    warmHeader->state=WARM_STOPPED;
+    warmHeader->check=headerCheck(warmHeader);
+}
+
+void warmRestart_detach()
+{
+    if(warmHeader==0) {
+	return;
+    }
+    warmRestart_stop();
+    munmap(warmHeader,warmSize);
+    warmHeader=0;
+}
@@ -0,0 +1,115 @@
+/* warmRestartTest.c */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/DOMstats.h"
+#include "warmRestart/warmRestart.h"
+#include "warmRestart/warmRestartTest.h"
+
+#define ERROR -1
+#define TEST_SHM_NAME "/domapp_warm_test"
+#define TEST_QUEUE 24
+#define TEST_HELD 3
+#define TEST_PKTS 7
+#define TEST_DATA "kept"
+
+/* storage */
+char *errorMsg;
+
+static int fail(char *msg) {
+    errorMsg=msg;
+    warmRestart_detach();
+    shm_unlink(TEST_SHM_NAME);
+    return ERROR;
+}
+
+/* test entry point */
+int warmRestartTest() {
+    MESSAGE_STRUCT *held[TEST_HELD];
+    MESSAGE_STRUCT *m;
+    void *placeholder;
+    int queue;
+    int i;
+
+    shm_unlink(TEST_SHM_NAME);
+    queue=Message_createQueue(TEST_QUEUE);
+    if(queue<0) {
+	errorMsg="warmRestartTest: cannot create queue";
+	return ERROR;
+    }
+    warmRestart_flushQueue(queue);
+
+    /* a new segment starts cold */
+    if(warmRestart_attach(TEST_SHM_NAME)!=FALSE) {
+	return fail("warmRestartTest: first attach not cold");
+    }
+    for(i=0;i<TEST_HELD;i++) {
+	held[i]=messageBuffers_allocate();
+	if(held[i]==0) {
+	    return fail("warmRestartTest: cannot allocate");
+	}
+    }
+    /* one reply waiting for the link, the rest mid request */
+    messageBuffers_setOwner(held[0],MSGBUF_OWNER_SD);
+    strcpy((char *)Message_getData(held[0]),TEST_DATA);
+    Message_setDataLen(held[0],sizeof(TEST_DATA));
+    messageBuffers_setOwner(held[1],MSGBUF_OWNER_SC);
+    STAT_ADD(&pktStats,PKT_RECV,TEST_PKTS);
+
+    /* keep the old address busy so the pool moves */
+    warmRestart_detach();
+    placeholder=mmap(0,messageBuffers_arenaSize()+4096,
+	PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+
+    if(warmRestart_attach(TEST_SHM_NAME)!=TRUE) {
+	return fail("warmRestartTest: second attach not warm");
+    }
+    if(warmRestart_crashed()) {
+	return fail("warmRestartTest: clean stop seen as crash");
+    }
+    if(statCounters_read(&pktStats,PKT_RECV)!=TEST_PKTS) {
+	return fail("warmRestartTest: counters not kept");
+    }
+    if(messageBuffers_freeCnt()!=messageBuffers_totalCnt()-TEST_HELD) {
+	return fail("warmRestartTest: held buffers not kept");
+    }
+
+    if(warmRestart_resume(queue)!=1) {
+	return fail("warmRestartTest: reply not requeued");
+    }
+    if(messageBuffers_freeCnt()!=messageBuffers_totalCnt()-1) {
+	return fail("warmRestartTest: cut short buffers not freed");
+    }
+    if((Message_receive_nonblock(&m,queue)<=0) ||
+	(messageBuffers_index(m)<0) ||
+	(Message_dataLen(m)!=sizeof(TEST_DATA)) ||
+	(strcmp((char *)Message_getData(m),TEST_DATA)!=0)) {
+	return fail("warmRestartTest: reply lost");
+    }
+    messageBuffers_release(m);
+
+    /* no clean stop, the next attach finds a crash */
+    if(warmRestart_attach(TEST_SHM_NAME)!=TRUE) {
+	return fail("warmRestartTest: third attach not warm");
+    }
+    if(!warmRestart_crashed()) {
+	return fail("warmRestartTest: crash not seen");
+    }
+
+    if(placeholder!=MAP_FAILED) {
+	munmap(placeholder,messageBuffers_arenaSize()+4096);
+    }
+    warmRestart_detach();
+    shm_unlink(TEST_SHM_NAME);
+    errorMsg="warmRestartTest: success";
+    return 0;
+}
+
+char *warmRestartTest_status() {
+    return errorMsg;
+}
@@ -0,0 +1,154 @@
+/* calibration.c */
+
+/* Per sample pedestal and gain calibration of ATWD
+   waveforms, see dataAccess/calibration.h */
+
+#include <math.h>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/calibration.h"
+
+void calibration_init(CAL_TABLES *t) {
+	int a;
+	int c;
+	int i;
+
+	for(a=0;a<HIT_ATWD_CNT;a++) {
+	    for(c=0;c<CAL_CHANNELS;c++) {
+		for(i=0;i<CAL_SAMPLES;i++) {
+		    t->gain[a][c][i]=1.0f;
+		    t->offset[a][c][i]=0.0f;
+		}
+	    }
+	}
+}
+
+void calibration_set(CAL_TABLES *t, int atwd, int channel, int sample,
+	float pedestal, float gain) {
+	t->gain[atwd][channel][sample]=gain;
+	t->offset[atwd][channel][sample]=-pedestal*gain;
+}
+
+/* out=v*gain+offset, the samples widened to 32 bits */
+void calibration_apply8(const CAL_TABLES *t, int atwd, const UBYTE *v,
+	int n, float *out) {
+	const float *gain=t->gain[atwd][CAL_LO];
+	const float *offset=t->offset[atwd][CAL_LO];
+	int i;
+#if defined(__AVX2__) && defined(__FMA__)
+	__m256 x;
+
+	for(i=0;i<n;i+=8) {
+	    x=_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+		_mm_loadl_epi64((const __m128i *)&v[i])));
+	    _mm256_storeu_ps(&out[i],_mm256_fmadd_ps(x,
+		_mm256_load_ps(&gain[i]),_mm256_load_ps(&offset[i])));
+	}
+#elif defined(__SSE2__)
+	__m128i zero=_mm_setzero_si128();
+	__m128i w;
+	__m128 x;
+	int j;
+
+	for(i=0;i<n;i+=8) {
+	    w=_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)&v[i]),zero);
+	    for(j=0;j<8;j+=4) {
+		x=_mm_cvtepi32_ps(_mm_unpacklo_epi16(w,zero));
+		_mm_storeu_ps(&out[i+j],_mm_add_ps(
+		    _mm_mul_ps(x,_mm_load_ps(&gain[i+j])),
+		    _mm_load_ps(&offset[i+j])));
+		w=_mm_srli_si128(w,8);
+	    }
+	}
+#else
+	for(i=0;i<n;i++) {
+	    out[i]=v[i]*gain[i]+offset[i];
+	}
+#endif
+}
+
+void calibration_apply16(const CAL_TABLES *t, int atwd, const USHORT *v,
+	int n, float *out) {
+	const float *gain=t->gain[atwd][CAL_HI];
+	const float *offset=t->offset[atwd][CAL_HI];
+	int i;
+#if defined(__AVX2__) && defined(__FMA__)
+	__m256 x;
+
+	for(i=0;i<n;i+=8) {
+	    x=_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(
+		_mm_loadu_si128((const __m128i *)&v[i])));
+	    _mm256_storeu_ps(&out[i],_mm256_fmadd_ps(x,
+		_mm256_load_ps(&gain[i]),_mm256_load_ps(&offset[i])));
+	}
+#elif defined(__SSE2__)
+	__m128i zero=_mm_setzero_si128();
+	__m128i w;
+	__m128 x;
+	int j;
+
+	for(i=0;i<n;i+=8) {
+	    w=_mm_loadu_si128((const __m128i *)&v[i]);
+	    for(j=0;j<8;j+=4) {
+		x=_mm_cvtepi32_ps(_mm_unpacklo_epi16(w,zero));
+		_mm_storeu_ps(&out[i+j],_mm_add_ps(
+		    _mm_mul_ps(x,_mm_load_ps(&gain[i+j])),
+		    _mm_load_ps(&offset[i+j])));
+		w=_mm_srli_si128(w,8);
+	    }
+	}
+#else
+	for(i=0;i<n;i++) {
+	    out[i]=v[i]*gain[i]+offset[i];
+	}
+#endif
+}
+
+void calibration_applyHit(const CAL_TABLES *t, HIT_RECORD *h,
+	UBYTE present, CAL_HIT *out) {
+	int i;
+
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(present&(ATWD0_LO_PRES<<(2*i))) {
+		calibration_apply8(t,i,h->lo[i],ATWD_LO_LEN,out->lo[i]);
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*i))) {
+		calibration_apply16(t,i,h->hi[i],ATWD_HI_LEN/2,out->hi[i]);
+	    }
+	}
+}
+
+void calibration_toFixed(const float *in, int n, float scale, short *out) {
+	int i;
+#ifdef __SSE2__
+	__m128 s=_mm_set1_ps(scale);
+	__m128 top=_mm_set1_ps(32767.0f);
+	__m128 bottom=_mm_set1_ps(-32767.0f);
+	__m128i a;
+	__m128i b;
+
+	/* held before converting, out of range converts to
+	   0x80000000; rounds to nearest even like lrintf() */
+	for(i=0;i<n;i+=8) {
+	    a=_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(
+		_mm_mul_ps(_mm_loadu_ps(&in[i]),s),top),bottom));
+	    b=_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(
+		_mm_mul_ps(_mm_loadu_ps(&in[i+4]),s),top),bottom));
+	    _mm_storeu_si128((__m128i *)&out[i],_mm_packs_epi32(a,b));
+	}
+#else
+	float x;
+
+	for(i=0;i<n;i++) {
+	    x=in[i]*scale;
+	    x=(x>32767.0f) ? 32767.0f : (x<-32767.0f) ? -32767.0f : x;
+	    out[i]=(short)lrintf(x);
+	}
+#endif
+}
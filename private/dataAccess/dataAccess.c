@@ -0,0 +1,731 @@
+/* dataAccess.c */
+
+/* Data Access service, see dataAccess/dataAccess.h */
+
+#include <string.h>
+#include <math.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "domapp_common/commonMessageAPIstatus.h"
+#include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/hitFilter.h"
+#include "dataAccess/scaler.h"
+#include "dataAccess/histogram.h"
+#include "dataAccess/dataAccess.h"
+#include "dataAccess/DAmessageAPIstatus.h"
+#include "dataAccess/waveformCodec.h"
+#include "dataAccess/pulseFeatures.h"
+#include "dataAccess/calibration.h"
+#include "dataAccess/waveformFile.h"
+#include "dataAccess/hitGenerator.h"
+#include "dataAccess/pedestal.h"
+
+/* extern functions */
+extern void formatLong(ULONG value, UBYTE *buf);
+extern void formatShort(USHORT value, UBYTE *buf);
+extern ULONG unformatLong(UBYTE *buf);
+extern USHORT unformatShort(UBYTE *buf);
+
+COMMON_SERVICE_INFO dataAcc;
+HIT_BUFFER dataAccHits;
+HIT_FILTER dataAccFilter;
+SCALER dataAccScaler;
+HISTOGRAM dataAccHists[HIST_QUANTITIES];
+/* the DAQ's place in dataAccHits */
+HIT_READER dataAccReader;
+/* the service runs on one worker at a time */
+static HIT_RECORD hit;
+/* DATA_ACC_ENC_FEATURES settings, and hits sent since
+   the last one sent raw */
+static USHORT featureLoThreshold;
+static USHORT featureHiThreshold;
+static USHORT featurePrescale;
+static USHORT featureHits;
+/* DATA_ACC_ENC_CALIBRATED tables */
+static CAL_TABLES dataAccCal;
+/* histograms as last read since, and their generation */
+static ULONG histLast[HIST_QUANTITIES][HIST_MAX_BINS+2];
+static ULONG histLastGen[HIST_QUANTITIES];
+
+static const char *dataAccess_errorStr(UBYTE id) {
+	switch(id) {
+	    case COMMON_No_Errors:
+		return DATA_ACC_ERS_NO_ERRORS;
+	    case COMMON_Bad_Msg_Subtype:
+		return DATA_ACC_ERS_BAD_MSG_SUBTYPE;
+	    case DATA_ACC_bad_msg_format:
+		return DATA_ACC_ERS_BAD_MSG_FORMAT;
+	    default:
+		return NULL;
+	}
+}
+
+void dataAccess_init(void) {
+	HIST_AXIS axis;
+
+	dataAcc.majorVersion=DATA_ACC_MAJOR_VERSION;
+	dataAcc.minorVersion=DATA_ACC_MINOR_VERSION;
+	dataAcc.errorStr=dataAccess_errorStr;
+	featureLoThreshold=DATA_ACC_FEATURE_LO_THRESHOLD;
+	featureHiThreshold=DATA_ACC_FEATURE_HI_THRESHOLD;
+	featurePrescale=0;
+	featureHits=0;
+	calibration_init(&dataAccCal);
+	hitBuffer_init(&dataAccHits,HIT_OVERWRITE);
+	hitFilter_init(&dataAccFilter);
+	scaler_init(&dataAccScaler,SCALER_BIN_TICKS,SCALER_DEAD_TICKS);
+	axis.scale=HIST_LINEAR;
+	axis.shift=0;
+	axis.bins=DATA_ACC_ENERGY_BINS;
+	axis.lo=0;
+	axis.width=DATA_ACC_ENERGY_WIDTH;
+	histogram_init(&dataAccHists[HIST_ENERGY],HIST_ENERGY,&axis);
+	axis.scale=HIST_LOG;
+	axis.shift=DATA_ACC_INTERVAL_SHIFT;
+	axis.bins=DATA_ACC_INTERVAL_BINS;
+	axis.lo=1;
+	axis.width=0;
+	histogram_init(&dataAccHists[HIST_INTERVAL],HIST_INTERVAL,&axis);
+	memset(histLastGen,0,sizeof(histLastGen));
+	hitBuffer_addReader(&dataAccHits,&dataAccReader,HIT_FROM_OLDEST);
+}
+
+/* waveforms present, as ATWDx_xx_PRES bits */
+static UBYTE presentBits(DOM_DATA *d) {
+	ATWD_DESC *atwd[HIT_ATWD_CNT];
+	UBYTE bits=0;
+	int i;
+
+	atwd[0]=&d->atwd0;
+	atwd[1]=&d->atwd1;
+	atwd[2]=&d->atwd2;
+	atwd[3]=&d->atwd3;
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(atwd[i]->lo) {
+		bits|=ATWD0_LO_PRES<<(2*i);
+	    }
+	    if(atwd[i]->hi) {
+		bits|=ATWD0_HI_PRES<<(2*i);
+	    }
+	}
+	return bits;
+}
+
+/* wire length of a hit with the given waveforms */
+static int hitLen(UBYTE present) {
+	int len=DATA_ACC_HIT_HDR_LEN;
+	int i;
+
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(present&(ATWD0_LO_PRES<<(2*i))) {
+		len+=ATWD_LO_LEN;
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*i))) {
+		len+=ATWD_HI_LEN;
+	    }
+	}
+	return len;
+}
+
+/* waveforms of h at out, coded.  Returns their length. */
+static int packWaveforms(HIT_RECORD *h, UBYTE present, UBYTE *out) {
+	UBYTE *start=out;
+	int i;
+
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(present&(ATWD0_LO_PRES<<(2*i))) {
+		out+=waveformCodec_encode8(h->lo[i],ATWD_LO_LEN,out);
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*i))) {
+		out+=waveformCodec_encode16(h->hi[i],ATWD_HI_LEN/2,out);
+	    }
+	}
+	return (int)(out-start);
+}
+
+static UBYTE *formatFeatures(PULSE_FEATURES *f, UBYTE *out) {
+	int i;
+
+	*out++=(UBYTE)f->cnt;
+	formatShort(f->baseline,out);
+	out+=2;
+	for(i=0;i<f->cnt;i++) {
+	    formatShort(f->pulse[i].time,&out[0]);
+	    formatShort(f->pulse[i].peak,&out[2]);
+	    formatLong(f->pulse[i].charge,&out[4]);
+	    out+=8;
+	}
+	return out;
+}
+
+/* pulses of the waveforms of h at out.  Returns their
+   length. */
+static int featureWaveforms(HIT_RECORD *h, UBYTE present, UBYTE *out) {
+	PULSE_FEATURES f;
+	UBYTE *start=out;
+	int i;
+
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(present&(ATWD0_LO_PRES<<(2*i))) {
+		pulseFeatures_find8(h->lo[i],ATWD_LO_LEN,featureLoThreshold,&f);
+		out=formatFeatures(&f,out);
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*i))) {
+		pulseFeatures_find16(h->hi[i],ATWD_HI_LEN/2,featureHiThreshold,
+		    &f);
+		out=formatFeatures(&f,out);
+	    }
+	}
+	return (int)(out-start);
+}
+
+static UBYTE *formatCalibrated(const float *mv, int n, UBYTE *out) {
+	short fixed[ATWD_HI_LEN/2];
+	int i;
+
+	calibration_toFixed(mv,n,DATA_ACC_CAL_SCALE,fixed);
+	for(i=0;i<n;i++) {
+	    formatShort((USHORT)fixed[i],out);
+	    out+=2;
+	}
+	return out;
+}
+
+/* the waveforms of h in mV at out.  Returns their
+   length. */
+static int calibrateWaveforms(HIT_RECORD *h, UBYTE present, UBYTE *out) {
+	static CAL_HIT mv;
+	UBYTE *start=out;
+	int i;
+
+	calibration_applyHit(&dataAccCal,h,present,&mv);
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(present&(ATWD0_LO_PRES<<(2*i))) {
+		out=formatCalibrated(mv.lo[i],ATWD_LO_LEN,out);
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*i))) {
+		out=formatCalibrated(mv.hi[i],ATWD_HI_LEN/2,out);
+	    }
+	}
+	return (int)(out-start);
+}
+
+/* waveforms of h at out in a coding other than raw.
+   Returns their length. */
+static int codeWaveforms(HIT_RECORD *h, UBYTE present, int encoding,
+	UBYTE *out) {
+	switch(encoding) {
+	    case DATA_ACC_ENC_PACKED:
+		return packWaveforms(h,present,out);
+	    case DATA_ACC_ENC_FEATURES:
+		return featureWaveforms(h,present,out);
+	    default:
+		return calibrateWaveforms(h,present,out);
+	}
+}
+
+/* format h at out, 0 if it needs more than room bytes */
+static int formatHit(HIT_RECORD *h, int encoding, UBYTE *out, int room) {
+	/* a coded hit that may not fit is made here first */
+	static UBYTE scratch[DATA_ACC_HIT_HDR_LEN+
+	    HIT_ATWD_CNT*(2*ATWD_LO_LEN+ATWD_HI_LEN+2)];
+	UBYTE present=presentBits(&h->dom);
+	UBYTE *to=out;
+	int len=hitLen(present);
+	int prescaled=(encoding==DATA_ACC_ENC_FEATURES) &&
+	    (featurePrescale!=0);
+	int i;
+	int j;
+
+	/* counted only once the hit is placed, a hit left
+	   for the next message keeps its turn */
+	if(prescaled && (featureHits+1>=featurePrescale)) {
+	    encoding=DATA_ACC_ENC_RAW;
+	}
+	if(encoding!=DATA_ACC_ENC_RAW) {
+	    /* calibrated lo samples take two bytes, no other
+	       coding more than a byte per waveform over raw */
+	    if(len+((encoding==DATA_ACC_ENC_CALIBRATED) ?
+		HIT_ATWD_CNT*ATWD_LO_LEN : 2*HIT_ATWD_CNT)>room) {
+		to=scratch;
+	    }
+	    len=DATA_ACC_HIT_HDR_LEN+
+		codeWaveforms(h,present,encoding,to+DATA_ACC_HIT_HDR_LEN);
+	    if(len>room) {
+		return 0;
+	    }
+	    if(to!=out) {
+		memcpy(out+DATA_ACC_HIT_HDR_LEN,to+DATA_ACC_HIT_HDR_LEN,
+		    len-DATA_ACC_HIT_HDR_LEN);
+	    }
+	}
+	else if(len>room) {
+	    return 0;
+	}
+	if(prescaled) {
+	    featureHits=(encoding==DATA_ACC_ENC_RAW) ? 0 : featureHits+1;
+	}
+	formatShort((USHORT)len,&out[0]);
+	out[2]=present;
+	out[3]=h->dom.trig.SPE ? SPE_MASK : MSPE_MASK;
+	formatLong(h->seq,&out[4]);
+	formatLong(h->dom.trig.time,&out[8]);
+	formatLong((ULONG)h->dom.trig.energy,&out[12]);
+	out[16]=(UBYTE)h->dom.trig.coinc;
+	out[17]=(UBYTE)h->dom.trig.quality;
+	out[18]=(UBYTE)h->dom.atwd0.contents;
+	out[19]=(UBYTE)encoding;
+	if(encoding!=DATA_ACC_ENC_RAW) {
+	    return len;
+	}
+	out+=DATA_ACC_HIT_HDR_LEN;
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(present&(ATWD0_LO_PRES<<(2*i))) {
+		memcpy(out,h->lo[i],ATWD_LO_LEN);
+		out+=ATWD_LO_LEN;
+	    }
+	    if(present&(ATWD0_HI_PRES<<(2*i))) {
+		for(j=0;j<ATWD_HI_LEN/2;j++) {
+		    formatShort(h->hi[i][j],out);
+		    out+=2;
+		}
+	    }
+	}
+	return len;
+}
+
+static UBYTE getData(MESSAGE_STRUCT *M, int encoding) {
+	UBYTE *data=Message_getData(M);
+	UBYTE *out=data+DATA_ACC_DATA_HDR_LEN;
+	int room=MAXDATA_VALUE-DATA_ACC_DATA_HDR_LEN;
+	int cnt=0;
+	int len;
+
+	while(hitBuffer_peek(&dataAccHits,&dataAccReader,&hit)) {
+	    len=formatHit(&hit,encoding,out,room);
+	    if(len==0) {
+		break;
+	    }
+	    hitBuffer_next(&dataAccReader);
+	    out+=len;
+	    room-=len;
+	    cnt++;
+	}
+	formatShort((USHORT)cnt,data);
+	Message_setDataLen(M,(int)(out-data));
+	return SUCCESS;
+}
+
+static UBYTE getWindow(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	UBYTE *out=data+DATA_ACC_WINDOW_HDR_LEN;
+	int room=MAXDATA_VALUE-DATA_ACC_WINDOW_HDR_LEN;
+	int encoding=data[16];
+	ULONG epoch=dataAccHits.curEpoch;
+	ULONG from;
+	ULONG to;
+	int cnt=0;
+	int len;
+
+	from=hitBuffer_find(&dataAccHits,unformatLong(&data[0]),
+	    unformatLong(&data[4]));
+	to=hitBuffer_find(&dataAccHits,unformatLong(&data[8]),
+	    unformatLong(&data[12]));
+	for(;(long)(to-from)>0;from++) {
+	    /* overwritten since it was found */
+	    if(!hitBuffer_row(&dataAccHits,from,&hit)) {
+		continue;
+	    }
+	    len=formatHit(&hit,encoding,out,room);
+	    if(len==0) {
+		break;
+	    }
+	    if(cnt==0) {
+		epoch=hit.epoch;
+	    }
+	    out+=len;
+	    room-=len;
+	    cnt++;
+	}
+	formatShort((USHORT)cnt,&data[0]);
+	formatLong(((long)(to-from)>0) ? to-from : 0,&data[2]);
+	formatLong(epoch,&data[6]);
+	Message_setDataLen(M,(int)(out-data));
+	return SUCCESS;
+}
+
+static UBYTE setGenerator(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	HIT_GEN_CONFIG cfg;
+	int mode=data[0];
+
+	cfg.pattern=data[1];
+	cfg.mspePercent=data[2];
+	cfg.present=data[3];
+	cfg.rateHz=unformatLong(&data[4]);
+	cfg.poisson=(mode==DATA_ACC_GEN_POISSON);
+	cfg.seed=dataAccHits.head+1;
+
+	hitGenerator_stop();
+	formatLong(hitGenerator_count(),&data[0]);
+	Message_setDataLen(M,DATA_ACC_SET_GENERATOR_RSP_LEN);
+	if((mode!=DATA_ACC_GEN_STOP) &&
+	    (hitGenerator_start(&dataAccHits,&dataAccFilter,&dataAccScaler,
+	    dataAccHists,HIST_QUANTITIES,&cfg)<0)) {
+	    return SERVICE_SPECIFIC_ERROR|WARNING_ERROR;
+	}
+	return SUCCESS;
+}
+
+/* one channel's averages at out */
+static UBYTE *formatPedestal(int atwd, int channel, int variance,
+	UBYTE *out) {
+	USHORT mean[PED_SAMPLES];
+	USHORT var[PED_SAMPLES];
+	int len=(channel==PED_LO) ? ATWD_LO_LEN : ATWD_HI_LEN/2;
+	int i;
+
+	formatLong(pedestal_mean(pedestal_sums(),atwd,channel,mean,
+	    variance ? var : 0),out);
+	out+=4;
+	for(i=0;i<len;i++) {
+	    formatShort(mean[i],out);
+	    out+=2;
+	}
+	for(i=0;variance && (i<len);i++) {
+	    formatShort(var[i],out);
+	    out+=2;
+	}
+	return out;
+}
+
+static UBYTE getPedestal(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	UBYTE *out=data+DATA_ACC_PEDESTAL_HDR_LEN;
+	int asked=(Message_dataLen(M)==DATA_ACC_GET_PEDESTAL_LEN);
+	int atwd=data[0];
+	int variance=data[1];
+	ULONG done;
+	ULONG target;
+	int state=pedestal_state(&done,&target);
+
+	data[0]=(UBYTE)state;
+	formatLong(done,&data[1]);
+	formatLong(target,&data[5]);
+	if(asked && (state==PED_DONE)) {
+	    out=formatPedestal(atwd,PED_LO,variance,out);
+	    out=formatPedestal(atwd,PED_HI,variance,out);
+	}
+	Message_setDataLen(M,(int)(out-data));
+	return SUCCESS;
+}
+
+static int validAction(UBYTE a) {
+	return (a==HIT_FILTER_KEEP) || (a==HIT_FILTER_DOWNGRADE) ||
+	    (a==HIT_FILTER_DROP);
+}
+
+static UBYTE setFilter(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	HIT_FILTER_CONFIG cfg;
+	int i;
+
+	cfg.minCoinc=data[0];
+	cfg.minQuality=data[1];
+	cfg.classes=data[2];
+	for(i=0;i<HIT_FILTER_RULES;i++) {
+	    cfg.action[i]=data[3+i];
+	}
+	hitFilter_set(&dataAccFilter,&cfg);
+	Message_setDataLen(M,0);
+	return SUCCESS;
+}
+
+static UBYTE getFilterStats(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	UBYTE *out=data+DATA_ACC_SET_FILTER_LEN;
+	HIT_FILTER_CONFIG cfg;
+	int i;
+
+	hitFilter_get(&dataAccFilter,&cfg);
+	data[0]=cfg.minCoinc;
+	data[1]=cfg.minQuality;
+	data[2]=cfg.classes;
+	for(i=0;i<HIT_FILTER_RULES;i++) {
+	    data[3+i]=cfg.action[i];
+	}
+	for(i=0;i<HIT_FILTER_RULES;i++) {
+	    formatLong(dataAccFilter.accepted[i],&out[0]);
+	    formatLong(dataAccFilter.rejected[i],&out[4]);
+	    out+=8;
+	}
+	formatLong(dataAccFilter.kept,&out[0]);
+	formatLong(dataAccFilter.downgraded,&out[4]);
+	formatLong(dataAccFilter.dropped,&out[8]);
+	Message_setDataLen(M,DATA_ACC_GET_FILTER_STATS_LEN);
+	return SUCCESS;
+}
+
+static UBYTE setScaler(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+
+	scaler_set(&dataAccScaler,unformatLong(&data[0]),
+	    unformatLong(&data[4]));
+	Message_setDataLen(M,0);
+	return SUCCESS;
+}
+
+static UBYTE getScalers(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	ULONG first;
+	ULONG lost;
+	int n;
+
+	n=scaler_read(&dataAccScaler,&data[DATA_ACC_SCALER_HDR_LEN],
+	    MAXDATA_VALUE-DATA_ACC_SCALER_HDR_LEN,&first,&lost);
+	formatLong(first,&data[0]);
+	formatLong(lost,&data[4]);
+	formatLong(dataAccScaler.dead,&data[8]);
+	formatShort((USHORT)n,&data[12]);
+	Message_setDataLen(M,DATA_ACC_SCALER_HDR_LEN+n);
+	return SUCCESS;
+}
+
+/* the axis a DATA_ACC_SET_HISTOGRAM passes */
+static void unformatAxis(UBYTE *data, HIST_AXIS *a) {
+	a->scale=data[1];
+	a->shift=data[2];
+	a->bins=unformatShort(&data[3]);
+	a->lo=(long)(int)unformatLong(&data[5]);
+	a->width=unformatLong(&data[9]);
+}
+
+static UBYTE setHistogram(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	HIST_AXIS axis;
+
+	unformatAxis(data,&axis);
+	histogram_set(&dataAccHists[data[0]],&axis);
+	Message_setDataLen(M,0);
+	return SUCCESS;
+}
+
+static UBYTE getHistogram(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	int quantity=data[0];
+	int format=data[1];
+	int since=data[2];
+	HISTOGRAM *h=&dataAccHists[quantity];
+	ULONG *last=histLast[quantity];
+	static ULONG count[HIST_MAX_BINS+2];
+	ULONG gen=h->gen;
+	ULONG total;
+	int bins;
+	int i;
+
+	bins=histogram_sum(h,count);
+	if(histLastGen[quantity]!=gen) {
+	    memset(last,0,sizeof(histLast[quantity]));
+	}
+	for(i=0;since && (i<bins+2);i++) {
+	    total=count[i];
+	    count[i]-=last[i];
+	    last[i]=total;
+	}
+	if(since) {
+	    histLastGen[quantity]=gen;
+	}
+	data[0]=(UBYTE)quantity;
+	data[1]=(UBYTE)format;
+	formatShort((USHORT)bins,&data[2]);
+	formatLong(count[0],&data[4]);
+	formatLong(count[bins+1],&data[8]);
+	Message_setDataLen(M,DATA_ACC_HISTOGRAM_HDR_LEN+
+	    histogram_encode(&count[1],bins,format,
+	    &data[DATA_ACC_HISTOGRAM_HDR_LEN]));
+	return SUCCESS;
+}
+
+static UBYTE badFormat(MESSAGE_STRUCT *M) {
+	STAT_INC(&dataAcc.stats,SVC_MSG_REFUSED);
+	commonServices_recordError(&dataAcc,DATA_ACC_bad_msg_format,
+	    WARNING_ERROR,M);
+	Message_setDataLen(M,0);
+	return SERVER_PROTOCOL_ERROR|WARNING_ERROR;
+}
+
+static UBYTE setCalibration(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	union {
+	    unsigned int bits;
+	    float value;
+	} pedestal, gain;
+	int atwd=data[0];
+	int channel=data[1];
+	int first=unformatShort(&data[2]);
+	int cnt=unformatShort(&data[4]);
+	int i;
+
+	if((Message_dataLen(M)<DATA_ACC_SET_CALIBRATION_LEN) ||
+	    (Message_dataLen(M)!=DATA_ACC_SET_CALIBRATION_LEN+8*cnt) ||
+	    (atwd>=HIT_ATWD_CNT) || (channel>=CAL_CHANNELS) ||
+	    (first+cnt>CAL_SAMPLES)) {
+	    return badFormat(M);
+	}
+	data+=DATA_ACC_SET_CALIBRATION_LEN;
+	/* a NaN or infinity would reach every calibrated hit,
+	   refuse the lot before setting any */
+	for(i=0;i<2*cnt;i++) {
+	    pedestal.bits=(unsigned int)unformatLong(&data[4*i]);
+	    if(!isfinite(pedestal.value)) {
+		return badFormat(M);
+	    }
+	}
+	for(i=0;i<cnt;i++) {
+	    pedestal.bits=(unsigned int)unformatLong(&data[0]);
+	    gain.bits=(unsigned int)unformatLong(&data[4]);
+	    calibration_set(&dataAccCal,atwd,channel,first+i,pedestal.value,
+		gain.value);
+	    data+=8;
+	}
+	Message_setDataLen(M,0);
+	return SUCCESS;
+}
+
+UBYTE dataAccess_serve(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	HIST_AXIS axis;
+
+	switch(Message_getSubtype(M)) {
+	    case DATA_ACC_GET_DATA:
+		if(Message_dataLen(M)==0) {
+		    return getData(M,DATA_ACC_ENC_RAW);
+		}
+		if((Message_dataLen(M)!=1) || (data[0]>DATA_ACC_ENC_CALIBRATED)) {
+		    return badFormat(M);
+		}
+		return getData(M,data[0]);
+
+	    case DATA_ACC_GET_BUF_STATS:
+		if(Message_dataLen(M)!=0) {
+		    return badFormat(M);
+		}
+		formatLong(dataAccHits.head,&data[0]);
+		formatLong(hitBuffer_pending(&dataAccHits,&dataAccReader),
+		    &data[4]);
+		formatLong(dataAccHits.dropped,&data[8]);
+		formatLong(dataAccReader.lost,&data[12]);
+		formatLong(dataAccHits.policy,&data[16]);
+		Message_setDataLen(M,DATA_ACC_GET_BUF_STATS_LEN);
+		return SUCCESS;
+
+	    case DATA_ACC_SET_POLICY:
+		if((Message_dataLen(M)!=1) || (data[0]>HIT_STOP)) {
+		    return badFormat(M);
+		}
+		hitBuffer_setPolicy(&dataAccHits,data[0]);
+		Message_setDataLen(M,0);
+		return SUCCESS;
+
+	    case DATA_ACC_GET_WINDOW:
+		if((Message_dataLen(M)!=DATA_ACC_GET_WINDOW_LEN) ||
+		    (data[16]>DATA_ACC_ENC_CALIBRATED)) {
+		    return badFormat(M);
+		}
+		return getWindow(M);
+
+	    case DATA_ACC_SET_FEATURES:
+		if(Message_dataLen(M)!=DATA_ACC_SET_FEATURES_LEN) {
+		    return badFormat(M);
+		}
+		featureLoThreshold=unformatShort(&data[0]);
+		featureHiThreshold=unformatShort(&data[2]);
+		featurePrescale=unformatShort(&data[4]);
+		featureHits=0;
+		Message_setDataLen(M,0);
+		return SUCCESS;
+
+	    case DATA_ACC_SET_CALIBRATION:
+		return setCalibration(M);
+
+	    case DATA_ACC_START_PEDESTAL:
+		if(Message_dataLen(M)!=DATA_ACC_START_PEDESTAL_LEN) {
+		    return badFormat(M);
+		}
+		pedestal_stop();
+		Message_setDataLen(M,0);
+		if(pedestal_start(&dataAccHits,unformatLong(data))<0) {
+		    return SERVICE_SPECIFIC_ERROR|WARNING_ERROR;
+		}
+		return SUCCESS;
+
+	    case DATA_ACC_GET_PEDESTAL:
+		if(((Message_dataLen(M)!=0) &&
+		    (Message_dataLen(M)!=DATA_ACC_GET_PEDESTAL_LEN)) ||
+		    ((Message_dataLen(M)!=0) && (data[0]>=HIT_ATWD_CNT))) {
+		    return badFormat(M);
+		}
+		return getPedestal(M);
+
+	    case DATA_ACC_SET_FILTER:
+		if((Message_dataLen(M)!=DATA_ACC_SET_FILTER_LEN) ||
+		    (data[2]>(HIT_FILTER_SPE|HIT_FILTER_MSPE)) ||
+		    !validAction(data[3]) || !validAction(data[4]) ||
+		    !validAction(data[5])) {
+		    return badFormat(M);
+		}
+		return setFilter(M);
+
+	    case DATA_ACC_GET_FILTER_STATS:
+		if(Message_dataLen(M)!=0) {
+		    return badFormat(M);
+		}
+		return getFilterStats(M);
+
+	    case DATA_ACC_SET_SCALER:
+		if((Message_dataLen(M)!=DATA_ACC_SET_SCALER_LEN) ||
+		    (unformatLong(&data[0])==0)) {
+		    return badFormat(M);
+		}
+		return setScaler(M);
+
+	    case DATA_ACC_GET_SCALERS:
+		if(Message_dataLen(M)!=0) {
+		    return badFormat(M);
+		}
+		return getScalers(M);
+
+	    case DATA_ACC_SET_HISTOGRAM:
+		if((Message_dataLen(M)!=DATA_ACC_SET_HISTOGRAM_LEN) ||
+		    (data[0]>=HIST_QUANTITIES)) {
+		    return badFormat(M);
+		}
+		unformatAxis(data,&axis);
+		if(!histogram_validAxis(&axis)) {
+		    return badFormat(M);
+		}
+		return setHistogram(M);
+
+	    case DATA_ACC_GET_HISTOGRAM:
+		if((Message_dataLen(M)!=DATA_ACC_GET_HISTOGRAM_LEN) ||
+		    (data[0]>=HIST_QUANTITIES) || (data[1]>HIST_DELTA)) {
+		    return badFormat(M);
+		}
+		return getHistogram(M);
+
+	    case DATA_ACC_SET_GENERATOR:
+		if((Message_dataLen(M)!=DATA_ACC_SET_GENERATOR_LEN) ||
+		    (data[0]>DATA_ACC_GEN_POISSON) || (data[2]>100)) {
+		    return badFormat(M);
+		}
+		return setGenerator(M);
+
+	    default:
+		/* common subtypes */
+		return 0;
+	}
+}
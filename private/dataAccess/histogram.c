@@ -0,0 +1,163 @@
+/* histogram.c */
+
+/* Energy and hit interval histograms, see
+   dataAccess/histogram.h */
+
+#include <string.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/histogram.h"
+
+/* extern functions */
+extern void formatLong(ULONG value, UBYTE *buf);
+extern void formatShort(USHORT value, UBYTE *buf);
+
+int histogram_validAxis(const HIST_AXIS *a) {
+	if((a->bins==0) || (a->bins>HIST_MAX_BINS)) {
+	    return FALSE;
+	}
+	if(a->scale==HIST_LINEAR) {
+	    return a->width!=0;
+	}
+	return (a->scale==HIST_LOG) && (a->shift<=HIST_MAX_SHIFT) &&
+	    (a->lo>0);
+}
+
+void histogram_init(HISTOGRAM *h, int quantity, const HIST_AXIS *a) {
+	memset(h,0,sizeof(HISTOGRAM));
+	h->quantity=quantity;
+	histogram_set(h,a);
+}
+
+void histogram_set(HISTOGRAM *h, const HIST_AXIS *a) {
+	h->axis=*a;
+	__sync_synchronize();
+	h->gen++;
+}
+
+HIST_PART *histogram_join(HISTOGRAM *h) {
+	int i;
+
+	for(i=0;i<HIST_MAX_PARTS;i++) {
+	    if(__sync_bool_compare_and_swap(&h->owned[i],FALSE,TRUE)) {
+		/* a new thread's first hit has no interval */
+		h->part[i].started=FALSE;
+		return &h->part[i];
+	    }
+	}
+	return 0;
+}
+
+void histogram_leave(HISTOGRAM *h, HIST_PART *p) {
+	__sync_synchronize();
+	h->owned[p-h->part]=FALSE;
+}
+
+/* log bin index of v, above 0: the octave, then the
+   shift bits under its top bit */
+static ULONG logIndex(ULONG v, int shift) {
+	unsigned int x=(unsigned int)v;
+	int top=31-__builtin_clz(x);
+
+	return ((ULONG)top<<shift)|
+	    (((x<<(31-top))>>(31-shift))&((1U<<shift)-1));
+}
+
+/* count index of v: 0 under, 1..bins, bins+1 over */
+static int indexOf(HIST_PART *p, long long v) {
+	HIST_AXIS *a=&p->axis;
+	long long d;
+
+	if(v<a->lo) {
+	    return 0;
+	}
+	if(a->scale==HIST_LINEAR) {
+	    d=(v-a->lo)/a->width;
+	}
+	else {
+	    d=(v>HIT_TIME_MASK) ? a->bins :
+		(long long)logIndex((ULONG)v,a->shift)-p->first;
+	}
+	return (d>=a->bins) ? a->bins+1 : (int)d+1;
+}
+
+void histogram_add(HISTOGRAM *h, HIST_PART *p, HIT_RECORD *hits, int n) {
+	ULONG gen=h->gen;
+	ULONG t;
+	int i;
+
+	if(p->gen!=gen) {
+	    __sync_synchronize();
+	    p->axis=h->axis;
+	    p->first=(p->axis.scale==HIST_LOG) ?
+		logIndex((ULONG)p->axis.lo,p->axis.shift) : 0;
+	    memset(p->count,0,sizeof(p->count));
+	    p->started=FALSE;
+	    p->gen=gen;
+	}
+	if(h->quantity==HIST_ENERGY) {
+	    for(i=0;i<n;i++) {
+		p->count[indexOf(p,hits[i].dom.trig.energy)]++;
+	    }
+	    return;
+	}
+	for(i=0;i<n;i++) {
+	    t=hits[i].dom.trig.time&HIT_TIME_MASK;
+	    if(p->started) {
+		p->count[indexOf(p,(t-p->last)&HIT_TIME_MASK)]++;
+	    }
+	    p->last=t;
+	    p->started=TRUE;
+	}
+}
+
+int histogram_sum(HISTOGRAM *h, ULONG *count) {
+	ULONG gen=h->gen;
+	int bins=h->axis.bins;
+	int i;
+	int k;
+
+	memset(count,0,(HIST_MAX_BINS+2)*sizeof(ULONG));
+	for(i=0;i<HIST_MAX_PARTS;i++) {
+	    if(h->part[i].gen!=gen) {
+		continue;
+	    }
+	    for(k=0;k<bins+2;k++) {
+		count[k]+=h->part[i].count[k];
+	    }
+	}
+	return bins;
+}
+
+int histogram_encode(const ULONG *count, int bins, int format, UBYTE *out) {
+	UBYTE *start=out;
+	unsigned int zz;
+	int d;
+	int n=0;
+	int i;
+
+	if(format==HIST_SPARSE) {
+	    out+=2;
+	    for(i=0;i<bins;i++) {
+		if(count[i]!=0) {
+		    formatShort((USHORT)i,&out[0]);
+		    formatLong(count[i],&out[2]);
+		    out+=6;
+		    n++;
+		}
+	    }
+	    formatShort((USHORT)n,start);
+	    return (int)(out-start);
+	}
+	for(i=0;i<bins;i++) {
+	    d=(int)(count[i]-((i>0) ? count[i-1] : 0));
+	    zz=((unsigned int)d<<1)^(unsigned int)(d>>31);
+	    while(zz>=0x80) {
+		*out++=(UBYTE)(zz|0x80);
+		zz>>=7;
+	    }
+	    *out++=(UBYTE)zz;
+	}
+	return (int)(out-start);
+}
@@ -0,0 +1,349 @@
+/* hitBuffer.c */
+
+/* Single producer, many reader lookback ring of hits
+   held as columns, see dataAccess/hitBuffer.h */
+
+#include <string.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+
+#define HIT_BUFFER_MASK (HIT_BUFFER_LEN-1)
+
+void hitBuffer_init(HIT_BUFFER *b, int policy) {
+	int i;
+
+	for(i=0;i<HIT_BUFFER_LEN;i++) {
+	    b->seq[i]=0;
+	}
+	for(i=0;i<HIT_BUFFER_MAX_READERS;i++) {
+	    b->reader[i]=0;
+	}
+	b->head=0;
+	b->curEpoch=0;
+	b->lastTime=0;
+	b->dropped=0;
+	b->policy=policy;
+}
+
+void hitBuffer_setPolicy(HIT_BUFFER *b, int policy) {
+	b->policy=policy;
+}
+
+/* the slowest reader is a whole ring behind */
+static int full(HIT_BUFFER *b, ULONG head) {
+	HIT_READER *r;
+	int i;
+
+	for(i=0;i<HIT_BUFFER_MAX_READERS;i++) {
+	    r=b->reader[i];
+	    if((r!=0) && ((head-r->next)>=HIT_BUFFER_LEN)) {
+		return TRUE;
+	    }
+	}
+	return FALSE;
+}
+
+HIT_RECORD *hitBuffer_claim(HIT_BUFFER *b) {
+	if((b->policy==HIT_STOP) && full(b,b->head)) {
+	    b->dropped++;
+	    return 0;
+	}
+	return &b->claimed;
+}
+
+/* waveform bits and SPE of d */
+static USHORT flagsOf(DOM_DATA *d) {
+	ATWD_DESC *atwd[HIT_ATWD_CNT];
+	USHORT flags=d->trig.SPE ? HIT_FLAG_SPE : 0;
+	int i;
+
+	atwd[0]=&d->atwd0;
+	atwd[1]=&d->atwd1;
+	atwd[2]=&d->atwd2;
+	atwd[3]=&d->atwd3;
+	for(i=0;i<HIT_ATWD_CNT;i++) {
+	    if(atwd[i]->lo) {
+		flags|=ATWD0_LO_PRES<<(2*i);
+	    }
+	    if(atwd[i]->hi) {
+		flags|=ATWD0_HI_PRES<<(2*i);
+	    }
+	}
+	return flags;
+}
+
+/* epoch of time t, counting a wrap if t is well after
+   the latest time yet numerically below it */
+static ULONG epochOf(HIT_BUFFER *b, HIT_TIME t) {
+	if((b->head==0) ||
+	    ((HIT_TIME)(t-b->lastTime)<=(HIT_TIME)(HIT_TIME_MASK/2))) {
+	    if((b->head!=0) && (t<b->lastTime)) {
+		b->curEpoch++;
+	    }
+	    b->lastTime=t;
+	    return b->curEpoch;
+	}
+	/* late, from before the last wrap if above it */
+	return ((t>b->lastTime) && (b->curEpoch>0)) ?
+	    b->curEpoch-1 : b->curEpoch;
+}
+
+void hitBuffer_publish(HIT_BUFFER *b) {
+	HIT_RECORD *h=&b->claimed;
+	ULONG head=b->head;
+	int s=head&HIT_BUFFER_MASK;
+
+	h->seq=head;
+	b->seq[s]=0;
+	__sync_synchronize();
+	b->time[s]=(HIT_TIME)h->dom.trig.time;
+	h->epoch=epochOf(b,b->time[s]);
+	b->epoch[s]=h->epoch;
+	b->energy[s]=h->dom.trig.energy;
+	b->flags[s]=flagsOf(&h->dom);
+	b->quality[s]=h->dom.trig.quality;
+	b->coinc[s]=h->dom.trig.coinc;
+	b->detail[s].contents[0]=h->dom.atwd0.contents;
+	b->detail[s].contents[1]=h->dom.atwd1.contents;
+	b->detail[s].contents[2]=h->dom.atwd2.contents;
+	b->detail[s].contents[3]=h->dom.atwd3.contents;
+	b->detail[s].adc=h->dom.adc;
+	memcpy(b->wave[s].lo,h->lo,sizeof(h->lo));
+	memcpy(b->wave[s].hi,h->hi,sizeof(h->hi));
+	__sync_synchronize();
+	b->seq[s]=head+1;
+	b->head=head+1;
+}
+
+int hitBuffer_put(HIT_BUFFER *b, HIT_RECORD *h) {
+	HIT_RECORD *to=hitBuffer_claim(b);
+
+	if(to==0) {
+	    return FALSE;
+	}
+	if(to!=h) {
+	    memcpy(to,h,sizeof(HIT_RECORD));
+	}
+	hitBuffer_publish(b);
+	return TRUE;
+}
+
+/* oldest hit that may still be held */
+static ULONG oldest(HIT_BUFFER *b) {
+	ULONG head=b->head;
+
+	return (head>=HIT_BUFFER_LEN) ? head-HIT_BUFFER_LEN : 0;
+}
+
+int hitBuffer_addReader(HIT_BUFFER *b, HIT_READER *r, int from) {
+	int i;
+
+	r->next=(from==HIT_FROM_NEW) ? b->head : oldest(b);
+	r->lost=0;
+	for(i=0;i<HIT_BUFFER_MAX_READERS;i++) {
+	    if(__sync_bool_compare_and_swap(&b->reader[i],0,r)) {
+		r->active=TRUE;
+		return 0;
+	    }
+	}
+	return -1;
+}
+
+void hitBuffer_removeReader(HIT_BUFFER *b, HIT_READER *r) {
+	int i;
+
+	for(i=0;i<HIT_BUFFER_MAX_READERS;i++) {
+	    if(b->reader[i]==r) {
+		b->reader[i]=0;
+	    }
+	}
+	r->active=FALSE;
+}
+
+static void setAtwd(ATWD_DESC *a, USHORT flags, int i, BYTE contents) {
+	a->lo=(flags&(ATWD0_LO_PRES<<(2*i)))!=0;
+	a->hi=(flags&(ATWD0_HI_PRES<<(2*i)))!=0;
+	a->contents=contents;
+}
+
+int hitBuffer_row(HIT_BUFFER *b, ULONG n, HIT_RECORD *out) {
+	int s=n&HIT_BUFFER_MASK;
+	HIT_DETAIL *d=&b->detail[s];
+	USHORT flags;
+	ULONG seq;
+
+	seq=b->seq[s];
+	__sync_synchronize();
+	if(seq!=n+1) {
+	    return FALSE;
+	}
+	flags=b->flags[s];
+	out->seq=n;
+	out->epoch=b->epoch[s];
+	out->dom.trig.time=b->time[s];
+	out->dom.trig.energy=b->energy[s];
+	out->dom.trig.coinc=b->coinc[s];
+	out->dom.trig.quality=b->quality[s];
+	out->dom.trig.SPE=(flags&HIT_FLAG_SPE)!=0;
+	setAtwd(&out->dom.atwd0,flags,0,d->contents[0]);
+	setAtwd(&out->dom.atwd1,flags,1,d->contents[1]);
+	setAtwd(&out->dom.atwd2,flags,2,d->contents[2]);
+	setAtwd(&out->dom.atwd3,flags,3,d->contents[3]);
+	out->dom.adc=d->adc;
+	memcpy(out->lo,b->wave[s].lo,sizeof(out->lo));
+	memcpy(out->hi,b->wave[s].hi,sizeof(out->hi));
+	__sync_synchronize();
+	return b->seq[s]==seq;
+}
+
+int hitBuffer_peek(HIT_BUFFER *b, HIT_READER *r, HIT_RECORD *out) {
+	ULONG next;
+	ULONG seq;
+
+	for(;;) {
+	    next=r->next;
+	    if(next==b->head) {
+		return FALSE;
+	    }
+	    if(hitBuffer_row(b,next,out)) {
+		return TRUE;
+	    }
+	    /* overwritten, go on from the oldest hit left;
+	       the one being written counts as lost too */
+	    seq=oldest(b)+1;
+	    if((long)(seq-next)<=0) {
+		seq=next+1;
+	    }
+	    r->lost+=seq-next;
+	    r->next=seq;
+	}
+}
+
+void hitBuffer_next(HIT_READER *r) {
+	r->next++;
+}
+
+ULONG hitBuffer_pending(HIT_BUFFER *b, HIT_READER *r) {
+	ULONG n=b->head-r->next;
+
+	return (n>HIT_BUFFER_LEN) ? HIT_BUFFER_LEN : n;
+}
+
+ULONG hitBuffer_find(HIT_BUFFER *b, ULONG epoch, ULONG time) {
+	ULONG lo=oldest(b);
+	ULONG hi=b->head;
+	ULONG mid;
+	int s;
+
+	/* first hit not before (epoch, time) */
+	while(lo<hi) {
+	    mid=lo+(hi-lo)/2;
+	    s=mid&HIT_BUFFER_MASK;
+	    if((b->epoch[s]<epoch) ||
+		((b->epoch[s]==epoch) && (b->time[s]<(HIT_TIME)time))) {
+		lo=mid+1;
+	    }
+	    else {
+		hi=mid;
+	    }
+	}
+	return lo;
+}
+
+/* The scans below run over one contiguous stretch of
+   each column at a time, in loops without branches the
+   compiler can vectorize. */
+
+static ULONG countTime(HIT_BUFFER *b, int from, int n, HIT_TIME t0,
+	HIT_TIME last) {
+	const HIT_TIME *time=&b->time[from];
+	unsigned int cnt=0;
+	int i;
+
+	for(i=0;i<n;i++) {
+	    cnt+=(HIT_TIME)(time[i]-t0)<=last;
+	}
+	return cnt;
+}
+
+static ULONG countFlags(HIT_BUFFER *b, int from, int n, USHORT mask,
+	USHORT want) {
+	const USHORT *flags=&b->flags[from];
+	unsigned int cnt=0;
+	int i;
+
+	for(i=0;i<n;i++) {
+	    cnt+=(flags[i]&mask)==want;
+	}
+	return cnt;
+}
+
+static ULONG selectHits(HIT_BUFFER *b, int from, int n, HIT_TIME t0,
+	HIT_TIME last, USHORT mask, USHORT want, UBYTE *match) {
+	const HIT_TIME *time=&b->time[from];
+	const USHORT *flags=&b->flags[from];
+	unsigned int cnt=0;
+	int i;
+
+	for(i=0;i<n;i++) {
+	    match[i]=((HIT_TIME)(time[i]-t0)<=last) &
+		((flags[i]&mask)==want);
+	    cnt+=match[i];
+	}
+	return cnt;
+}
+
+/* hits first.. as at most two stretches of the ring:
+   from *n1 on at the slot of first, then *n2 from slot 0 */
+static int stretches(ULONG first, ULONG n, int *n1, int *n2) {
+	int from=first&HIT_BUFFER_MASK;
+
+	if(n>HIT_BUFFER_LEN) {
+	    n=HIT_BUFFER_LEN;
+	}
+	*n1=(from+n>HIT_BUFFER_LEN) ? HIT_BUFFER_LEN-from : (int)n;
+	*n2=(int)n-*n1;
+	return from;
+}
+
+ULONG hitBuffer_countTime(HIT_BUFFER *b, ULONG first, ULONG n,
+	ULONG t0, ULONG span) {
+	int n1;
+	int n2;
+	int from=stretches(first,n,&n1,&n2);
+
+	if(span==0) {
+	    return 0;
+	}
+	/* the last tick in the window, so a span of the
+	   whole clock still fits a HIT_TIME */
+	span--;
+	return countTime(b,from,n1,(HIT_TIME)t0,(HIT_TIME)span)+
+	    countTime(b,0,n2,(HIT_TIME)t0,(HIT_TIME)span);
+}
+
+ULONG hitBuffer_countFlags(HIT_BUFFER *b, ULONG first, ULONG n,
+	USHORT mask, USHORT want) {
+	int n1;
+	int n2;
+	int from=stretches(first,n,&n1,&n2);
+
+	return countFlags(b,from,n1,mask,want)+countFlags(b,0,n2,mask,want);
+}
+
+ULONG hitBuffer_select(HIT_BUFFER *b, ULONG first, ULONG n,
+	ULONG t0, ULONG span, USHORT mask, USHORT want, UBYTE *match) {
+	int n1;
+	int n2;
+	int from=stretches(first,n,&n1,&n2);
+
+	if(span==0) {
+	    memset(match,0,n1+n2);
+	    return 0;
+	}
+	span--;
+	return selectHits(b,from,n1,(HIT_TIME)t0,(HIT_TIME)span,mask,want,
+	    match)+selectHits(b,0,n2,(HIT_TIME)t0,(HIT_TIME)span,mask,want,
+	    &match[n1]);
+}
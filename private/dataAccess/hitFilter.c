@@ -0,0 +1,135 @@
+/* hitFilter.c */
+
+/* Coinc, quality and SPE/MSPE selection of hits,
+   see dataAccess/hitFilter.h */
+
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/hitFilter.h"
+
+/* config word: minCoinc, minQuality, classes, then two
+   bits of action per rule */
+#define COINC_SHIFT 0
+#define QUALITY_SHIFT 8
+#define CLASSES_SHIFT 16
+#define ACTION_SHIFT 18
+
+static unsigned int pack(const HIT_FILTER_CONFIG *cfg) {
+	unsigned int word;
+	int i;
+
+	word=((unsigned int)cfg->minCoinc<<COINC_SHIFT)|
+	    ((unsigned int)cfg->minQuality<<QUALITY_SHIFT)|
+	    ((unsigned int)(cfg->classes&3)<<CLASSES_SHIFT);
+	for(i=0;i<HIT_FILTER_RULES;i++) {
+	    word|=(unsigned int)(cfg->action[i]&3)<<(ACTION_SHIFT+2*i);
+	}
+	return word;
+}
+
+static void unpack(unsigned int word, HIT_FILTER_CONFIG *cfg) {
+	int i;
+
+	cfg->minCoinc=(UBYTE)(word>>COINC_SHIFT);
+	cfg->minQuality=(UBYTE)(word>>QUALITY_SHIFT);
+	cfg->classes=(UBYTE)((word>>CLASSES_SHIFT)&3);
+	for(i=0;i<HIT_FILTER_RULES;i++) {
+	    cfg->action[i]=(UBYTE)((word>>(ACTION_SHIFT+2*i))&3);
+	}
+}
+
+void hitFilter_init(HIT_FILTER *f) {
+	HIT_FILTER_CONFIG cfg;
+	int i;
+
+	cfg.minCoinc=0;
+	cfg.minQuality=0;
+	cfg.classes=HIT_FILTER_SPE|HIT_FILTER_MSPE;
+	for(i=0;i<HIT_FILTER_RULES;i++) {
+	    cfg.action[i]=HIT_FILTER_KEEP;
+	    f->accepted[i]=0;
+	    f->rejected[i]=0;
+	}
+	f->kept=0;
+	f->downgraded=0;
+	f->dropped=0;
+	hitFilter_set(f,&cfg);
+}
+
+void hitFilter_set(HIT_FILTER *f, const HIT_FILTER_CONFIG *cfg) {
+	__sync_lock_test_and_set(&f->config,pack(cfg));
+}
+
+void hitFilter_get(HIT_FILTER *f, HIT_FILTER_CONFIG *cfg) {
+	unpack(f->config,cfg);
+}
+
+int hitFilter_run(HIT_FILTER *f, HIT_RECORD *h, int n, UBYTE *verdict) {
+	HIT_FILTER_CONFIG cfg;
+	UBYTE coinc[HIT_FILTER_BATCH];
+	UBYTE quality[HIT_FILTER_BATCH];
+	UBYTE spe[HIT_FILTER_BATCH];
+	unsigned int fail[HIT_FILTER_RULES];
+	unsigned int c;
+	unsigned int q;
+	unsigned int s;
+	unsigned int v;
+	int kept=0;
+	int i;
+
+	unpack(f->config,&cfg);
+	/* the fields judged, as columns */
+	for(i=0;i<n;i++) {
+	    coinc[i]=(UBYTE)h[i].dom.trig.coinc;
+	    quality[i]=(UBYTE)h[i].dom.trig.quality;
+	    spe[i]=h[i].dom.trig.SPE ? 1 : 0;
+	}
+	fail[0]=fail[1]=fail[2]=0;
+	for(i=0;i<n;i++) {
+	    c=coinc[i]<cfg.minCoinc;
+	    q=quality[i]<cfg.minQuality;
+	    /* class bit of SPE is HIT_FILTER_SPE */
+	    s=((cfg.classes>>spe[i])&1)^1;
+	    fail[0]+=c;
+	    fail[1]+=q;
+	    fail[2]+=s;
+	    v=(-c&cfg.action[HIT_FILTER_COINC])|
+		(-q&cfg.action[HIT_FILTER_QUALITY])|
+		(-s&cfg.action[HIT_FILTER_CLASS]);
+	    verdict[i]=(UBYTE)v;
+	    kept+=v!=HIT_FILTER_DROP;
+	}
+	for(i=0;i<HIT_FILTER_RULES;i++) {
+	    f->rejected[i]+=fail[i];
+	    f->accepted[i]+=n-fail[i];
+	}
+	f->kept+=kept;
+	f->dropped+=n-kept;
+
+	/* downgrades are few; drop their waveforms */
+	for(i=0;i<n;i++) {
+	    if(verdict[i]==HIT_FILTER_DOWNGRADE) {
+		h[i].dom.atwd0.lo=h[i].dom.atwd0.hi=FALSE;
+		h[i].dom.atwd1.lo=h[i].dom.atwd1.hi=FALSE;
+		h[i].dom.atwd2.lo=h[i].dom.atwd2.hi=FALSE;
+		h[i].dom.atwd3.lo=h[i].dom.atwd3.hi=FALSE;
+		f->downgraded++;
+	    }
+	}
+	return kept;
+}
+
+int hitFilter_put(HIT_FILTER *f, HIT_BUFFER *b, HIT_RECORD *h, int n) {
+	UBYTE verdict[HIT_FILTER_BATCH];
+	int took=0;
+	int i;
+
+	hitFilter_run(f,h,n,verdict);
+	for(i=0;i<n;i++) {
+	    if(verdict[i]!=HIT_FILTER_DROP) {
+		took+=hitBuffer_put(b,&h[i]);
+	    }
+	}
+	return took;
+}
@@ -0,0 +1,161 @@
+/* pulseFeatures.c */
+
+/* Baseline, threshold and pulse features of ATWD
+   waveforms, see dataAccess/pulseFeatures.h */
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/pulseFeatures.h"
+
+#define MAX_SAMPLES (ATWD_HI_LEN/2)
+#define MASK_WORDS (MAX_SAMPLES/32)
+
+static USHORT baseline(const USHORT *v, int n) {
+	unsigned int head=0;
+	unsigned int tail=0;
+	int i;
+
+	for(i=0;i<PULSE_BASELINE_LEN;i++) {
+	    head+=v[i];
+	    tail+=v[n-PULSE_BASELINE_LEN+i];
+	}
+	return (USHORT)(((head<tail) ? head : tail)/PULSE_BASELINE_LEN);
+}
+
+/* sub=v-base, 0 below base; bit i of mask set if sub[i]
+   is over thr */
+static void overThreshold(const USHORT *v, int n, USHORT base, USHORT thr,
+	USHORT *sub, unsigned int *mask) {
+	int i;
+#ifdef __AVX2__
+	__m256i b=_mm256_set1_epi16((short)base);
+	__m256i t=_mm256_set1_epi16((short)thr);
+	__m256i zero=_mm256_setzero_si256();
+	__m256i x;
+	__m256i y;
+	__m256i mx;
+	__m256i my;
+
+	for(i=0;i<n;i+=32) {
+	    x=_mm256_subs_epu16(_mm256_loadu_si256((const __m256i *)&v[i]),b);
+	    y=_mm256_subs_epu16(_mm256_loadu_si256((const __m256i *)&v[i+16]),
+		b);
+	    _mm256_storeu_si256((__m256i *)&sub[i],x);
+	    _mm256_storeu_si256((__m256i *)&sub[i+16],y);
+	    /* all ones where not over thr */
+	    mx=_mm256_cmpeq_epi16(_mm256_subs_epu16(x,t),zero);
+	    my=_mm256_cmpeq_epi16(_mm256_subs_epu16(y,t),zero);
+	    /* to bytes, the packing works per 128 bit lane */
+	    mx=_mm256_permute4x64_epi64(_mm256_packs_epi16(mx,my),0xd8);
+	    mask[i>>5]=~(unsigned int)_mm256_movemask_epi8(mx);
+	}
+#elif defined(__SSE2__)
+	__m128i b=_mm_set1_epi16((short)base);
+	__m128i t=_mm_set1_epi16((short)thr);
+	__m128i zero=_mm_setzero_si128();
+	__m128i x;
+	__m128i y;
+	unsigned int bits;
+
+	for(i=0;i<n;i+=16) {
+	    x=_mm_subs_epu16(_mm_loadu_si128((const __m128i *)&v[i]),b);
+	    y=_mm_subs_epu16(_mm_loadu_si128((const __m128i *)&v[i+8]),b);
+	    _mm_storeu_si128((__m128i *)&sub[i],x);
+	    _mm_storeu_si128((__m128i *)&sub[i+8],y);
+	    x=_mm_packs_epi16(_mm_cmpeq_epi16(_mm_subs_epu16(x,t),zero),
+		_mm_cmpeq_epi16(_mm_subs_epu16(y,t),zero));
+	    bits=~(unsigned int)_mm_movemask_epi8(x)&0xffff;
+	    if((i&16)==0) {
+		mask[i>>5]=bits;
+	    }
+	    else {
+		mask[i>>5]|=bits<<16;
+	    }
+	}
+#else
+	for(i=0;i<n;i++) {
+	    sub[i]=(v[i]>base) ? v[i]-base : 0;
+	    if((i&31)==0) {
+		mask[i>>5]=0;
+	    }
+	    mask[i>>5]|=(unsigned int)(sub[i]>thr)<<(i&31);
+	}
+#endif
+}
+
+/* features of the run over threshold from..to-1 */
+static void feature(const USHORT *sub, int from, int to,
+	PULSE_FEATURE *p) {
+	unsigned int half;
+	unsigned int rise;
+	ULONG charge=0;
+	USHORT peak=0;
+	int i;
+
+	for(i=from;i<to;i++) {
+	    charge+=sub[i];
+	    if(sub[i]>peak) {
+		peak=sub[i];
+	    }
+	}
+	p->peak=peak;
+	p->charge=charge;
+
+	/* first sample at half the peak or more, and where
+	   between it and the one before the rise crosses */
+	half=(peak+1)/2;
+	for(i=from;sub[i]<half;i++);
+	if((i==0) || (sub[i-1]>=half)) {
+	    p->time=(USHORT)(i*PULSE_TIME_SCALE);
+	    return;
+	}
+	rise=sub[i]-sub[i-1];
+	p->time=(USHORT)((i-1)*PULSE_TIME_SCALE+
+	    ((half-sub[i-1])*PULSE_TIME_SCALE+rise/2)/rise);
+}
+
+void pulseFeatures_find16(const USHORT *v, int n, USHORT threshold,
+	PULSE_FEATURES *out) {
+	USHORT sub[MAX_SAMPLES];
+	unsigned int mask[MASK_WORDS];
+	unsigned int w;
+	int from;
+	int i;
+
+	out->baseline=baseline(v,n);
+	out->cnt=0;
+	out->found=0;
+	overThreshold(v,n,out->baseline,threshold,sub,mask);
+	for(i=0;i<n;) {
+	    w=mask[i>>5]>>(i&31);
+	    if(w==0) {
+		i=(i|31)+1;
+		continue;
+	    }
+	    i+=__builtin_ctz(w);
+	    from=i;
+	    while((i<n) && (mask[i>>5]&(1u<<(i&31)))) {
+		i++;
+	    }
+	    if(out->cnt<PULSE_MAX) {
+		feature(sub,from,i,&out->pulse[out->cnt++]);
+	    }
+	    out->found++;
+	}
+}
+
+void pulseFeatures_find8(const UBYTE *v, int n, USHORT threshold,
+	PULSE_FEATURES *out) {
+	USHORT wide[MAX_SAMPLES];
+	int i;
+
+	for(i=0;i<n;i++) {
+	    wide[i]=v[i];
+	}
+	pulseFeatures_find16(wide,n,threshold,out);
+}
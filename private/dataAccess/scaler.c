@@ -0,0 +1,154 @@
+/* scaler.c */
+
+/* Scaler stream of hit counts in fixed time bins,
+   see dataAccess/scaler.h */
+
+#include <string.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/DOMdata.h"
+#include "dataAccess/hitBuffer.h"
+#include "dataAccess/scaler.h"
+
+#define RING_MASK (SCALER_RING_LEN-1)
+/* a time this far past another is taken to be before it */
+#define LATE (HIT_TIME_MASK/2+1)
+
+void scaler_init(SCALER *s, ULONG binTicks, ULONG deadTicks) {
+	memset(s,0,sizeof(SCALER));
+	s->binTicks=s->newBinTicks=binTicks;
+	s->deadTicks=s->newDeadTicks=deadTicks;
+}
+
+void scaler_set(SCALER *s, ULONG binTicks, ULONG deadTicks) {
+	s->newBinTicks=binTicks;
+	s->newDeadTicks=deadTicks;
+	__sync_synchronize();
+	s->change=TRUE;
+}
+
+static void putByte(SCALER *s, UBYTE v) {
+	s->ring[s->head&RING_MASK]=v;
+	__sync_synchronize();
+	s->head++;
+}
+
+static void putBin(SCALER *s, UBYTE count) {
+	if(s->half) {
+	    putByte(s,s->high|count);
+	}
+	else {
+	    s->high=count<<4;
+	}
+	s->half=!s->half;
+}
+
+/* n empty bins.  More than a ring of them is written as
+   the last ring; the rest would be lost anyway. */
+static void putEmpty(SCALER *s, ULONG n) {
+	ULONG bytes;
+
+	if(n>0 && s->half) {
+	    putBin(s,0);
+	    n--;
+	}
+	bytes=n/2;
+	if(bytes>SCALER_RING_LEN) {
+	    memset(s->ring,0,SCALER_RING_LEN);
+	    __sync_synchronize();
+	    s->head+=bytes;
+	    bytes=0;
+	}
+	while(bytes-->0) {
+	    putByte(s,0);
+	}
+	if(n&1) {
+	    putBin(s,0);
+	}
+}
+
+void scaler_add(SCALER *s, ULONG t) {
+	ULONG since;
+	ULONG bins;
+	ULONG count;
+
+	t&=HIT_TIME_MASK;
+	if(s->change) {
+	    s->change=FALSE;
+	    __sync_synchronize();
+	    s->binTicks=s->newBinTicks;
+	    s->deadTicks=s->newDeadTicks;
+	    if(s->started) {
+		putBin(s,s->count);
+	    }
+	    s->started=FALSE;
+	}
+	if(!s->started) {
+	    s->started=TRUE;
+	    s->binStart=t-t%s->binTicks;
+	    s->lastCounted=t;
+	    s->count=1;
+	    return;
+	}
+
+	/* close the bins t is past */
+	since=(t-s->binStart)&HIT_TIME_MASK;
+	if((since<LATE) && (since>=s->binTicks)) {
+	    bins=since/s->binTicks;
+	    putBin(s,s->count);
+	    putEmpty(s,bins-1);
+	    s->binStart=(s->binStart+bins*s->binTicks)&HIT_TIME_MASK;
+	    s->count=0;
+	}
+
+	/* counted unless in the dead time or early; the
+	   count held at SCALER_MAX */
+	since=(t-s->lastCounted)&HIT_TIME_MASK;
+	if((since<s->deadTicks) || (since>=LATE)) {
+	    s->dead++;
+	    return;
+	}
+	s->lastCounted=t;
+	count=s->count+1;
+	s->saturated+=(count==SCALER_MAX);
+	s->count=(UBYTE)(count-(count>SCALER_MAX));
+}
+
+int scaler_read(SCALER *s, UBYTE *out, int max, ULONG *first, ULONG *lost) {
+	ULONG head=s->head;
+	ULONG over;
+	ULONG n;
+	ULONG i;
+
+	__sync_synchronize();
+	if(head-s->tail>SCALER_RING_LEN) {
+	    s->lost+=head-SCALER_RING_LEN-s->tail;
+	    s->tail=head-SCALER_RING_LEN;
+	}
+	n=head-s->tail;
+	if(n>(ULONG)max) {
+	    n=max;
+	}
+	for(i=0;i<n;i++) {
+	    out[i]=s->ring[(s->tail+i)&RING_MASK];
+	}
+	__sync_synchronize();
+
+	/* the front of the copy, if the producer came round
+	   to it meanwhile; the byte it may be writing too */
+	head=s->head+1;
+	if(head-s->tail>SCALER_RING_LEN) {
+	    over=head-SCALER_RING_LEN-s->tail;
+	    if(over>n) {
+		over=n;
+	    }
+	    memmove(out,&out[over],n-over);
+	    s->lost+=over;
+	    s->tail+=over;
+	    n-=over;
+	}
+	*first=(ULONG)(2*s->tail);
+	*lost=s->lost;
+	s->lost=0;
+	s->tail+=n;
+	return (int)n;
+}
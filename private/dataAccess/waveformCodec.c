@@ -0,0 +1,275 @@
+/* waveformCodec.c */
+
+/* Difference and bit-packing coder for ATWD waveforms,
+   see dataAccess/waveformCodec.h */
+
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "domapp_common/DOMtypes.h"
+#include "dataAccess/waveformCodec.h"
+
+/* longest waveform, ATWD_HI_LEN/2 16 bit samples today */
+#define MAX_SAMPLES 256
+#define MAX_BLOCKS (MAX_SAMPLES/WAVE_CODEC_BLOCK)
+
+/* bits needed for v */
+static int bitWidth(unsigned int v) {
+	int w=0;
+
+	while(v!=0) {
+	    w++;
+	    v>>=1;
+	}
+	return w;
+}
+
+/* zigzag coded differences of v and the bit width of
+   each block of them */
+static void differences(const USHORT *v, int n, USHORT *zz,
+	int *width) {
+	short d;
+	int b;
+	int i;
+#ifdef __AVX2__
+	__m256i cur;
+	__m256i prev;
+	__m256i dv;
+	__m128i m;
+
+	/* the first 16 have no v[i-1] to load */
+	zz[0]=0;
+	for(i=1;i<16;i++) {
+	    d=(short)(v[i]-v[i-1]);
+	    zz[i]=(USHORT)((d<<1)^(d>>15));
+	}
+	for(i=16;i<n;i+=16) {
+	    cur=_mm256_loadu_si256((const __m256i *)&v[i]);
+	    prev=_mm256_loadu_si256((const __m256i *)&v[i-1]);
+	    dv=_mm256_sub_epi16(cur,prev);
+	    dv=_mm256_xor_si256(_mm256_slli_epi16(dv,1),
+		_mm256_srai_epi16(dv,15));
+	    _mm256_storeu_si256((__m256i *)&zz[i],dv);
+	}
+	/* widest difference of a block: or of all of them */
+	for(b=0;b<n/WAVE_CODEC_BLOCK;b++) {
+	    dv=_mm256_or_si256(
+		_mm256_loadu_si256((const __m256i *)&zz[b*WAVE_CODEC_BLOCK]),
+		_mm256_loadu_si256((const __m256i *)
+		&zz[b*WAVE_CODEC_BLOCK+16]));
+	    m=_mm_or_si128(_mm256_castsi256_si128(dv),
+		_mm256_extracti128_si256(dv,1));
+	    m=_mm_or_si128(m,_mm_srli_si128(m,8));
+	    m=_mm_or_si128(m,_mm_srli_si128(m,4));
+	    m=_mm_or_si128(m,_mm_srli_si128(m,2));
+	    width[b]=bitWidth(_mm_extract_epi16(m,0));
+	}
+#else
+	unsigned int any;
+
+	zz[0]=0;
+	for(i=1;i<n;i++) {
+	    d=(short)(v[i]-v[i-1]);
+	    zz[i]=(USHORT)((d<<1)^(d>>15));
+	}
+	for(b=0;b<n/WAVE_CODEC_BLOCK;b++) {
+	    any=0;
+	    for(i=0;i<WAVE_CODEC_BLOCK;i++) {
+		any|=zz[b*WAVE_CODEC_BLOCK+i];
+	    }
+	    width[b]=bitWidth(any);
+	}
+#endif
+}
+
+/* v[i]=v[i-1]+unzigzag(zz[i]), v[-1] being first */
+static void undoDifferences(const USHORT *zz, int n, USHORT first,
+	USHORT *v) {
+	int i;
+#ifdef __SSE2__
+	__m128i one=_mm_set1_epi16(1);
+	__m128i carry=_mm_set1_epi16((short)first);
+	__m128i x;
+
+	for(i=0;i<n;i+=8) {
+	    x=_mm_loadu_si128((const __m128i *)&zz[i]);
+	    x=_mm_xor_si128(_mm_srli_epi16(x,1),
+		_mm_sub_epi16(_mm_setzero_si128(),_mm_and_si128(x,one)));
+	    /* running sum across the 8 lanes */
+	    x=_mm_add_epi16(x,_mm_slli_si128(x,2));
+	    x=_mm_add_epi16(x,_mm_slli_si128(x,4));
+	    x=_mm_add_epi16(x,_mm_slli_si128(x,8));
+	    x=_mm_add_epi16(x,carry);
+	    _mm_storeu_si128((__m128i *)&v[i],x);
+	    carry=_mm_set1_epi16((short)_mm_extract_epi16(x,7));
+	}
+#else
+	USHORT prev=first;
+
+	for(i=0;i<n;i++) {
+	    prev=(USHORT)(prev+((zz[i]>>1)^(USHORT)(-(zz[i]&1))));
+	    v[i]=prev;
+	}
+#endif
+}
+
+/* code v, falling back to the raw bytes */
+static int encode(const USHORT *v, int n, int size, const UBYTE *raw,
+	UBYTE *out) {
+	USHORT zz[MAX_SAMPLES];
+	int width[MAX_BLOCKS];
+	unsigned long long acc;
+	UBYTE *start=out;
+	int blocks=n/WAVE_CODEC_BLOCK;
+	int len=1+size;
+	int bits;
+	int b;
+	int i;
+
+	differences(v,n,zz,width);
+	for(b=0;b<blocks;b++) {
+	    len+=1+width[b]*WAVE_CODEC_BLOCK/8;
+	}
+	if(len>=1+n*size) {
+	    *out++=WAVE_RAW;
+	    memcpy(out,raw,n*size);
+	    return 1+n*size;
+	}
+
+	*out++=WAVE_PACKED;
+	if(size==2) {
+	    *out++=(UBYTE)(v[0]>>8);
+	}
+	*out++=(UBYTE)v[0];
+	for(b=0;b<blocks;b++) {
+	    *out++=(UBYTE)width[b];
+	    acc=0;
+	    bits=0;
+	    for(i=b*WAVE_CODEC_BLOCK;i<(b+1)*WAVE_CODEC_BLOCK;i++) {
+		acc|=(unsigned long long)zz[i]<<bits;
+		bits+=width[b];
+		while(bits>=8) {
+		    *out++=(UBYTE)acc;
+		    acc>>=8;
+		    bits-=8;
+		}
+	    }
+	}
+	return (int)(out-start);
+}
+
+/* undo encode() into v.  raw is set for WAVE_RAW. */
+static int decode(const UBYTE *in, int len, int n, int size,
+	USHORT *v, const UBYTE **raw) {
+	USHORT zz[MAX_SAMPLES];
+	unsigned long long acc;
+	const UBYTE *start=in;
+	const UBYTE *end=in+len;
+	USHORT first;
+	int blocks=n/WAVE_CODEC_BLOCK;
+	int width;
+	int bits;
+	int b;
+	int i;
+
+	*raw=0;
+	if(len<1) {
+	    return -1;
+	}
+	if(*in==WAVE_RAW) {
+	    if(len<1+n*size) {
+		return -1;
+	    }
+	    *raw=in+1;
+	    return 1+n*size;
+	}
+	if((*in++!=WAVE_PACKED) || ((end-in)<size)) {
+	    return -1;
+	}
+	first=*in++;
+	if(size==2) {
+	    first=(USHORT)((first<<8)|*in++);
+	}
+	for(b=0;b<blocks;b++) {
+	    if(in>=end) {
+		return -1;
+	    }
+	    width=*in++;
+	    if((width>16) || ((end-in)<width*WAVE_CODEC_BLOCK/8)) {
+		return -1;
+	    }
+	    acc=0;
+	    bits=0;
+	    for(i=b*WAVE_CODEC_BLOCK;i<(b+1)*WAVE_CODEC_BLOCK;i++) {
+		while(bits<width) {
+		    acc|=(unsigned long long)*in++<<bits;
+		    bits+=8;
+		}
+		zz[i]=(USHORT)(acc&((1u<<width)-1));
+		acc>>=width;
+		bits-=width;
+	    }
+	}
+	undoDifferences(zz,n,first,v);
+	return (int)(in-start);
+}
+
+int waveformCodec_encode8(const UBYTE *in, int n, UBYTE *out) {
+	USHORT v[MAX_SAMPLES];
+	int i;
+
+	for(i=0;i<n;i++) {
+	    v[i]=in[i];
+	}
+	return encode(v,n,1,in,out);
+}
+
+int waveformCodec_encode16(const USHORT *in, int n, UBYTE *out) {
+	UBYTE raw[2*MAX_SAMPLES];
+	int i;
+
+	/* raw samples go big endian, as in an uncoded hit */
+	for(i=0;i<n;i++) {
+	    raw[2*i]=(UBYTE)(in[i]>>8);
+	    raw[2*i+1]=(UBYTE)in[i];
+	}
+	return encode(in,n,2,raw,out);
+}
+
+int waveformCodec_decode8(const UBYTE *in, int len, UBYTE *out, int n) {
+	USHORT v[MAX_SAMPLES];
+	const UBYTE *raw;
+	int used=decode(in,len,n,1,v,&raw);
+	int i;
+
+	if(used<0) {
+	    return -1;
+	}
+	if(raw!=0) {
+	    memcpy(out,raw,n);
+	    return used;
+	}
+	for(i=0;i<n;i++) {
+	    out[i]=(UBYTE)v[i];
+	}
+	return used;
+}
+
+int waveformCodec_decode16(const UBYTE *in, int len, USHORT *out, int n) {
+	const UBYTE *raw;
+	int used=decode(in,len,n,2,out,&raw);
+	int i;
+
+	if(used<0) {
+	    return -1;
+	}
+	if(raw!=0) {
+	    for(i=0;i<n;i++) {
+		out[i]=(USHORT)((raw[2*i]<<8)|raw[2*i+1]);
+	    }
+	}
+	return used;
+}
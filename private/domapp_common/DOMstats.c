@@ -0,0 +1,43 @@
+/* DOMstats.c */
+
+/* domapp wide statistics counter groups */
+
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/DOMstats.h"
+
+DOM_STATS localStats;
+DOM_STATS *domStats=&localStats;
+
+static void initGroups(void) {
+	statCounters_init(&pktStats,"pkt",PKT_STATS_CNT);
+	statCounters_init(&msgStats,"msg",MSG_STATS_CNT);
+	statCounters_init(&ovflStats,"ovfl",OVFL_STATS_CNT);
+}
+
+/* a group carried over from another process: its name
+   pointed into that process, and a reset it was in the
+   middle of is finished */
+static void reviveGroup(STAT_GROUP *g, const char *name) {
+	g->name=name;
+	g->resetLock=0;
+	if(g->epoch&1) {
+	    g->epoch++;
+	}
+}
+
+void DOMstats_init() {
+	domStats=&localStats;
+	initGroups();
+}
+
+void DOMstats_attach(DOM_STATS *shared, int warm) {
+	domStats=shared;
+	if(!warm) {
+	    initGroups();
+	    return;
+	}
+	reviveGroup(&pktStats,"pkt");
+	reviveGroup(&msgStats,"msg");
+	reviveGroup(&ovflStats,"ovfl");
+}
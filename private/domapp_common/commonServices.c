@@ -4,9 +4,13 @@
 /* Common code for DOM Services */
 /* like Experimental Control, Data Access, etc. */
 
+#include <string.h>
 #include "domapp_common/DOMtypes.h"
 #include "message/message.h"
 #include "domapp_common/commonServices.h"
+#include "domapp_common/DOMstats.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "domapp_common/commonMessageAPIstatus.h"
 
 /* make a big-endian long from a little-endian one */
 void formatLong(ULONG value, UBYTE *buf) {
@@ -43,3 +47,141 @@ USHORT unformatShort(UBYTE *buf) {
 	temp|=(USHORT)(*buf++);
 	return temp;
 }
+
+void commonServices_init(COMMON_SERVICE_INFO *info,
+	UBYTE majorVersion, UBYTE minorVersion) {
+	info->state=SERVICE_ONLINE;
+	info->lastErrorID=COMMON_No_Errors;
+	info->lastErrorSeverity=INFORM_ERROR;
+	info->majorVersion=majorVersion;
+	info->minorVersion=minorVersion;
+	statCounters_init(&info->stats,"svc",SVC_STATS_CNT);
+	eventRing_init(&info->events);
+	info->errorStr=NULL;
+}
+
+void commonServices_recordError(COMMON_SERVICE_INFO *info,
+	UBYTE id, UBYTE severity, MESSAGE_STRUCT *M) {
+	info->lastErrorID=id;
+	info->lastErrorSeverity=severity;
+	eventRing_put(&info->events,id,severity,
+	    Message_getType(M),Message_getSubtype(M));
+}
+
+const char *commonServices_errorStr(COMMON_SERVICE_INFO *info,
+	UBYTE id) {
+	const char *str;
+
+	if(info->errorStr!=NULL) {
+	    str=(*info->errorStr)(id);
+	    if(str!=NULL) {
+		return str;
+	    }
+	}
+	switch(id) {
+	    case COMMON_No_Errors:
+		return NULL_ERROR_STR;
+	    case COMMON_Bad_Msg_Subtype:
+		return "bad message subtype";
+	    case COMMON_Bad_Msg_Format:
+		return "bad message format";
+	    default:
+		return "unknown error";
+	}
+}
+
+void commonServices_getEvents(COMMON_SERVICE_INFO *info,
+	MESSAGE_STRUCT *M) {
+	EVENT_RECORD events[(MAXDATA_VALUE-GET_SERVICE_EVENTS_HDR_LEN)/
+	    GET_SERVICE_EVENT_REC_LEN];
+	UBYTE *data=Message_getData(M);
+	UBYTE *tmpPtr=data+GET_SERVICE_EVENTS_HDR_LEN;
+	int cnt;
+	int i;
+
+	cnt=eventRing_drain(&info->events,events,
+	    sizeof(events)/sizeof(events[0]));
+	formatLong(eventRing_takeLost(&info->events),data);
+	for(i=0;i<cnt;i++) {
+	    /* 4 byte wire longs, whatever the host ULONG */
+	    formatLong(events[i].seq,tmpPtr);
+	    tmpPtr+=4;
+	    formatLong(events[i].timeUsec,tmpPtr);
+	    tmpPtr+=4;
+	    *tmpPtr++=events[i].id;
+	    *tmpPtr++=events[i].severity;
+	    *tmpPtr++=events[i].type;
+	    *tmpPtr++=events[i].subtype;
+	}
+	Message_setDataLen(M,(int)(tmpPtr-data));
+}
+
+/* common subtypes, same formats as the Message Handler */
+UBYTE commonServices_serve(COMMON_SERVICE_INFO *info,
+	MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	UBYTE *tmpPtr;
+	ULONG stats[SVC_STATS_CNT];
+	const char *str;
+
+	switch(Message_getSubtype(M)) {
+	    case GET_SERVICE_STATE:
+		data[0]=info->state;
+		Message_setDataLen(M,GET_SERVICE_STATE_LEN);
+		return SUCCESS;
+	    case GET_LAST_ERROR_ID:
+		data[0]=info->lastErrorID;
+		data[1]=info->lastErrorSeverity;
+		Message_setDataLen(M,GET_LAST_ERROR_ID_LEN);
+		return SUCCESS;
+	    case GET_SERVICE_VERSION_INFO:
+		data[0]=info->majorVersion;
+		data[1]=info->minorVersion;
+		Message_setDataLen(M,GET_SERVICE_VERSION_INFO_LEN);
+		return SUCCESS;
+	    case GET_SERVICE_STATS:
+		statCounters_snapshot(&info->stats,stats);
+		formatLong(stats[SVC_MSG_RECEIVED],&data[0]);
+		formatLong(stats[SVC_MSG_REFUSED],&data[4]);
+		formatLong(stats[SVC_MSG_PROCESSING_ERR],&data[8]);
+		Message_setDataLen(M,GET_SERVICE_STATS_LEN);
+		return SUCCESS;
+	    case GET_LAST_ERROR_STR:
+		str=commonServices_errorStr(info,info->lastErrorID);
+		strcpy((char *)data,str);
+		Message_setDataLen(M,strlen(str));
+		return SUCCESS;
+	    case CLEAR_LAST_ERROR:
+		info->lastErrorID=COMMON_No_Errors;
+		info->lastErrorSeverity=INFORM_ERROR;
+		Message_setDataLen(M,0);
+		return SUCCESS;
+	    case GET_SERVICE_EVENTS:
+		commonServices_getEvents(info,M);
+		return SUCCESS;
+	    case GET_SERVICE_SUMMARY:
+		tmpPtr=data;
+		*tmpPtr++=info->state;
+		*tmpPtr++=info->lastErrorID;
+		*tmpPtr++=info->lastErrorSeverity;
+		*tmpPtr++=info->majorVersion;
+		*tmpPtr++=info->minorVersion;
+		statCounters_snapshot(&info->stats,stats);
+		formatLong(stats[SVC_MSG_RECEIVED],tmpPtr);
+		tmpPtr+=4;
+		formatLong(stats[SVC_MSG_REFUSED],tmpPtr);
+		tmpPtr+=4;
+		formatLong(stats[SVC_MSG_PROCESSING_ERR],tmpPtr);
+		tmpPtr+=4;
+		str=commonServices_errorStr(info,info->lastErrorID);
+		strcpy((char *)tmpPtr,str);
+		Message_setDataLen(M,(int)(tmpPtr-data)+strlen(str));
+		return SUCCESS;
+	    default:
+		STAT_INC(&info->stats,SVC_MSG_REFUSED);
+		commonServices_recordError(info,COMMON_Bad_Msg_Subtype,
+		    WARNING_ERROR,M);
+		Message_setDataLen(M,0);
+		return UNKNOWN_SUBTYPE|WARNING_ERROR;
+	}
+}
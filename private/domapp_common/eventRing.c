@@ -0,0 +1,84 @@
+/* eventRing.c */
+
+/* Lock free event records, see eventRing.h */
+
+#include <string.h>
+#include <time.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/eventRing.h"
+
+#define EVENT_RING_MASK (EVENT_RING_LEN-1)
+
+static ULONG nowUsec(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (ULONG)(ts.tv_sec*1000000+ts.tv_nsec/1000);
+}
+
+void eventRing_init(EVENT_RING *r) {
+	memset(r,0,sizeof(EVENT_RING));
+}
+
+void eventRing_put(EVENT_RING *r, UBYTE id, UBYTE severity,
+	UBYTE type, UBYTE subtype) {
+	ULONG idx=__sync_fetch_and_add(&r->head,1);
+	EVENT_RECORD *e=&r->rec[idx&EVENT_RING_MASK];
+
+	/* mark the slot busy before touching the body */
+	e->seq=0;
+	__sync_synchronize();
+	e->timeUsec=nowUsec();
+	e->id=id;
+	e->severity=severity;
+	e->type=type;
+	e->subtype=subtype;
+	__sync_synchronize();
+	e->seq=idx+1;
+}
+
+int eventRing_drain(EVENT_RING *r, EVENT_RECORD *out, int max) {
+	ULONG head=r->head;
+	ULONG seq;
+	EVENT_RECORD *e;
+	int cnt=0;
+
+	/* writers have lapped the reader */
+	if((head-r->tail)>EVENT_RING_LEN) {
+	    r->lost+=head-r->tail-EVENT_RING_LEN;
+	    r->tail=head-EVENT_RING_LEN;
+	}
+
+	while((r->tail!=head)&&(cnt<max)) {
+	    e=&r->rec[r->tail&EVENT_RING_MASK];
+	    seq=e->seq;
+	    if((seq==0)||((long)(seq-(r->tail+1))<0)) {
+		/* claimed but still being written */
+		break;
+	    }
+	    if(seq!=r->tail+1) {
+		/* overwritten since head was read */
+		r->lost++;
+		r->tail++;
+		continue;
+	    }
+	    __sync_synchronize();
+	    out[cnt]=*e;
+	    __sync_synchronize();
+	    if(e->seq!=seq) {
+		/* overwritten while copying */
+		r->lost++;
+		r->tail++;
+		continue;
+	    }
+	    out[cnt].seq=seq;
+	    cnt++;
+	    r->tail++;
+	}
+	return cnt;
+}
+
+ULONG eventRing_takeLost(EVENT_RING *r) {
+	ULONG lost=r->lost;
+	r->lost=0;
+	return lost;
+}
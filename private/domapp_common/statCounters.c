@@ -0,0 +1,74 @@
+/* statCounters.c */
+
+/* Sharded statistics counters, see statCounters.h */
+
+#include <string.h>
+#include "domapp_common/DOMtypes.h"
+#include "domapp_common/statCounters.h"
+
+__thread int statShardIdx=-1;
+int statNextShard=0;
+
+/* hand out shards round robin as threads first count */
+int statCounters_shard() {
+	statShardIdx=__sync_fetch_and_add(&statNextShard,1)%STAT_MAX_SHARDS;
+	return statShardIdx;
+}
+
+void statCounters_init(STAT_GROUP *g, const char *name, int cnt) {
+	memset(g,0,sizeof(STAT_GROUP));
+	if(cnt>(int)STAT_MAX_COUNTERS) {
+	    cnt=STAT_MAX_COUNTERS;
+	}
+	g->cnt=cnt;
+	g->name=name;
+}
+
+/* raw totals over all shards */
+static void sumShards(STAT_GROUP *g, ULONG *sums) {
+	int i;
+	int s;
+
+	for(i=0;i<g->cnt;i++) {
+	    sums[i]=0;
+	}
+	for(s=0;s<STAT_MAX_SHARDS;s++) {
+	    for(i=0;i<g->cnt;i++) {
+		sums[i]+=g->shard[s].v[i];
+	    }
+	}
+}
+
+void statCounters_snapshot(STAT_GROUP *g, ULONG *values) {
+	ULONG epoch;
+	int i;
+
+	do {
+	    epoch=g->epoch;
+	    __sync_synchronize();
+	    sumShards(g,values);
+	    for(i=0;i<g->cnt;i++) {
+		values[i]-=g->base[i];
+	    }
+	    __sync_synchronize();
+	} while((epoch&1) || (epoch!=g->epoch));
+}
+
+ULONG statCounters_read(STAT_GROUP *g, int i) {
+	ULONG values[STAT_MAX_COUNTERS];
+
+	statCounters_snapshot(g,values);
+	return values[i];
+}
+
+void statCounters_reset(STAT_GROUP *g) {
+	/* resets are rare, serialize them with a spin lock */
+	while(__sync_lock_test_and_set(&g->resetLock,1)) {
+	}
+	g->epoch++;
+	__sync_synchronize();
+	sumShards(g,g->base);
+	__sync_synchronize();
+	g->epoch++;
+	__sync_lock_release(&g->resetLock);
+}
@@ -0,0 +1,194 @@
+/* msgDispatch.c */
+
+/* Table driven message routing, see msgDispatch.h */
+
+#include <string.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "message/messageBuffers.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "domapp_common/commonMessageAPIstatus.h"
+#include "msgHandler/MSGHANDLERmessageAPIstatus.h"
+#include "msgHandler/MSGHANDLERextAPIstatus.h"
+#include "msgHandler/msgDispatch.h"
+#include "domapp_common/statCounters.h"
+#include "domapp_common/DOMstats.h"
+#include "domTrace/domTrace.h"
+
+/* message queue identifiers */
+extern int SC;
+extern int DA;
+extern int EC;
+extern int TM;
+
+
+/* handler prototypes, from the catalog */
+#define MSG_CATALOG_HANDLER(type, subtype, handler, reqLen, rspLen) \
+	extern UBYTE handler(MESSAGE_STRUCT *M);
+#define MSG_CATALOG_FORWARD(type, queue, owner, ovflIdx)
+#include "msgHandler/msgCatalog.h"
+#undef MSG_CATALOG_HANDLER
+#undef MSG_CATALOG_FORWARD
+
+/* one row per known type, indexed by subtype.  Unused
+   types share no storage. */
+MSG_DISPATCH_ENTRY *msgDispatchTable[256];
+MSG_DISPATCH_ENTRY msgDispatchRows[MSG_DISPATCH_MAX_TYPES][256];
+int msgDispatchRowsUsed=0;
+
+MSG_FORWARD_HOOK msgDispatchForwardHook=0;
+
+/* find or allocate the row for a type */
+static MSG_DISPATCH_ENTRY *typeRow(UBYTE type) {
+    MSG_DISPATCH_ENTRY *row;
+
+    row=msgDispatchTable[type];
+    if(row==0) {
+	if(msgDispatchRowsUsed>=MSG_DISPATCH_MAX_TYPES) {
+	    return 0;
+	}
+	row=msgDispatchRows[msgDispatchRowsUsed++];
+	memset(row,0,256*sizeof(MSG_DISPATCH_ENTRY));
+	msgDispatchTable[type]=row;
+    }
+    return row;
+}
+
+int msgDispatch_register(UBYTE type, UBYTE subtype,
+	MSG_HANDLER_FN handler, short reqLen, short rspLen)
+{
+    MSG_DISPATCH_ENTRY *row=typeRow(type);
+
+    if((row==0) || (row[subtype].handler!=0) ||
+	(row[subtype].queue!=0)) {
+	return -1;
+    }
+    row[subtype].handler=handler;
+    row[subtype].reqLen=reqLen;
+    row[subtype].rspLen=rspLen;
+    return 0;
+}
+
+int msgDispatch_registerForward(UBYTE type, int *queue,
+	int owner, int ovflIdx)
+{
+    MSG_DISPATCH_ENTRY *row;
+    int i;
+
+    if(msgDispatchTable[type]!=0) {
+	return -1;
+    }
+    row=typeRow(type);
+    if(row==0) {
+	return -1;
+    }
+    for(i=0;i<256;i++) {
+	row[i].queue=queue;
+	row[i].owner=owner;
+	row[i].ovflIdx=ovflIdx;
+	row[i].reqLen=MSG_LEN_ANY;
+	row[i].rspLen=MSG_LEN_ANY;
+    }
+    return 0;
+}
+
+int msgDispatch_init()
+{
+    int sts=0;
+
+    memset(msgDispatchTable,0,sizeof(msgDispatchTable));
+    msgDispatchRowsUsed=0;
+
+#define MSG_CATALOG_HANDLER(type, subtype, handler, reqLen, rspLen) \
+    sts|=msgDispatch_register(type,subtype,handler,reqLen,rspLen);
+#define MSG_CATALOG_FORWARD(type, queue, owner, ovflIdx) \
+    sts|=msgDispatch_registerForward(type,&queue,owner,ovflIdx);
+#include "msgHandler/msgCatalog.h"
+#undef MSG_CATALOG_HANDLER
+#undef MSG_CATALOG_FORWARD
+
+    return sts;
+}
+
+void msgDispatch_setForwardHook(MSG_FORWARD_HOOK hook)
+{
+    msgDispatchForwardHook=hook;
+}
+
+MSG_DISPATCH_ENTRY *msgDispatch_lookup(UBYTE type, UBYTE subtype)
+{
+    MSG_DISPATCH_ENTRY *e;
+
+    if(msgDispatchTable[type]==0) {
+	return 0;
+    }
+    e=&msgDispatchTable[type][subtype];
+    if((e->handler==0) && (e->queue==0)) {
+	return 0;
+    }
+    return e;
+}
+
+int msgDispatch_knownType(UBYTE type)
+{
+    return (msgDispatchTable[type]!=0);
+}
+
+/* validate and run a local handler */
+static int runHandler(MSG_DISPATCH_ENTRY *e, MESSAGE_STRUCT *M)
+{
+    UBYTE status;
+
+    if((e->reqLen!=MSG_LEN_ANY) && (Message_dataLen(M)!=e->reqLen)) {
+	return MSG_DISPATCH_BAD_FORMAT;
+    }
+    DOMTRACE(M,DOMTRACE_DISPATCH);
+    status=(*e->handler)(M);
+    if(status==MSG_HANDLER_KEPT) {
+	/* the handler answers it later */
+	return MSG_DISPATCH_FORWARDED;
+    }
+    DOMTRACE(M,DOMTRACE_SERVICE_DONE);
+    if(e->rspLen!=MSG_LEN_ANY) {
+	Message_setDataLen(M,e->rspLen);
+    }
+    Message_setStatus(M,status);
+    return MSG_DISPATCH_DONE;
+}
+
+/* look up a message, setting the code for a miss */
+static MSG_DISPATCH_ENTRY *lookupMessage(MESSAGE_STRUCT *M, int *code)
+{
+    MSG_DISPATCH_ENTRY *e;
+
+    e=msgDispatch_lookup(Message_getType(M),Message_getSubtype(M));
+    if(e==0) {
+	*code=msgDispatch_knownType(Message_getType(M)) ?
+	    MSG_DISPATCH_UNKNOWN_SUBTYPE : MSG_DISPATCH_UNKNOWN_SERVER;
+    }
+    return e;
+}
+
+int msgDispatch_route(MESSAGE_STRUCT *M)
+{
+    MSG_DISPATCH_ENTRY *e;
+    int code;
+
+    e=lookupMessage(M,&code);
+    if(e==0) {
+	return code;
+    }
+
+    if(e->queue!=0) {
+	messageBuffers_setOwner(M,e->owner);
+	if(Message_forward(M,*e->queue) < 0) {
+	    STAT_INC(&ovflStats,e->ovflIdx);
+	    return MSG_DISPATCH_STACK_FULL;
+	}
+	if(msgDispatchForwardHook!=0) {
+	    (*msgDispatchForwardHook)(*e->queue);
+	}
+	return MSG_DISPATCH_FORWARDED;
+    }
+    return runHandler(e,M);
+}
@@ -7,6 +7,7 @@
 */ 
 
 //#include "rtxstdio.h"
+#include <string.h>
 #include "domapp_common/DOMtypes.h"
 #include "msgHandler/msgHandler.h"
 #include "message/Message.h"
@@ -14,9 +15,15 @@
 #include "domapp_common/commonServices.h"
 #include "domapp_common/commonMessageAPIstatus.h"
 #include "msgHandler/MSGHANDLERmessageAPIstatus.h"
+#include "message/messageBuffers.h"
+#include "msgHandler/MSGHANDLERextAPIstatus.h"
+#include "msgHandler/msgDispatch.h"
+#include "domapp_common/DOMstats.h"
+#include "domTrace/domTrace.h"
 
 /* extern functions */
 extern void formatLong(ULONG value, UBYTE *buf);
+extern void formatShort(USHORT value, UBYTE *buf);
 extern USHORT unformatShort(UBYTE *buf);
 extern ULONG unformatLong(UBYTE *buf);
 
@@ -28,349 +35,606 @@ extern int EC;
 extern int DA;
 extern int TM;
 
-ULONG SlowCntStackOvfl=0;
-ULONG DataAccStackOvfl=0;
-ULONG ExpCntStackOvfl=0;
-ULONG SenderStackOvfl=0;
-
-
-/* packet driver counters, etc. */
-extern 	ULONG PKTrecv;
-extern	ULONG PKTsent;
-extern	ULONG NoStorage;
-extern	ULONG FreeListCorrupt;
-extern	ULONG PKTbufOvr;
-extern	ULONG PKTbadFmt;
-extern  ULONG PKTspare;
-
-extern  ULONG MSGrecv;
-extern	ULONG MSGsent;
-extern	ULONG tooMuchData;
-extern	ULONG IDMismatch;
-extern  ULONG CRCproblem;
+/* packet driver, message and queue overflow counters */
+/*	are the groups in domapp_common/DOMstats.h */
 
 	
 /* struct that contains common service info for
 	this service. */
 COMMON_SERVICE_INFO msgHand;
 
-void *msgHandler(void *arg)
-{
+/* a compound request waiting on a service's reply */
+typedef struct {
+	MESSAGE_STRUCT *M;	/* 0 if free */
+	UBYTE request[MAXDATA_VALUE];
+	int in;			/* next entry in request */
+	int end;
+	int out;		/* next reply entry in M */
+	int cnt;
+} COMPOUND_CTX;
 
-	MESSAGE_STRUCT *M;
-	int msgReject=FALSE;
-	UBYTE *data;
-	UBYTE *tmpPtr;
-	int tmpInt;
+/* msgHandler is single threaded, no locking */
+COMPOUND_CTX compounds[MSGHAND_COMPOUND_MAX];
+
+/* most buffers that can be listed in one reply */
+#define MAX_BUF_OWNERS (MAXDATA_VALUE/MSGHAND_BUF_OWNER_REC_LEN)
+
+/* copy the trailing part of an allocation site file
+   name into a fixed size, zero padded field */
+static void formatSite(const char *file, UBYTE *buf) {
+	int len=strlen(file);
+	if(len>MSGHAND_BUF_FILE_LEN) {
+	    file+=len-MSGHAND_BUF_FILE_LEN;
+	    len=MSGHAND_BUF_FILE_LEN;
+	}
+	memset(buf,0,MSGHAND_BUF_FILE_LEN);
+	memcpy(buf,file,len);
+}
+
+/* error text, looked up only when someone asks for it */
+static const char *msgHand_errorStr(UBYTE id) {
+	switch(id) {
+	    case COMMON_No_Errors:
+		return MSGHAND_ERS_NO_ERRORS;
+	    case COMMON_Bad_Msg_Subtype:
+		return MSGHAND_ERS_BAD_MSG_SUBTYPE;
+	    case COMMON_Bad_Msg_Format:
+		return MSGHAND_ERS_BAD_MSG_FORMAT;
+	    case MSGHAND_server_stack_full:
+		return MSGHAND_SERVER_STACK_FULL;
+	    case MSGHAND_unknown_server:
+		return MSGHAND_UNKNOWN_SERVER;
+	    default:
+		return NULL;
+	}
+}
+
+/* Message Handler subtype handlers, listed in
+   msgHandler/msgHandlerCatalog.h.  Each fills in the
+   reply in place and returns the message status; the
+   dispatcher applies the catalog's response length. */
+
+/* Manditory Service SubTypes */
+UBYTE msgHand_getServiceState(MESSAGE_STRUCT *M) {
+	/* get current state of Message Handler */
+	Message_getData(M)[0]=msgHand.state;
+	return SUCCESS;
+}
+
+UBYTE msgHand_getLastErrorID(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	/* get the ID of the last error encountered */
+	data[0]=msgHand.lastErrorID;
+	data[1]=msgHand.lastErrorSeverity;
+	return SUCCESS;
+}
+
+UBYTE msgHand_getServiceVersionInfo(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	/* get the major and minor version of this */
+	/*	Message Handler */
+	data[0]=msgHand.majorVersion;
+	data[1]=msgHand.minorVersion;
+	return SUCCESS;
+}
+
+UBYTE msgHand_getServiceStats(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	ULONG stats[SVC_STATS_CNT];
+	/* get standard service statistics for */
+	/*	the Message Handler */
+	statCounters_snapshot(&msgHand.stats,stats);
+	formatLong(stats[SVC_MSG_RECEIVED],&data[0]);
+	formatLong(stats[SVC_MSG_REFUSED],&data[4]);
+	formatLong(stats[SVC_MSG_PROCESSING_ERR],&data[8]);
+	return SUCCESS;
+}
+
+UBYTE msgHand_getLastErrorStr(MESSAGE_STRUCT *M) {
+	const char *str=commonServices_errorStr(&msgHand,
+	    msgHand.lastErrorID);
+	/* get error string for last error encountered */
+	strcpy(Message_getData(M),str);
+	Message_setDataLen(M,strlen(str));
+	return SUCCESS;
+}
+
+UBYTE msgHand_clearLastError(MESSAGE_STRUCT *M) {
+	/* reset last error ID, the string follows from it */
+	msgHand.lastErrorID=COMMON_No_Errors;
+	msgHand.lastErrorSeverity=INFORM_ERROR;
+	return SUCCESS;
+}
+
+UBYTE msgHand_remoteObjectRef(MESSAGE_STRUCT *M) {
+	/* remote object reference */
+	/*	TO BE IMPLEMENTED..... */
+	STAT_INC(&msgHand.stats,SVC_MSG_PROCESSING_ERR);
+	commonServices_recordError(&msgHand,COMMON_Bad_Msg_Subtype,
+	    WARNING_ERROR,M);
+	return UNKNOWN_SUBTYPE|WARNING_ERROR;
+}
+
+UBYTE msgHand_getServiceEvents(MESSAGE_STRUCT *M) {
+	/* drain the Message Handler's error history */
+	commonServices_getEvents(&msgHand,M);
+	return SUCCESS;
+}
+
+UBYTE msgHand_getServiceSummary(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	/* init a temporary buffer pointer */
+	UBYTE *tmpPtr=data;
+	ULONG stats[SVC_STATS_CNT];
+	const char *str=commonServices_errorStr(&msgHand,
+	    msgHand.lastErrorID);
+
+	statCounters_snapshot(&msgHand.stats,stats);
+	/* get current state of Message Handler */
+	*tmpPtr++=msgHand.state;
+	/* get the ID of the last error encountered */
+	*tmpPtr++=msgHand.lastErrorID;
+	*tmpPtr++=msgHand.lastErrorSeverity;
+	/* get the major and minor version of this */
+	/*	Message Handler */
+	*tmpPtr++=msgHand.majorVersion;
+	*tmpPtr++=msgHand.minorVersion;
+	/* get standard service statistics for */
+	/*	the Message Handler */
+	formatLong(stats[SVC_MSG_RECEIVED],tmpPtr);
+	tmpPtr+=4;
+	formatLong(stats[SVC_MSG_REFUSED],tmpPtr);
+	tmpPtr+=4;
+	formatLong(stats[SVC_MSG_PROCESSING_ERR],tmpPtr);
+	tmpPtr+=4;
+	/* get error string for last error encountered */
+	strcpy(tmpPtr,str);
+
+	Message_setDataLen(M,(int)(tmpPtr-data)+strlen(str));
+	return SUCCESS;
+}
+
+/* Message Handler specific SubTypes */
+UBYTE msgHand_getDomVer(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	/* get the major and minor version of this */
+	/*	DOM hardware */
+	data[0]=0;
+	data[1]=1;
+	return SUCCESS;
+}
+
+UBYTE msgHand_getDomID(MESSAGE_STRUCT *M) {
+	/* get the id of this DOM hardware */
+	formatLong(123456,Message_getData(M));
+	return SUCCESS;
+}
+
+UBYTE msgHand_getDomName(MESSAGE_STRUCT *M) {
+	/* get given name of this DOM hardware */
+	strcpy(Message_getData(M),"Rupert J. Dom");
+	Message_setDataLen(M,strlen("Rupert J Dom"));
+	return SUCCESS;
+}
+
+UBYTE msgHand_getAtwdID(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	/* get ID's of installed ATWD's */
+	formatLong(1234,&data[0]);
+	formatLong(1235,&data[4]);
+	return SUCCESS;
+}
+
+UBYTE msgHand_getPktStats(MESSAGE_STRUCT *M) {
+	/* init a temporary buffer pointer */
+	UBYTE *tmpPtr=Message_getData(M);
+	ULONG pkt[PKT_STATS_CNT];
+
+	/* get packet driver statistics */
+	statCounters_snapshot(&pktStats,pkt);
+	formatLong(pkt[PKT_RECV],tmpPtr);
+	tmpPtr+=4;
+	formatLong(pkt[PKT_SENT],tmpPtr);
+	tmpPtr+=4;
+	formatLong(pkt[PKT_NO_STORAGE],tmpPtr);
+	tmpPtr+=4;
+	/* corruption is detected by the pool itself */
+	formatLong(messageBuffers_corruptCnt(),tmpPtr);
+	tmpPtr+=4;
+	formatLong(pkt[PKT_BUF_OVR],tmpPtr);
+	tmpPtr+=4;
+	formatLong(pkt[PKT_BAD_FMT],tmpPtr);
+	tmpPtr+=4;
+	formatLong(pkt[PKT_SPARE],tmpPtr);
+	tmpPtr+=4;
+	return SUCCESS;
+}
+
+UBYTE msgHand_getMsgStats(MESSAGE_STRUCT *M) {
+	/* init a temporary buffer pointer */
+	UBYTE *tmpPtr=Message_getData(M);
+	ULONG msg[MSG_STATS_CNT];
+
+	/* get message level statistics */
+	statCounters_snapshot(&msgStats,msg);
+	formatLong(msg[MSG_RECV],tmpPtr);
+	tmpPtr+=4;
+	formatLong(msg[MSG_SENT],tmpPtr);
+	tmpPtr+=4;
+	formatLong(msg[MSG_TOO_MUCH_DATA],tmpPtr);
+	tmpPtr+=4;
+	formatLong(msg[MSG_ID_MISMATCH],tmpPtr);
+	tmpPtr+=4;
+	formatLong(msg[MSG_CRC_PROBLEM],tmpPtr);
+	tmpPtr+=4;
+	return SUCCESS;
+}
+
+UBYTE msgHand_clrPktStats(MESSAGE_STRUCT *M) {
+	/* reset packet level stats */
+	statCounters_reset(&pktStats);
+	messageBuffers_clearCorrupt();
+	return SUCCESS;
+}
+
+UBYTE msgHand_clrMsgStats(MESSAGE_STRUCT *M) {
+	/* reset message level stats */
+	statCounters_reset(&msgStats);
+	return SUCCESS;
+}
+
+UBYTE msgHand_echoMsg(MESSAGE_STRUCT *M) {
+	/* echo the incoming message, data length unchanged */
+	return SUCCESS;
+}
+
+UBYTE msgHand_getDomPosition(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	data[0]=0;
+	data[1]=2;
+	return SUCCESS;
+}
+
+UBYTE msgHand_getBufStats(MESSAGE_STRUCT *M) {
+	MSGBUF_STATS bufStats;
+	UBYTE *tmpPtr=Message_getData(M);
 	int i;
 
-    msgHand.state=SERVICE_ONLINE;
-    msgHand.lastErrorID=COMMON_No_Errors;
-    msgHand.lastErrorSeverity=INFORM_ERROR;
-    msgHand.majorVersion=MSGHANDLER_MAJOR_VERSION;
-    msgHand.minorVersion=MSGHANDLER_MINOR_VERSION;
-    strcpy(msgHand.lastErrorStr,MSGHAND_ERS_NO_ERRORS);
-    msgHand.msgReceived=0;
-    msgHand.msgRefused=0;
-    msgHand.msgProcessingErr=0;
+	/* get message buffer pool telemetry, 4 bytes a
+	   field whatever the width of ULONG */
+	messageBuffers_getStats(&bufStats);
+	formatLong(bufStats.totalCnt,tmpPtr);
+	tmpPtr+=4;
+	formatLong(bufStats.freeCnt,tmpPtr);
+	tmpPtr+=4;
+	formatLong(bufStats.lowWater,tmpPtr);
+	tmpPtr+=4;
+	formatLong(bufStats.allocCnt,tmpPtr);
+	tmpPtr+=4;
+	formatLong(bufStats.releaseCnt,tmpPtr);
+	tmpPtr+=4;
+	formatLong(bufStats.allocFail,tmpPtr);
+	tmpPtr+=4;
+	formatLong(bufStats.freeListCorrupt,tmpPtr);
+	tmpPtr+=4;
+	for(i=0;i<MSGBUF_OWNER_CNT;i++) {
+	    formatLong(bufStats.census[i],tmpPtr);
+	    tmpPtr+=4;
+	}
+	return SUCCESS;
+}
 
-    /* perform DOM-wide initialization functions at startup */
-    //FPGAPLDapi_init();
+UBYTE msgHand_clrBufStats(MESSAGE_STRUCT *M) {
+	messageBuffers_clearStats();
+	return SUCCESS;
+}
 
-    /* endless loop on control fifo */
-    for (;;) {
-	Message_receive (&M,RD);
-	/* preset the msgReject flag */
-	msgReject=FALSE;
-	switch ( Message_getType(M) ) {
-
-	    case DOM_SLOW_CONTROL:
-		/* push message on ControlStack */
-		if(!Message_forward(M,SC)) {
-		    SlowCntStackOvfl++;
-		    msgReject=TRUE;
-		    msgHand.msgProcessingErr++;
-		    strcpy(msgHand.lastErrorStr,
-			MSGHAND_SERVER_STACK_FULL);
-		    msgHand.lastErrorID=MSGHAND_server_stack_full;
-		    Message_setStatus(M,
-			SERVER_STACK_FULL|SEVERE_ERROR);
-		}
+UBYTE msgHand_getBufOwners(MESSAGE_STRUCT *M) {
+	static MSGBUF_OUTSTANDING bufOwners[MAX_BUF_OWNERS];
+	UBYTE *data=Message_getData(M);
+	UBYTE *tmpPtr=data;
+	int cnt;
+	int i;
+
+	/* list outstanding buffers, allocation site */
+	/*	is only recorded in debug builds */
+	cnt=messageBuffers_outstanding(bufOwners,MAX_BUF_OWNERS);
+	for(i=0;i<cnt;i++) {
+	    *tmpPtr++=(UBYTE)bufOwners[i].slot;
+	    *tmpPtr++=(UBYTE)bufOwners[i].owner;
+	    formatShort((USHORT)bufOwners[i].line,tmpPtr);
+	    tmpPtr+=sizeof(USHORT);
+	    formatLong(bufOwners[i].ageMsec,tmpPtr);
+	    tmpPtr+=4;
+	    formatSite(bufOwners[i].file,tmpPtr);
+	    tmpPtr+=MSGHAND_BUF_FILE_LEN;
+	}
+	Message_setDataLen(M,(int)(tmpPtr-data));
+	return SUCCESS;
+}
+
+/* record why a message could not be handled and mark
+   it for return to the sender */
+static void rejectMessage(int code, MESSAGE_STRUCT *M) {
+	switch (code) {
+
+	    case MSG_DISPATCH_STACK_FULL:
+		STAT_INC(&msgHand.stats,SVC_MSG_PROCESSING_ERR);
+		commonServices_recordError(&msgHand,
+		    MSGHAND_server_stack_full,SEVERE_ERROR,M);
+		Message_setDataLen(M,0);
+		Message_setStatus(M,
+		    SERVER_STACK_FULL|SEVERE_ERROR);
 		break;
 
-	    /* case DATA_ACCESS: */
-		/* push message on LookBackStack */
-		/* if(!Message_forward(M,DA)) {
-		    DataAccStackOvfl++;
-		    msgReject=TRUE;
-		    msgHand.msgProcessingErr++;
-		    strcpy(msgHand.lastErrorStr,
-			MSGHAND_SERVER_STACK_FULL);
-		    msgHand.lastErrorID=MSGHAND_server_stack_full;
-		    Message_setStatus(M,
-			SERVER_STACK_FULL|SEVERE_ERROR);
-		}
-		break; */
-
-	    case EXPERIMENT_CONTROL:
-	        /* push message on LookBackStack */
-	        if(!Message_forward(M,EC)) {
-		    ExpCntStackOvfl++;
-		    msgReject=TRUE;
-		    msgHand.msgProcessingErr++;
-		    strcpy(msgHand.lastErrorStr,
-			MSGHAND_SERVER_STACK_FULL);
-		    msgHand.lastErrorID=MSGHAND_server_stack_full;
-		    Message_setStatus(M,
-			SERVER_STACK_FULL|SEVERE_ERROR);
-		}
+	    case MSG_DISPATCH_BAD_FORMAT:
+		/* request length does not match the catalog */
+		STAT_INC(&msgHand.stats,SVC_MSG_REFUSED);
+		commonServices_recordError(&msgHand,
+		    COMMON_Bad_Msg_Format,WARNING_ERROR,M);
+		Message_setDataLen(M,0);
+		Message_setStatus(M,
+		    SERVER_PROTOCOL_ERROR|WARNING_ERROR);
 		break;
 
-	    case TEST_MANAGER:
-		/* push message on LookBackStack */
-		if(!Message_forward(M,TM)) {
-		    ExpCntStackOvfl++;
-		    msgReject=TRUE;
-		    msgHand.msgProcessingErr++;
-		    strcpy(msgHand.lastErrorStr,
-			MSGHAND_SERVER_STACK_FULL);
-		    msgHand.lastErrorID=MSGHAND_server_stack_full;
-		    Message_setStatus(M,
-			SERVER_STACK_FULL|SEVERE_ERROR);
-		}
+	    case MSG_DISPATCH_UNKNOWN_SUBTYPE:
+		/* unknown service request (i.e. message */
+		/*	subtype), respond accordingly */
+		STAT_INC(&msgHand.stats,SVC_MSG_REFUSED);
+		commonServices_recordError(&msgHand,
+		    COMMON_Bad_Msg_Subtype,WARNING_ERROR,M);
+		Message_setStatus(M,
+		    UNKNOWN_SUBTYPE|WARNING_ERROR);
 		break;
 
-	    case MESSAGE_HANDLER:
-		/* get address of data portion. */
-		/* Receiver ALWAYS links a message */
-		/* to a valid data buffer-even */ 
-		/* if it is empty. */
-		data=Message_getData(M);
-		msgHand.msgReceived++;
-		switch ( Message_getSubtype(M) ) {
-	    	    /* Manditory Service SubTypes */
-		    case GET_SERVICE_STATE:
-			/* get current state of Message Handler */
-			data[0]=msgHand.state;
-			Message_setDataLen(M,GET_SERVICE_STATE_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case GET_LAST_ERROR_ID:
-			/* get the ID of the last error encountered */
-			data[0]=msgHand.lastErrorID;
-			data[1]=msgHand.lastErrorSeverity;
-			Message_setDataLen(M,GET_LAST_ERROR_ID_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case GET_SERVICE_VERSION_INFO:
-			/* get the major and minor version of this */
-			/*	Message Handler */
-			data[0]=msgHand.majorVersion;
-			data[1]=msgHand.minorVersion;
-			Message_setDataLen(M,GET_SERVICE_VERSION_INFO_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case GET_SERVICE_STATS:
-			/* get standard service statistics for */
-			/*	the Message Handler */
-			formatLong(msgHand.msgReceived,&data[0]);
-			formatLong(msgHand.msgRefused,&data[4]);
-			formatLong(msgHand.msgProcessingErr,&data[8]);
-			Message_setDataLen(M,GET_SERVICE_STATS_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case GET_LAST_ERROR_STR:
-			/* get error string for last error encountered */
-			strcpy(data,msgHand.lastErrorStr);
-			Message_setDataLen(M,strlen(msgHand.lastErrorStr));
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case CLEAR_LAST_ERROR:
-			/* reset both last error ID and string */
-			msgHand.lastErrorID=COMMON_No_Errors;
-			msgHand.lastErrorSeverity=INFORM_ERROR;
-			strcpy(msgHand.lastErrorStr,
-			    MSGHAND_ERS_NO_ERRORS);
-			Message_setDataLen(M,0);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case REMOTE_OBJECT_REF:
-			/* remote object reference */
-			/*	TO BE IMPLEMENTED..... */
-			msgHand.msgProcessingErr++;
-			strcpy(msgHand.lastErrorStr,
-			MSGHAND_ERS_BAD_MSG_SUBTYPE);
-			msgHand.lastErrorID=COMMON_Bad_Msg_Subtype;
-			msgHand.lastErrorSeverity=WARNING_ERROR;
-			Message_setDataLen(M,0);
-			Message_setStatus(M,
-			    UNKNOWN_SUBTYPE|WARNING_ERROR);
-			break;
-		    case GET_SERVICE_SUMMARY:
-			/* init a temporary buffer pointer */
-			tmpPtr=data;
-			/* get current state of Message Handler */
-			*tmpPtr++=msgHand.state;
-			/* get the ID of the last error encountered */
-			*tmpPtr++=msgHand.lastErrorID;
-			*tmpPtr++=msgHand.lastErrorSeverity;
-			/* get the major and minor version of this */
-			/*	Message Handler */
-			*tmpPtr++=msgHand.majorVersion;
-			*tmpPtr++=msgHand.minorVersion;
-			/* get standard service statistics for */
-			/*	the Message Handler */
-			formatLong(msgHand.msgReceived,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(msgHand.msgRefused,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(msgHand.msgProcessingErr,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			/* get error string for last error encountered */
-			strcpy(tmpPtr,msgHand.lastErrorStr);
-
-			Message_setDataLen(M,(int)(tmpPtr-data)+
-			strlen(msgHand.lastErrorStr));
-			Message_setStatus(M,SUCCESS);
-			break;
-	  	    /*------------------------------- */
-		    /* Message Handler specific SubTypes */
-		    case MSGHAND_GET_DOM_VER:
-			/* get the major and minor version of this */
-			/*	DOM hardware */
-			data[0]=0;
-			data[1]=1;
-			Message_setDataLen(M,
-			MSGHAND_GET_DOM_VERSION_INFO_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_GET_DOM_ID:
-			/* get the id of this DOM hardware */
-			formatLong(123456,data);
-			Message_setDataLen(M,
-			    MSGHAND_GET_DOM_ID_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_GET_DOM_NAME:
-			/* get given name of this DOM hardware */
-			strcpy(data,"Rupert J. Dom");
-			Message_setDataLen(M,strlen("Rupert J Dom"));
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_GET_ATWD_ID:
-			/* get ID's of installed ATWD's */
-			formatLong(1234,&data[0]);
-			formatLong(1235,&data[4]);
-			Message_setDataLen(M,MSGHAND_GET_ATWD_ID_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_GET_PKT_STATS:
-			/* init a temporary buffer pointer */
-			tmpPtr=data;
-			/* get packet driver statistics */
-			formatLong(PKTrecv,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(PKTsent,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(NoStorage,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(FreeListCorrupt,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(PKTbufOvr,tmpPtr);
-			tmpPtr+=sizeof(ULONG);					
-			formatLong(PKTbadFmt,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(PKTspare,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			Message_setDataLen(M,MSGHAND_GET_PKT_STATS_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_GET_MSG_STATS:
-			/* init a temporary buffer pointer */
-			tmpPtr=data;
-			/* get packet driver statistics */
-			formatLong(MSGrecv,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(MSGsent,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(tooMuchData,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(IDMismatch,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			formatLong(CRCproblem,tmpPtr);
-			tmpPtr+=sizeof(ULONG);
-			Message_setDataLen(M,MSGHAND_GET_MSG_STATS_LEN);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_CLR_PKT_STATS:
-			/* reset packet level stats */
-			PKTrecv=0;
-			PKTsent=0;
-			NoStorage=0;
-			FreeListCorrupt=0;
-			PKTbufOvr=0;
-			PKTbadFmt=0;
-			PKTspare=0;
-			Message_setDataLen(M,0);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_CLR_MSG_STATS:
-			/* reset message level stats */
-			MSGrecv=0;
-			MSGsent=0;
-			tooMuchData=0;
-			IDMismatch=0;
-			CRCproblem=0;
-			Message_setDataLen(M,0);
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_ECHO_MSG:
-			/* echo the incoming message */
-			Message_setDataLen(M,Message_dataLen(M));
-			Message_setStatus(M,SUCCESS);
-			break;
-		    case MSGHAND_GET_DOM_POSITION:
-			data[0]=0;
-			data[1]=2;
-			Message_setStatus(M,SUCCESS);
-			Message_setDataLen(M,MSGHAND_GET_DOM_POSITION_LEN);
-			break;
-		    /*----------------------------------- */
-		    /* unknown service request (i.e. message */
-		    /*	subtype), respond accordingly */
-		    default:
-			msgHand.msgRefused++;
-			strcpy(msgHand.lastErrorStr,
-			    MSGHAND_ERS_BAD_MSG_SUBTYPE);
-			msgHand.lastErrorID=COMMON_Bad_Msg_Subtype;
-			msgHand.lastErrorSeverity=WARNING_ERROR;
-			Message_setStatus(M,
-			    UNKNOWN_SUBTYPE|WARNING_ERROR);
-			break;
-		    }
-
-		    Message_send(M,SD);		
+	    default:
+		STAT_INC(&msgHand.stats,SVC_MSG_PROCESSING_ERR);
+		commonServices_recordError(&msgHand,
+		    MSGHAND_unknown_server,WARNING_ERROR,M);
+		Message_setDataLen(M,0);
+		Message_setStatus(M,
+		    UNKNOWN_SERVER|WARNING_ERROR);
 		break;
+	}
+}
 
-		default:
-		    msgReject=TRUE;
-		    msgHand.msgProcessingErr++;
-		    strcpy(msgHand.lastErrorStr,
-			MSGHAND_UNKNOWN_SERVER);
-		    msgHand.lastErrorID=MSGHAND_unknown_server;
-		    Message_setDataLen(M,0);
-		    Message_setStatus(M,
-			UNKNOWN_SERVER|WARNING_ERROR);
+/* send a reply back to the DAQ */
+static void sendReply(MESSAGE_STRUCT *M) {
+	/* Sender will perform the free() on */
+	/* the data buffer. */
+	messageBuffers_setOwner(M,MSGBUF_OWNER_SD);
+	DOMTRACE(M,DOMTRACE_SD_ENQUEUE);
+	Message_send(M,SD);
+}
+
+/* append the reply to one entry of compound request c,
+   room for its header was kept before it ran.  Returns
+   FALSE if its data did not fit and only the header went
+   in. */
+static int compoundAppend(COMPOUND_CTX *c, MESSAGE_STRUCT *sub) {
+	UBYTE *out=Message_getData(c->M)+c->out;
+	int subLen=Message_dataLen(sub);
+	int fits=((MAXDATA_VALUE-c->out)>=
+	    (MSGHAND_COMPOUND_RSP_ENTRY_LEN+subLen));
+
+	*out++=Message_getType(sub);
+	*out++=Message_getSubtype(sub);
+	*out++=Message_getStatus(sub);
+	if(!fits) {
+	    formatShort(MSGHAND_COMPOUND_NO_REPLY,out);
+	    c->out+=MSGHAND_COMPOUND_RSP_ENTRY_LEN;
+	    c->cnt++;
+	    return FALSE;
+	}
+	formatShort((USHORT)subLen,out);
+	out+=sizeof(USHORT);
+	memcpy(out,Message_getData(sub),subLen);
+	c->out+=MSGHAND_COMPOUND_RSP_ENTRY_LEN+subLen;
+	c->cnt++;
+	return TRUE;
+}
+
+/* room a reply entry needs, as far as the catalog knows */
+static int compoundNeed(UBYTE type, UBYTE subtype) {
+	MSG_DISPATCH_ENTRY *e=msgDispatch_lookup(type,subtype);
+
+	if((e==0) || (e->rspLen==MSG_LEN_ANY)) {
+	    return MSGHAND_COMPOUND_RSP_ENTRY_LEN;
+	}
+	return MSGHAND_COMPOUND_RSP_ENTRY_LEN+e->rspLen;
+}
+
+/* run the entries of compound request c from where it
+   stopped, until one is forwarded to a service.  Returns
+   TRUE once the reply is complete. */
+static int compoundRun(COMPOUND_CTX *c) {
+	MESSAGE_STRUCT failed;
+	MESSAGE_STRUCT *sub;
+	UBYTE *in;
+	int argLen;
+	int code;
+	int fits;
+
+	while((c->end-c->in)>=MSGHAND_COMPOUND_ENTRY_HDR_LEN) {
+	    in=&c->request[c->in];
+	    argLen=unformatShort(&in[2]);
+	    if((c->end-c->in-MSGHAND_COMPOUND_ENTRY_HDR_LEN)<argLen) {
+		break;
+	    }
+	    /* stop before running an entry whose reply
+	       cannot go in */
+	    if((MAXDATA_VALUE-c->out)<compoundNeed(in[0],in[1])) {
+		break;
+	    }
+	    c->in+=MSGHAND_COMPOUND_ENTRY_HDR_LEN+argLen;
+
+	    sub=messageBuffers_allocate();
+	    if(sub==0) {
+		Message_init(&failed);
+		Message_setType(&failed,in[0]);
+		Message_setSubtype(&failed,in[1]);
+		rejectMessage(MSG_DISPATCH_STACK_FULL,&failed);
+		if(!compoundAppend(c,&failed)) {
 		    break;
+		}
+		continue;
 	    }
-	    if(msgReject) {
-		/* set data length to zero regardless */
-		/* of incoming message data length. */
-		Message_setDataLen(M,0);
-		/* Sender will perform the free() on */
-		/* the data buffer. */
-		Message_send(M,SD);
+	    messageBuffers_setOwner(sub,MSGBUF_OWNER_HANDLER);
+	    Message_setType(sub,in[0]);
+	    Message_setSubtype(sub,in[1]);
+	    Message_setStatus(sub,0);
+	    memcpy(Message_getData(sub),&in[MSGHAND_COMPOUND_ENTRY_HDR_LEN],
+		argLen);
+	    Message_setDataLen(sub,argLen);
+	    /* a service sends the reply back here */
+	    sub->head.hd.res[0]=MSG_DISPATCH_RETURN_FLAG;
+	    sub->head.hd.res[1]=(UBYTE)(c-compounds);
+
+	    if((Message_getType(sub)==MESSAGE_HANDLER) &&
+		(Message_getSubtype(sub)==MSGHAND_COMPOUND)) {
+		/* no nesting */
+		rejectMessage(MSG_DISPATCH_BAD_FORMAT,sub);
+	    }
+	    else {
+		code=msgDispatch_route(sub);
+		if(code==MSG_DISPATCH_FORWARDED) {
+		    /* resumed in compoundReply() */
+		    return FALSE;
+		}
+		if(code!=MSG_DISPATCH_DONE) {
+		    rejectMessage(code,sub);
+		}
+	    }
+	    fits=compoundAppend(c,sub);
+	    messageBuffers_release(sub);
+	    if(!fits) {
+		break;
+	    }
+	}
+
+	formatShort((USHORT)c->cnt,Message_getData(c->M));
+	Message_setDataLen(c->M,c->out);
+	Message_setStatus(c->M,SUCCESS);
+	return TRUE;
+}
+
+UBYTE msgHand_compound(MESSAGE_STRUCT *M) {
+	COMPOUND_CTX *c;
+	int i;
+
+	for(i=0;i<MSGHAND_COMPOUND_MAX;i++) {
+	    if(compounds[i].M==0) {
+		break;
 	    }
 	}
+	if(i==MSGHAND_COMPOUND_MAX) {
+	    /* too many waiting on services */
+	    Message_setDataLen(M,0);
+	    return SERVER_STACK_FULL|SEVERE_ERROR;
+	}
+	c=&compounds[i];
+
+	/* replies overwrite the request, work from a copy */
+	c->end=Message_dataLen(M);
+	memcpy(c->request,Message_getData(M),c->end);
+	c->M=M;
+	c->in=0;
+	c->out=MSGHAND_COMPOUND_RSP_HDR_LEN;
+	c->cnt=0;
+
+	if(!compoundRun(c)) {
+	    return MSG_HANDLER_KEPT;
+	}
+	c->M=0;
+	return SUCCESS;
+}
+
+/* a compound entry answered by its service, on RD */
+static void compoundReply(MESSAGE_STRUCT *sub) {
+	int i=sub->head.hd.res[1];
+	COMPOUND_CTX *c;
+	int fits;
+
+	if((i>=MSGHAND_COMPOUND_MAX) || (compounds[i].M==0)) {
+	    messageBuffers_release(sub);
+	    return;
+	}
+	c=&compounds[i];
+	fits=compoundAppend(c,sub);
+	messageBuffers_release(sub);
+	if(!fits) {
+	    /* nothing more fits, stop here */
+	    c->end=c->in;
+	}
+	if(compoundRun(c)) {
+	    sendReply(c->M);
+	    c->M=0;
+	}
+}
+
+UBYTE msgHand_trace(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	long count=0;
+
+	switch(data[0]) {
+	    case MSGHAND_TRACE_STOP:
+		domTrace_stop();
+		break;
+	    case MSGHAND_TRACE_START:
+		domTrace_start();
+		break;
+	    case MSGHAND_TRACE_DUMP:
+		count=domTrace_dump(DOMTRACE_DUMP_PATH);
+		break;
+	    default:
+		formatLong(0,data);
+		return SERVER_PROTOCOL_ERROR|WARNING_ERROR;
+	}
+	formatLong((ULONG)count,data);
+	return (count<0) ? (SERVICE_SPECIFIC_ERROR|WARNING_ERROR) : SUCCESS;
+}
+
+void *msgHandler(void *arg)
+{
+
+	MESSAGE_STRUCT *M;
+	int code;
+
+    commonServices_init(&msgHand,MSGHANDLER_MAJOR_VERSION,
+	MSGHANDLER_MINOR_VERSION);
+    msgHand.stats.name="msgHand";
+    msgHand.errorStr=msgHand_errorStr;
+
+    /* perform DOM-wide initialization functions at startup */
+    //FPGAPLDapi_init();
+
+    /* build the routing table from the message catalog */
+    if(msgDispatch_init()!=0) {
+	msgHand.state=SERVICE_ERROR;
+    }
+
+    /* endless loop on control fifo */
+    for (;;) {
+	Message_receive (&M,RD);
+	DOMTRACE(M,DOMTRACE_RD_DEQUEUE);
+	messageBuffers_setOwner(M,MSGBUF_OWNER_HANDLER);
+	if(M->head.hd.res[0]&MSG_DISPATCH_RETURN_FLAG) {
+	    compoundReply(M);
+	    continue;
+	}
+	if(Message_getType(M)==MESSAGE_HANDLER) {
+	    STAT_INC(&msgHand.stats,SVC_MSG_RECEIVED);
+	}
+
+	code=msgDispatch_route(M);
+	if(code==MSG_DISPATCH_FORWARDED) {
+	    /* now owned by the service, or kept */
+	    continue;
+	}
+	if(code!=MSG_DISPATCH_DONE) {
+	    rejectMessage(code,M);
+	}
+	sendReply(M);
+    }
 
 }
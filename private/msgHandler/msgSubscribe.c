@@ -0,0 +1,258 @@
+/* msgSubscribe.c */
+
+/* Counter subscriptions and their periodic pushes,
+   see msgHandler/msgSubscribe.h */
+
+#include <string.h>
+#include "domapp_common/DOMtypes.h"
+#include "message/message.h"
+#include "domapp_common/messageAPIstatus.h"
+#include "domapp_common/commonMessageAPIstatus.h"
+#include "message/messageBuffers.h"
+#include "msgHandler/MSGHANDLERextAPIstatus.h"
+#include "domapp_common/statCounters.h"
+#include "msgHandler/msgSubscribe.h"
+
+/* extern functions */
+extern void formatLong(ULONG value, UBYTE *buf);
+extern void formatShort(USHORT value, UBYTE *buf);
+extern USHORT unformatShort(UBYTE *buf);
+extern ULONG unformatLong(UBYTE *buf);
+
+/* message queue identifiers */
+extern int SD;
+
+/* a varint of a 32 bit value takes at most 5 bytes */
+#define VARINT_MAX_LEN 5
+
+typedef struct {
+	int active;
+	int started;		/* due is set by the first tick */
+	ULONG periodMsec;
+	ULONG threshold;
+	int lane;
+	int cnt;
+	STAT_GROUP *group[MSG_SUBSCRIBE_MAX_COUNTERS];
+	UBYTE index[MSG_SUBSCRIBE_MAX_COUNTERS];
+	/* values as of the last push sent */
+	unsigned int last[MSG_SUBSCRIBE_MAX_COUNTERS];
+	ULONG due;
+	int sinceKey;		/* periods since the last key push */
+	USHORT seq;
+	ULONG pushed;
+	ULONG skipped;
+	ULONG deferred;
+} SUBSCRIPTION;
+
+SUBSCRIPTION subscriptions[MSG_SUBSCRIBE_MAX];
+STAT_GROUP *subscribeGroups[MSG_SUBSCRIBE_MAX_GROUPS];
+int subscribeGroupCnt=0;
+/* handlers run on msgHandler, ticks on the timer thread */
+int subscribeLock=0;
+
+static void lockSubscriptions(void) {
+	while(__sync_lock_test_and_set(&subscribeLock,1)) {
+	    /* a tick holds it for a few pushes at most */
+	}
+}
+
+static void unlockSubscriptions(void) {
+	__sync_lock_release(&subscribeLock);
+}
+
+int msgSubscribe_addGroup(STAT_GROUP *g) {
+	if(subscribeGroupCnt>=MSG_SUBSCRIBE_MAX_GROUPS) {
+	    return -1;
+	}
+	subscribeGroups[subscribeGroupCnt]=g;
+	return subscribeGroupCnt++;
+}
+
+static UBYTE *putVarint(unsigned int v, UBYTE *buf) {
+	while(v>=0x80) {
+	    *buf++=(UBYTE)(v|0x80);
+	    v>>=7;
+	}
+	*buf++=(UBYTE)v;
+	return buf;
+}
+
+UBYTE msgHand_subscribe(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	SUBSCRIPTION *s=0;
+	USHORT counter;
+	int period=unformatShort(&data[0]);
+	int cnt=data[7];
+	int i;
+
+	if((Message_dataLen(M)!=MSGHAND_SUBSCRIBE_HDR_LEN+2*cnt) ||
+	    (cnt==0) || (cnt>MSG_SUBSCRIBE_MAX_COUNTERS) ||
+	    (period<MSGHAND_SUBSCRIBE_MIN_PERIOD) ||
+	    (data[6]>MSGHAND_LANE_LOW)) {
+	    data[0]=0;
+	    return SERVER_PROTOCOL_ERROR|WARNING_ERROR;
+	}
+	for(i=0;i<cnt;i++) {
+	    counter=unformatShort(&data[MSGHAND_SUBSCRIBE_HDR_LEN+2*i]);
+	    if(((counter>>8)>=subscribeGroupCnt) ||
+		((counter&0xff)>=subscribeGroups[counter>>8]->cnt)) {
+		data[0]=0;
+		return SERVER_PROTOCOL_ERROR|WARNING_ERROR;
+	    }
+	}
+
+	lockSubscriptions();
+	for(i=0;i<MSG_SUBSCRIBE_MAX;i++) {
+	    if(!subscriptions[i].active) {
+		s=&subscriptions[i];
+		break;
+	    }
+	}
+	if(s==0) {
+	    unlockSubscriptions();
+	    data[0]=0;
+	    return SERVICE_SPECIFIC_ERROR|WARNING_ERROR;
+	}
+	memset(s,0,sizeof(SUBSCRIPTION));
+	s->periodMsec=period;
+	s->threshold=unformatLong(&data[2]);
+	s->lane=data[6];
+	s->cnt=cnt;
+	for(i=0;i<cnt;i++) {
+	    counter=unformatShort(&data[MSGHAND_SUBSCRIBE_HDR_LEN+2*i]);
+	    s->group[i]=subscribeGroups[counter>>8];
+	    s->index[i]=(UBYTE)(counter&0xff);
+	}
+	s->active=TRUE;
+	unlockSubscriptions();
+
+	data[0]=(UBYTE)(s-subscriptions);
+	return SUCCESS;
+}
+
+UBYTE msgHand_unsubscribe(MESSAGE_STRUCT *M) {
+	UBYTE *data=Message_getData(M);
+	SUBSCRIPTION *s;
+
+	if((data[0]>=MSG_SUBSCRIBE_MAX) ||
+	    !subscriptions[data[0]].active) {
+	    memset(data,0,MSGHAND_UNSUBSCRIBE_LEN);
+	    return SERVER_PROTOCOL_ERROR|WARNING_ERROR;
+	}
+	s=&subscriptions[data[0]];
+	lockSubscriptions();
+	s->active=FALSE;
+	unlockSubscriptions();
+	formatLong(s->pushed,&data[0]);
+	formatLong(s->skipped,&data[4]);
+	formatLong(s->deferred,&data[8]);
+	return SUCCESS;
+}
+
+/* build and queue one push, FALSE if it has to wait */
+static int push(SUBSCRIPTION *s, unsigned int *values, int key,
+	ULONG nowMsec) {
+	MESSAGE_STRUCT *M;
+	UBYTE *data;
+	UBYTE *out;
+	int delta;
+	int i;
+
+	if((s->lane==MSGHAND_LANE_LOW) &&
+	    (messageBuffers_freeCnt()*MSG_SUBSCRIBE_LOW_FRACTION<
+	    messageBuffers_totalCnt())) {
+	    return FALSE;
+	}
+	M=messageBuffers_allocate();
+	if(M==0) {
+	    return FALSE;
+	}
+
+	data=Message_getData(M);
+	data[0]=(UBYTE)(s-subscriptions);
+	data[1]=key ? MSGHAND_PUSH_KEY : 0;
+	formatShort(s->seq,&data[2]);
+	formatLong(nowMsec,&data[4]);
+	out=data+MSGHAND_PUSH_HDR_LEN;
+	for(i=0;i<s->cnt;i++) {
+	    if(key) {
+		out=putVarint(values[i],out);
+	    }
+	    else {
+		delta=(int)(values[i]-s->last[i]);
+		out=putVarint(((unsigned int)delta<<1)^
+		    (unsigned int)(delta>>31),out);
+	    }
+	}
+
+	Message_setType(M,MESSAGE_HANDLER);
+	Message_setSubtype(M,MSGHAND_SUBSCRIPTION_PUSH);
+	Message_setStatus(M,SUCCESS);
+	Message_setDataLen(M,(int)(out-data));
+	messageBuffers_setOwner(M,MSGBUF_OWNER_SD);
+	if(Message_send(M,SD)<0) {
+	    messageBuffers_release(M);
+	    return FALSE;
+	}
+	return TRUE;
+}
+
+int msgSubscribe_tick(ULONG nowMsec) {
+	unsigned int values[MSG_SUBSCRIBE_MAX_COUNTERS];
+	SUBSCRIPTION *s;
+	int sent=0;
+	int moved;
+	int key;
+	int i;
+	int j;
+
+	lockSubscriptions();
+	for(i=0;i<MSG_SUBSCRIBE_MAX;i++) {
+	    s=&subscriptions[i];
+	    if(!s->active) {
+		continue;
+	    }
+	    if(!s->started) {
+		s->due=nowMsec;
+		s->started=TRUE;
+	    }
+	    if((long)(nowMsec-s->due)<0) {
+		continue;
+	    }
+
+	    moved=(s->threshold==0);
+	    for(j=0;j<s->cnt;j++) {
+		values[j]=(unsigned int)statCounters_read(s->group[j],
+		    s->index[j]);
+		if((values[j]-s->last[j]>=s->threshold) &&
+		    (s->last[j]-values[j]>=s->threshold)) {
+		    moved=TRUE;
+		}
+	    }
+	    key=(s->pushed==0) || (s->sinceKey>=MSGHAND_PUSH_KEY_EVERY);
+
+	    if(!moved && !key) {
+		s->skipped++;
+	    }
+	    else if(push(s,values,key,nowMsec)) {
+		memcpy(s->last,values,sizeof(s->last));
+		s->seq++;
+		s->pushed++;
+		s->sinceKey=key ? 0 : s->sinceKey;
+		sent++;
+	    }
+	    else {
+		/* try again next tick, the period is kept */
+		s->deferred++;
+		continue;
+	    }
+	    s->sinceKey++;
+	    s->due+=s->periodMsec;
+	    if((long)(nowMsec-s->due)>=0) {
+		/* fell behind, do not catch up in a burst */
+		s->due=nowMsec+s->periodMsec;
+	    }
+	}
+	unlockSubscriptions();
+	return sent;
+}
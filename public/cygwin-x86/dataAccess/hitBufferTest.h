@@ -0,0 +1,10 @@
+#ifndef _HIT_BUFFER_TEST_H_
+#define _HIT_BUFFER_TEST_H_
+/* hitBufferTest.h */
+
+
+int hitBufferTest(void);
+
+char *hitBufferTest_status(void);
+
+#endif
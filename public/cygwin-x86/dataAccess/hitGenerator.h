@@ -0,0 +1,90 @@
+#ifndef _HIT_GENERATOR_H_
+#define _HIT_GENERATOR_H_
+/* hitGenerator.h */
+
+/* Synthetic hit source for exercising the readout path
+   without a DOM.  Hits are written straight into a hit
+   buffer slot with waveforms in one of the DOMdata.h
+   patterns, at a fixed or Poisson rate, as a mix of SPE
+   and MSPE hits.  Each pattern is built once per start
+   and a hit only copies it, scaled by the hit's charge
+   for the pulse patterns; the copy runs 8 or 16 samples
+   at a time with SSE2 where the compiler offers it.
+
+   Patterns:
+	ZERO		all zero
+	RAW_CNT		lo 0,1,2.. ; hi bytes 0,1,2.. unformatted
+	FMT_CNT		lo 0,1,2.. ; hi samples 0,1,2..
+	CLK_32MHTZ	square wave, 10 bins a cycle
+	REAL_DATA	records picked at random from the file
+			given to hitGenerator_setFile(); without
+			one, pedestal and a pulse scaled by charge
+	REAL_DATA_DIV10	the same divided by 10
+	ATWD_TEST_DATA	the same pulse, no pedestal
+	SLOWADC_TEST_DATA, COMADC_TEST_DATA
+			sawtooth */
+
+/* trig.time counts this clock */
+#define HIT_GEN_CLOCK_HZ 40000000
+/* hi channel sample scale, lo channel is 8 bit */
+#define HIT_GEN_HI_MAX 1023
+#define HIT_GEN_PEDESTAL 50
+/* charge of one photoelectron, in trig.energy units */
+#define HIT_GEN_SPE_CHARGE 100
+/* MSPE hits carry 2..HIT_GEN_MAX_PE photoelectrons */
+#define HIT_GEN_MAX_PE 8
+
+typedef struct {
+	int pattern;		/* DOMdata.h data pattern */
+	int poisson;		/* TRUE for Poisson arrivals */
+	ULONG rateHz;		/* 0 as fast as the buffer takes */
+	int mspePercent;	/* share of MSPE hits */
+	UBYTE present;		/* ATWDx_xx_PRES waveforms to fill */
+	ULONG seed;
+} HIT_GEN_CONFIG;
+
+/* waveforms of a pattern, built once */
+typedef struct {
+	HIT_GEN_CONFIG cfg;
+	UBYTE lo[ATWD_LO_LEN];
+	USHORT hi[ATWD_HI_LEN/2];
+	/* one photoelectron's pulse, added once per
+	   photoelectron.  Sized so that the pedestal and
+	   HIT_GEN_MAX_PE pulses stay under HIT_GEN_HI_MAX. */
+	USHORT loPulse[ATWD_LO_LEN];
+	USHORT hiPulse[ATWD_HI_LEN/2];
+	int pulsed;
+	/* REAL_DATA records, or 0 */
+	WAVEFORM_FILE *file;
+	int div10;
+	unsigned int rng;
+	ULONG time;
+} HIT_GEN;
+
+/* build the pattern for cfg.  Returns 0, or -1 for an
+   unknown pattern. */
+int hitGenerator_init(HIT_GEN *g, HIT_GEN_CONFIG *cfg);
+
+/* recorded waveforms for the REAL_DATA patterns of
+   generators initialized from now on, 0 for none */
+void hitGenerator_setFile(WAVEFORM_FILE *f);
+
+/* fill h with the next hit, and return the clock ticks
+   since the previous one */
+ULONG hitGenerator_next(HIT_GEN *g, HIT_RECORD *h);
+
+/* run a generator thread into b, through f unless it
+   is 0.  Filtered hits go HIT_FILTER_BATCH at a time when
+   not paced.  Every hit made, kept or not, is counted in
+   s unless it is 0, and added to the histograms, at most
+   HIST_QUANTITIES, at h.  Returns 0, or -1 if cfg is bad
+   or a generator is running. */
+int hitGenerator_start(HIT_BUFFER *b, HIT_FILTER *f, SCALER *s,
+	HISTOGRAM *h, int histograms, HIT_GEN_CONFIG *cfg);
+
+void hitGenerator_stop(void);
+
+/* hits generated since the last start */
+ULONG hitGenerator_count(void);
+
+#endif
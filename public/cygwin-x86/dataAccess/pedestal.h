@@ -0,0 +1,60 @@
+#ifndef _PEDESTAL_H_
+#define _PEDESTAL_H_
+/* pedestal.h */
+
+/* Online pedestal averaging.  A worker thread follows the
+   hit buffer with a reader of its own and adds every
+   waveform of the hits that come in, taken to be forced
+   triggers, into per sample sums and sums of squares,
+   until it has seen the hits asked for.  Both sums are
+   64 bit wide, so no count of hits a run can ask for
+   wraps them, and are added 8 samples at a time with
+   SSE2 where the compiler offers it.  The mean and
+   variance of each sample then make one small reply in
+   place of every waveform going over the link. */
+
+/* state */
+#define PED_IDLE 0
+#define PED_RUNNING 1
+#define PED_DONE 2
+
+/* means are in 1/PED_SCALE counts, variances in
+   1/PED_SCALE counts squared */
+#define PED_SCALE 16
+#define PED_LO 0
+#define PED_HI 1
+#define PED_CHANNELS 2
+#define PED_SAMPLES (ATWD_HI_LEN/2)
+
+typedef struct {
+	/* waveforms added, per ATWD and channel */
+	ULONG n[HIT_ATWD_CNT][PED_CHANNELS];
+	unsigned long long sum[HIT_ATWD_CNT][PED_CHANNELS][PED_SAMPLES];
+	unsigned long long sumSq[HIT_ATWD_CNT][PED_CHANNELS][PED_SAMPLES];
+} PED_SUMS;
+
+void pedestal_clear(PED_SUMS *s);
+
+/* add the waveforms of h named in present, ATWDx_xx_PRES */
+void pedestal_add(PED_SUMS *s, HIT_RECORD *h, UBYTE present);
+
+/* mean, and variance if it is not 0, of one channel of
+   s, held to a USHORT.  Returns the waveforms added. */
+ULONG pedestal_mean(PED_SUMS *s, int atwd, int channel, USHORT *mean,
+	USHORT *variance);
+
+/* average the next hits hits of b on a worker thread.
+   Returns 0, or -1 if b has no reader place left or a
+   run is going. */
+int pedestal_start(HIT_BUFFER *b, ULONG hits);
+
+/* end a run early; its sums are kept */
+void pedestal_stop(void);
+
+/* PED_xxx, and the hits added and asked for so far */
+int pedestal_state(ULONG *done, ULONG *target);
+
+/* sums of the last run, once PED_DONE */
+PED_SUMS *pedestal_sums(void);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _WAVEFORM_FILE_H_
+#define _WAVEFORM_FILE_H_
+/* waveformFile.h */
+
+/* Recorded waveforms for the REAL_DATA patterns.  A file
+   is a run of hits in the DATA_ACC_GET_DATA hit format
+   (DAmessageAPIstatus.h), as the DAQ records them, without
+   the reply's hit count.  The file is mapped read only
+   and its record offsets are found once when it is
+   opened; records are then used in place. */
+
+/* looked for by domapp at startup */
+#define WAVEFORM_FILE_DEFAULT "/tmp/domapp_waveforms.dat"
+
+typedef struct {
+	UBYTE *map;
+	ULONG size;
+	/* start of each record in map */
+	ULONG *offset;
+	ULONG cnt;
+} WAVEFORM_FILE;
+
+/* map path and index it.  Returns the number of records,
+   or -1 if it cannot be mapped or holds none.  Indexing
+   stops at the first record that is cut short or does
+   not match its waveform bits. */
+long waveformFile_open(WAVEFORM_FILE *f, const char *path);
+
+void waveformFile_close(WAVEFORM_FILE *f);
+
+/* record i, in the hit format */
+#define waveformFile_record(f,i) ((f)->map+(f)->offset[(i)])
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _DOM_LOG_H_
+#define _DOM_LOG_H_
+/* domLog.h */
+
+/* Logging that stays off the hot path.  A log call writes
+   a small binary record (its call site, which holds the
+   format and level, plus up to four arguments) into a
+   ring owned by the calling thread, with no lock and no
+   formatting.  A drainer thread formats the records and
+   writes them out.  Calls above DOMLOG_LEVEL compile to
+   nothing.  Each call site is limited to DOMLOG_SITE_RATE
+   records per second; the rest are counted and reported
+   with the next record that gets through.
+
+   Arguments are stored as longs: use %ld, %lx etc. for
+   numbers, and pass only strings that outlive the drain
+   (literals, argv) to %s. */
+
+#include <stdio.h>
+
+#define DOMLOG_ERROR 0
+#define DOMLOG_WARN 1
+#define DOMLOG_INFO 2
+#define DOMLOG_DEBUG 3
+
+/* highest level compiled in */
+#ifndef DOMLOG_LEVEL
+#define DOMLOG_LEVEL DOMLOG_INFO
+#endif
+
+#define DOMLOG_MAX_ARGS 4
+/* records per thread ring, a power of two */
+#define DOMLOG_RING_LEN 256
+/* threads that can log */
+#define DOMLOG_MAX_THREADS 16
+#define DOMLOG_SITE_RATE 100
+
+/* one per call site, static */
+typedef struct {
+	const char *fmt;
+	int level;
+	/* rate limit state */
+	ULONG windowSec;
+	int windowCnt;
+	int suppressed;
+} DOMLOG_SITE;
+
+void domLog_put(DOMLOG_SITE *site, long a0, long a1,
+	long a2, long a3);
+
+#define DOMLOG_PUT(level,fmt,a0,a1,a2,a3) \
+	do { \
+	    if((level)<=DOMLOG_LEVEL) { \
+		static DOMLOG_SITE domLogSite={fmt,level,0,0,0}; \
+		domLog_put(&domLogSite,a0,a1,a2,a3); \
+	    } \
+	} while(0)
+
+#define DOMLOG(level,fmt) \
+	DOMLOG_PUT(level,fmt,0,0,0,0)
+#define DOMLOG1(level,fmt,a) \
+	DOMLOG_PUT(level,fmt,(long)(a),0,0,0)
+#define DOMLOG2(level,fmt,a,b) \
+	DOMLOG_PUT(level,fmt,(long)(a),(long)(b),0,0)
+#define DOMLOG3(level,fmt,a,b,c) \
+	DOMLOG_PUT(level,fmt,(long)(a),(long)(b),(long)(c),0)
+#define DOMLOG4(level,fmt,a,b,c,d) \
+	DOMLOG_PUT(level,fmt,(long)(a),(long)(b),(long)(c),(long)(d))
+
+/* where formatted records go, stderr by default */
+void domLog_setOutput(FILE *out);
+
+/* start the drainer thread.  Records logged before are
+   kept and written once it runs.  Returns 0 or -1. */
+int domLog_start(void);
+
+/* format and write everything logged so far, on the
+   calling thread */
+void domLog_flush(void);
+
+/* records lost because a thread's ring was full */
+ULONG domLog_dropped(void);
+
+#endif
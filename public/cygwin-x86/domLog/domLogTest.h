@@ -0,0 +1,10 @@
+#ifndef _DOM_LOG_TEST_H_
+#define _DOM_LOG_TEST_H_
+/* domLogTest.h */
+
+
+int domLogTest(void);
+
+char *domLogTest_status(void);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef _DOM_TRACE_H_
+#define _DOM_TRACE_H_
+/* domTrace.h */
+
+/* Opt-in per-message tracing.  While tracing is on, each
+   request is stamped with the monotonic clock as it passes
+   the points below.  Stamps go into a ring per thread,
+   which keeps the most recent DOMTRACE_RING_LEN of them.
+   A request is followed by its pool slot: domTrace_begin()
+   gives the slot a new request id and later stamps on the
+   same buffer carry that id.  Buffers from outside the pool
+   are not traced.  domTrace_dump() turns the stamps into
+   one span per hop, written as Chrome trace-event JSON
+   (chrome://tracing, ui.perfetto.dev). */
+
+enum {
+	DOMTRACE_LINK_RECV,	/* recvMsg, whole message read */
+	DOMTRACE_RD_DEQUEUE,	/* msgHandler, off RD */
+	DOMTRACE_DISPATCH,	/* handler called */
+	DOMTRACE_SERVICE_DONE,	/* handler has a reply */
+	DOMTRACE_SD_ENQUEUE,	/* reply queued on SD */
+	DOMTRACE_LINK_SENT,	/* sendMsg, last byte sent */
+	DOMTRACE_POINT_CNT
+};
+
+#define DOMTRACE_RING_LEN 4096
+#define DOMTRACE_MAX_THREADS 16
+#define DOMTRACE_MAX_SLOTS 256
+#define DOMTRACE_DUMP_PATH "/tmp/domapp_trace.json"
+
+extern volatile int domTraceOn;
+
+void domTrace_begin(MESSAGE_STRUCT *M, int point);
+void domTrace_stamp(MESSAGE_STRUCT *M, int point);
+/* last stamp of a request, its slot is no longer followed */
+void domTrace_end(MESSAGE_STRUCT *M, int point);
+
+/* one untaken branch when tracing is off */
+#define DOMTRACE_BEGIN(M,point) \
+	do { if(domTraceOn) domTrace_begin(M,point); } while(0)
+#define DOMTRACE(M,point) \
+	do { if(domTraceOn) domTrace_stamp(M,point); } while(0)
+#define DOMTRACE_END(M,point) \
+	do { if(domTraceOn) domTrace_end(M,point); } while(0)
+
+/* start a fresh trace */
+void domTrace_start(void);
+
+void domTrace_stop(void);
+
+/* stop tracing and write the spans to path.  Returns the
+   number of spans written, or -1. */
+int domTrace_dump(const char *path);
+
+#endif
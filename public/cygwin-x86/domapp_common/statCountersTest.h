@@ -0,0 +1,10 @@
+#ifndef _STAT_COUNTERS_TEST_H_
+#define _STAT_COUNTERS_TEST_H_
+/* statCountersTest.h */
+
+
+int statCountersTest(void);
+
+char *statCountersTest_status(void);
+
+#endif
@@ -1,6 +1,15 @@
 #ifndef _MESSAGE_H_
 #define _MESSAGE_H_
 
+#include <stddef.h>
+
+/* Small payloads (most MESSAGE_HANDLER replies) are carried
+   inline, in the same cache line as the header.  MESSAGE_STRUCT
+   is sized so head+data pointer+inline area fill exactly
+   one 64 byte line. */
+#define MESSAGE_CACHE_LINE 64
+#define MESSAGE_INLINE_LEN ((int)(MESSAGE_CACHE_LINE-8-sizeof(UBYTE *)))
+
 
 /* private per instance data */
 typedef struct {
@@ -18,8 +27,17 @@ typedef struct {
 	} head;
   
   UBYTE *data;
+  /* inline payload area, must remain the last member:
+     pool buffers continue their data body directly
+     after it (see messageBuffers.c) */
+  UBYTE inl[MESSAGE_INLINE_LEN];
 } MESSAGE_STRUCT;
 
+/* number of header bytes carried on the wire ahead of the
+   data portion.  Unchanged from the original layout so the
+   DAQ side does not see the inline area. */
+#define MESSAGE_WIRE_LEN (offsetof(MESSAGE_STRUCT,inl))
+
 #define MESSAGE_FLAG_VALUE 1
 #define PACKET_SIZE_VALUE 8 
 #define MAXDATA_VALUE 4096
@@ -36,11 +54,16 @@ UBYTE Message_getType(MESSAGE_STRUCT *msgStruct);
 UBYTE Message_getSubtype(MESSAGE_STRUCT *msgStruct); 
 UBYTE Message_getStatus(MESSAGE_STRUCT *msgStruct);
 UBYTE* Message_getData(MESSAGE_STRUCT *msgStruct);
+int	Message_isInline(MESSAGE_STRUCT *msgStruct);
 int	Message_dataLen(MESSAGE_STRUCT *msgStruct);
 void  Message_setType(MESSAGE_STRUCT *msgStruct,
 	UBYTE t); 
 void  Message_setSubtype(MESSAGE_STRUCT *msgStruct,
 	UBYTE st); 
+/* a payload of MESSAGE_INLINE_LEN bytes or less is copied
+   into inl and the message does not share d afterwards; a
+   larger one is referenced, and d must outlive the message.
+   d may lie in inl. */
 void  Message_setData(MESSAGE_STRUCT *msgStruct,
 	UBYTE *d, int size); 
 void Message_setDataLen(MESSAGE_STRUCT *msgStruct,
@@ -53,6 +76,7 @@ int Message_createQueue(int q);
 int Message_send(MESSAGE_STRUCT *msgStruct, int q);	
 int Message_forward(MESSAGE_STRUCT *msgStruct, int q);	
 int Message_receive(MESSAGE_STRUCT **msgStruct, int q);
+int Message_receive_nonblock(MESSAGE_STRUCT **msgStruct, int q);
 
 
 #endif
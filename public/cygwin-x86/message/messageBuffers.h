@@ -2,15 +2,87 @@
 #define _MESSAGE_BUFFERS_H_
 /* messageBuffers.h */
 
+/* pipeline stages that can own a message buffer, used
+   for the per stage census */
+#define MSGBUF_OWNER_FREE 0
+#define MSGBUF_OWNER_LINK_RX 1
+#define MSGBUF_OWNER_HANDLER 2
+#define MSGBUF_OWNER_SC 3
+#define MSGBUF_OWNER_EC 4
+#define MSGBUF_OWNER_TM 5
+#define MSGBUF_OWNER_DA 6
+#define MSGBUF_OWNER_SD 7
+#define MSGBUF_OWNER_LINK_TX 8
+#define MSGBUF_OWNER_CNT 9
+
+/* pool telemetry snapshot */
+typedef struct {
+	int totalCnt;
+	int freeCnt;
+	int lowWater;
+	ULONG allocCnt;
+	ULONG releaseCnt;
+	ULONG allocFail;
+	ULONG freeListCorrupt;
+	int census[MSGBUF_OWNER_CNT];
+} MSGBUF_STATS;
+
+/* one outstanding buffer.  Allocation site and age are
+   only recorded when built with MESSAGE_BUFFERS_DEBUG. */
+#define NULL_ALLOC_SITE ""
+typedef struct {
+	int slot;
+	int owner;
+	const char *file;
+	int line;
+	ULONG ageMsec;
+} MSGBUF_OUTSTANDING;
 
 void messageBuffers_init(void);
 
+#ifdef MESSAGE_BUFFERS_DEBUG
+MESSAGE_STRUCT *messageBuffers_allocateAt(const char *file, int line);
+#define messageBuffers_allocate() \
+	messageBuffers_allocateAt(__FILE__,__LINE__)
+#else
 MESSAGE_STRUCT *messageBuffers_allocate(void);
+#endif
  	
 void messageBuffers_release(MESSAGE_STRUCT *m);
 
+void messageBuffers_setOwner(MESSAGE_STRUCT *m, int owner);
+
 int messageBuffers_freeCnt(void); 
 
 int messageBuffers_totalCnt(void);
 
+/* pool slot of a buffer, 0..totalCnt-1, or -1 if m is
+   not from the pool */
+int messageBuffers_index(MESSAGE_STRUCT *m);
+
+void messageBuffers_getStats(MSGBUF_STATS *s);
+
+void messageBuffers_clearStats(void);
+
+int messageBuffers_corruptCnt(void);
+
+void messageBuffers_clearCorrupt(void);
+
+int messageBuffers_outstanding(MSGBUF_OUTSTANDING *list, int max);
+
+/* size of the block holding all pool state */
+int messageBuffers_arenaSize(void);
+
+/* move the pool into mem, messageBuffers_arenaSize() bytes,
+   e.g. shared memory that outlives the process.  If warm,
+   mem holds the pool of an earlier process which had it
+   mapped at oldMem: buffers still owned by a stage are
+   kept, free list and census are rebuilt from the owners.
+   Otherwise the pool is initialized.  Returns TRUE if the
+   earlier contents were kept. */
+int messageBuffers_attach(void *mem, int warm, void *oldMem);
+
+/* buffer in pool slot i, 0 if out of range */
+MESSAGE_STRUCT *messageBuffers_slot(int i);
+
 #endif
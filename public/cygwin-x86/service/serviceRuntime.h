@@ -0,0 +1,92 @@
+#ifndef _SERVICE_RUNTIME_H_
+#define _SERVICE_RUNTIME_H_
+/* serviceRuntime.h */
+
+/* Worker threads for the services msgHandler forwards
+   to (SC, EC, TM, DA).  Each service keeps its home
+   queue, and at most one worker serves a given service
+   at a time, so its messages are answered in order.  A
+   worker serves its home services first and, when they
+   are idle, steals pending work from any other service
+   whose worker is busy elsewhere.
+
+   A handler that has to wait (for another service, a
+   timer or a hardware completion) does not block its
+   worker.  It registers a continuation and returns
+   SERVICE_SUSPENDED; the service goes on with its next
+   message, and the continuation runs later on any worker,
+   still one at a time per service.  The reply is sent
+   when a handler or continuation returns a real status. */
+
+#define SERVICE_MAX 8
+#define SERVICE_MAX_WORKERS 8
+#define SERVICE_DEFAULT_WORKERS 2
+/* requests that can be suspended at once */
+#define SERVICE_MAX_PENDING 4096
+
+/* returned by a handler or continuation instead of a
+   status once it has suspended its request.  Never sent. */
+#define SERVICE_SUSPENDED LAST_STATUS
+
+/* service specific handler.  Fills in the reply and
+   returns the message status, or 0 to fall back to the
+   common subtypes in commonServices_serve(). */
+typedef UBYTE (*SERVICE_FN)(MESSAGE_STRUCT *M);
+
+typedef struct {
+	const char *name;
+	int *queue;		/* home queue */
+	COMMON_SERVICE_INFO *info;
+	SERVICE_FN serve;	/* 0 for common subtypes only */
+	int owner;		/* MSGBUF_OWNER_xxx of its buffers */
+} SERVICE_DESC;
+
+/* continuation of a suspended request M, run holding M's
+   service.  result is the reply of serviceRuntime_call(),
+   valid only during the call, the pointer passed to
+   serviceRuntime_wake(), or 0 after a timeout.  Returns
+   the status for M's reply, or SERVICE_SUSPENDED again. */
+typedef UBYTE (*SERVICE_CONT)(MESSAGE_STRUCT *M, void *ctx,
+	void *result);
+
+/* token for a wait completed by serviceRuntime_wake() */
+typedef int SERVICE_WAIT;
+
+/* add a service before serviceRuntime_start().
+   Returns 0, or -1 if the table is full. */
+int serviceRuntime_register(SERVICE_DESC *desc);
+
+/* start nWorkers threads, clipped to 1..SERVICE_MAX_WORKERS.
+   Returns the number started. */
+int serviceRuntime_start(int nWorkers);
+
+/* a message was queued on queue, wake a worker */
+void serviceRuntime_notify(int queue);
+
+/* The following are called from a handler or continuation
+   about its current request M.  Timeouts are in msec, 0
+   for none. */
+
+/* ask the service on queue for (type, subtype, args) and
+   continue with its reply.  Returns SERVICE_SUSPENDED, or
+   an error status if nothing could be suspended. */
+UBYTE serviceRuntime_call(MESSAGE_STRUCT *M, int queue,
+	UBYTE type, UBYTE subtype, UBYTE *args, int len,
+	int timeoutMsec, SERVICE_CONT cont, void *ctx);
+
+/* continue after msec.  Returns SERVICE_SUSPENDED, or
+   an error status. */
+UBYTE serviceRuntime_after(MESSAGE_STRUCT *M, int msec,
+	SERVICE_CONT cont, void *ctx);
+
+/* continue once serviceRuntime_wake() is called with the
+   returned token, e.g. by an I/O completion.  Returns -1
+   if nothing could be suspended. */
+SERVICE_WAIT serviceRuntime_wait(MESSAGE_STRUCT *M,
+	int timeoutMsec, SERVICE_CONT cont, void *ctx);
+
+/* complete a wait from any thread.  Returns 0, or -1 if
+   the wait already timed out. */
+int serviceRuntime_wake(SERVICE_WAIT w, void *result);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _SERVICE_RUNTIME_TEST_H_
+#define _SERVICE_RUNTIME_TEST_H_
+/* serviceRuntimeTest.h */
+
+
+int serviceRuntimeTest(void);
+
+char *serviceRuntimeTest_status(void);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef _STATS_PAGE_H_
+#define _STATS_PAGE_H_
+/* statsPage.h */
+
+/* Live statistics page.  domapp publishes all of its
+   counters into a POSIX shared memory object that local
+   monitoring agents map read only, so polling never goes
+   over the DAQ link or through the message path.
+
+   The page is protected by a sequence lock: the writer
+   makes seq odd, updates the page and makes seq even
+   again.  A reader copies the page and retries if seq was
+   odd or changed during the copy.
+
+   The layout is versioned; readers must check magic,
+   version and size before using it. */
+
+#define STATS_PAGE_NAME "/domapp_stats"
+#define STATS_PAGE_MAGIC 0x444f4d53
+#define STATS_PAGE_VERSION 1
+
+#define STATS_PAGE_MAX_SERVICES 8
+#define STATS_PAGE_MAX_QUEUES 8
+#define STATS_PAGE_NAME_LEN 16
+
+/* default publish period */
+#define STATS_PAGE_PERIOD_USEC 1000
+
+typedef struct {
+	char name[STATS_PAGE_NAME_LEN];
+	UBYTE state;
+	UBYTE lastErrorID;
+	UBYTE lastErrorSeverity;
+	UBYTE majorVersion;
+	UBYTE minorVersion;
+	UBYTE spare[3];
+	ULONG stats[SVC_STATS_CNT];
+	char lastErrorStr[MAX_ERROR_STR_LEN];
+} STATS_PAGE_SERVICE;
+
+typedef struct {
+	char name[STATS_PAGE_NAME_LEN];
+	ULONG depth;		/* messages waiting */
+} STATS_PAGE_QUEUE;
+
+typedef struct {
+	ULONG magic;
+	ULONG version;
+	ULONG size;		/* sizeof(STATS_PAGE) */
+	volatile ULONG seq;	/* odd while being updated */
+	ULONG updateCnt;
+	ULONG timeUsec;		/* publish time, monotonic */
+
+	ULONG pkt[PKT_STATS_CNT];
+	ULONG msg[MSG_STATS_CNT];
+	ULONG ovfl[OVFL_STATS_CNT];
+	MSGBUF_STATS pool;
+
+	int serviceCnt;
+	STATS_PAGE_SERVICE service[STATS_PAGE_MAX_SERVICES];
+	int queueCnt;
+	STATS_PAGE_QUEUE queue[STATS_PAGE_MAX_QUEUES];
+} STATS_PAGE;
+
+/* publisher side, in domapp */
+
+/* create the page.  Returns 0, or -1 on error. */
+int statsPage_create(void);
+
+/* add a service or queue to publish, before start */
+int statsPage_addService(const char *name, COMMON_SERVICE_INFO *info);
+int statsPage_addQueue(const char *name, int *queue);
+
+/* update the page once */
+void statsPage_publish(void);
+
+/* publish from a background thread every periodUsec */
+int statsPage_start(ULONG periodUsec);
+
+/* reader side, statsPageReader.c */
+
+/* map the page read only.  Returns 0 if domapp is not
+   running or the layout does not match. */
+const STATS_PAGE *statsPage_attach(void);
+
+void statsPage_detach(const STATS_PAGE *page);
+
+/* consistent copy of the page.  Returns 0, or -1 if no
+   consistent copy could be made in a bounded number of
+   tries, a short pause apart. */
+int statsPage_read(const STATS_PAGE *page, STATS_PAGE *copy);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _STATS_PAGE_TEST_H_
+#define _STATS_PAGE_TEST_H_
+/* statsPageTest.h */
+
+
+int statsPageTest(void);
+
+char *statsPageTest_status(void);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef _WARM_RESTART_H_
+#define _WARM_RESTART_H_
+/* warmRestart.h */
+
+/* Warm restart.  The message buffer pool and the domapp
+   wide counters live in a POSIX shared memory object that
+   outlives the process.  A restarted domapp maps it again
+   and, if the header shows the same layout, keeps its
+   contents: counters go on counting, and replies that were
+   waiting to be sent are queued on SD again.  Buffers held
+   by any other stage belonged to requests that were cut
+   short; they are freed and the DAQ side retries.
+
+   The queues themselves are not kept: they carried buffer
+   addresses in the old process, so their stale entries are
+   thrown away before the pool is resumed.
+
+   Segment layout: WARM_HEADER, DOM_STATS, buffer pool,
+   each starting on a cache line. */
+
+#define WARM_SHM_NAME "/domapp_warm"
+#define WARM_MAGIC 0x444f4d57
+#define WARM_VERSION 1
+
+/* header state */
+#define WARM_STOPPED 0
+#define WARM_RUNNING 1
+
+typedef struct {
+	ULONG magic;
+	ULONG version;
+	/* whole segment and pool sizes, a layout change
+	   makes the old contents unusable */
+	ULONG size;
+	ULONG arenaSize;
+	/* RUNNING until a clean warmRestart_detach() */
+	volatile ULONG state;
+	ULONG coldStarts;
+	ULONG warmStarts;
+	/* address the last process mapped the segment at */
+	void *base;
+	/* over the fields above */
+	ULONG check;
+} WARM_HEADER;
+
+/* map the segment called name and move the pool and the
+   counters into it.  Returns TRUE for a warm start, FALSE
+   for a cold one (fresh pool and counters), or -1 if there
+   is no segment; the caller then initializes in process
+   memory as usual. */
+int warmRestart_attach(const char *name);
+
+/* TRUE if the last process attached did not detach */
+int warmRestart_crashed(void);
+
+/* throw away what an earlier process left on a queue */
+int warmRestart_flushQueue(int queue);
+
+/* after a warm start, once the queues are flushed: queue
+   kept replies on sd and free every other held buffer.
+   Returns the number of replies queued, or -1. */
+int warmRestart_resume(int sd);
+
+/* mark a clean stop on the way out of the process, the
+   segment stays mapped for threads still running */
+void warmRestart_stop(void);
+
+/* mark a clean stop and unmap.  The pool and counters
+   must not be used afterwards. */
+void warmRestart_detach(void);
+
+#endif
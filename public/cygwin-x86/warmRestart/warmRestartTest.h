@@ -0,0 +1,10 @@
+#ifndef _WARM_RESTART_TEST_H_
+#define _WARM_RESTART_TEST_H_
+/* warmRestartTest.h */
+
+
+int warmRestartTest(void);
+
+char *warmRestartTest_status(void);
+
+#endif
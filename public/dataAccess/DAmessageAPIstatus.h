@@ -0,0 +1,376 @@
+/* DAmessageAPIstatus.h */
+
+/* This file contains Data Access subtypes, response
+   formats and error codes. */
+
+#ifndef _DA_MESSAGE_API_STATUS_
+#define _DA_MESSAGE_API_STATUS_
+
+#define DATA_ACC_MAJOR_VERSION 1
+#define DATA_ACC_MINOR_VERSION 0
+
+/* Response to:
+	subType: DATA_ACC_GET_DATA
+   Passed values:
+	UBYTE encoding;	  DATA_ACC_ENC_xxx, optional
+   Size of passed values:
+	0 (DATA_ACC_ENC_RAW) or 1
+   Returned values in data portion of message:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	USHORT hitCnt;
+   followed by hitCnt hits, oldest first, each made of:
+	USHORT len;		  whole hit, this field included
+	UBYTE present;	  ATWDx_xx_PRES bits, DOMdata.h
+	UBYTE flags;		  SPE_MASK or MSPE_MASK
+	ULONG seq;		  hit number, gaps are lost hits
+	ULONG time;
+	ULONG energy;
+	UBYTE coinc;
+	UBYTE quality;
+	UBYTE contents;	  data pattern of the waveforms
+	UBYTE encoding;	  DATA_ACC_ENC_xxx of this hit
+	then each waveform named in present, in bit order:
+	 lo: ATWD_LO_LEN 8 bit samples
+	 hi: ATWD_HI_LEN/2 16 bit samples
+	 or, for DATA_ACC_ENC_PACKED, each coded as in
+	 dataAccess/waveformCodec.h
+	 or, for DATA_ACC_ENC_FEATURES, the pulses found in
+	 each (dataAccess/pulseFeatures.h):
+	  UBYTE pulseCnt;	  at most PULSE_MAX
+	  USHORT baseline;
+	  then pulseCnt of:
+	   USHORT time;	  leading edge, 1/16 samples
+	   USHORT peak;	  above baseline
+	   ULONG charge;	  above baseline
+	 or, for DATA_ACC_ENC_CALIBRATED, the samples in
+	 1/DATA_ACC_CAL_SCALE mV as signed 16 bit values,
+	 held to their range, lo samples too; see
+	 DATA_ACC_SET_CALIBRATION
+   With DATA_ACC_ENC_FEATURES every prescale'th hit (see
+   DATA_ACC_SET_FEATURES) is sent with raw waveforms, its
+   encoding saying so.
+   Only whole hits are returned, as many as fit in one
+   message; hitCnt is 0 when there are none.
+   Size of returned values in data portion:
+	variable */
+#define DATA_ACC_GET_DATA 10
+#define DATA_ACC_DATA_HDR_LEN 2
+#define DATA_ACC_HIT_HDR_LEN 20
+#define DATA_ACC_ENC_RAW 0
+#define DATA_ACC_ENC_PACKED 1
+#define DATA_ACC_ENC_FEATURES 2
+#define DATA_ACC_ENC_CALIBRATED 3
+#define DATA_ACC_CAL_SCALE 16
+
+/* Response to:
+	subType: DATA_ACC_GET_BUF_STATS
+   Passed values:
+	none
+   Returned values in data portion of message:
+    All ULONGs are in BIG ENDIAN format.
+	ULONG written;	  hits put in the buffer
+	ULONG pending;	  hits not read out yet
+	ULONG dropped;	  hits refused under HIT_STOP
+	ULONG lost;		  hits overwritten before
+				 readout under HIT_OVERWRITE
+	ULONG policy;		  HIT_OVERWRITE or HIT_STOP
+   Size of returned values in data portion: */
+#define DATA_ACC_GET_BUF_STATS 11
+#define DATA_ACC_GET_BUF_STATS_LEN 20
+
+/* Response to:
+	subType: DATA_ACC_SET_POLICY
+   Passed values:
+	UBYTE policy;		  HIT_OVERWRITE or HIT_STOP
+   Size of passed values:
+	1
+   Returned values in data portion of message:
+	none */
+#define DATA_ACC_SET_POLICY 12
+
+/* Response to:
+	subType: DATA_ACC_SET_GENERATOR
+   Passed values:
+    All ULONGs are in BIG ENDIAN format.
+	UBYTE mode;		  DATA_ACC_GEN_xxx
+	UBYTE pattern;	  data pattern, DOMdata.h
+	UBYTE mspePercent;	  share of MSPE hits
+	UBYTE present;	  ATWDx_xx_PRES waveforms to fill
+	ULONG rateHz;		  0 as fast as the buffer takes
+   Size of passed values:
+	DATA_ACC_SET_GENERATOR_LEN
+   Returned values in data portion of message:
+	ULONG generated;	  hits made by the generator
+				 that was running, if any
+   Starts, restarts or stops the synthetic hit source
+   feeding the buffer, for tests without a DOM.
+   SERVICE_SPECIFIC_ERROR if it cannot be started.
+   Size of returned values in data portion: */
+#define DATA_ACC_SET_GENERATOR 13
+#define DATA_ACC_SET_GENERATOR_LEN 8
+#define DATA_ACC_SET_GENERATOR_RSP_LEN 4
+#define DATA_ACC_GEN_STOP 0
+#define DATA_ACC_GEN_FIXED 1
+#define DATA_ACC_GEN_POISSON 2
+
+/* Response to:
+	subType: DATA_ACC_GET_WINDOW
+   Passed values:
+    All ULONGs are in BIG ENDIAN format.
+	ULONG fromEpoch;	  first hit at or after
+	ULONG fromTime;
+	ULONG toEpoch;	  last hit before
+	ULONG toTime;
+	UBYTE encoding;	  DATA_ACC_ENC_xxx
+   Size of passed values:
+	DATA_ACC_GET_WINDOW_LEN
+   Returned values in data portion of message:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	USHORT hitCnt;
+	ULONG left;		  hits in the window that did
+				 not fit
+	ULONG epoch;		  epoch of the first hit
+				 returned, or the current one
+   followed by hitCnt hits as for DATA_ACC_GET_DATA.
+   An epoch counts the wraps of the 32 bit hit time, so a
+   hit's place in time is (epoch, time); a hit returned
+   with a time below the one before it is in the next
+   epoch.  The hits are looked up in the lookback buffer
+   and not read out: the DATA_ACC_GET_DATA place is not
+   moved.  Ask again from the time of the last hit plus
+   one for the hits left.
+   Size of returned values in data portion:
+	variable */
+#define DATA_ACC_GET_WINDOW 14
+#define DATA_ACC_GET_WINDOW_LEN 17
+#define DATA_ACC_WINDOW_HDR_LEN 10
+
+/* Response to:
+	subType: DATA_ACC_SET_FEATURES
+   Passed values:
+    All USHORTs are in BIG ENDIAN format.
+	USHORT loThreshold;	  above baseline, ADC counts
+	USHORT hiThreshold;
+	USHORT prescale;	  send every prescale'th hit
+				 raw, 0 none
+   Size of passed values:
+	DATA_ACC_SET_FEATURES_LEN
+   Returned values in data portion of message:
+	none
+   Sets how DATA_ACC_ENC_FEATURES finds pulses; the
+   thresholds are for the lo and hi waveforms. */
+#define DATA_ACC_SET_FEATURES 15
+#define DATA_ACC_SET_FEATURES_LEN 6
+#define DATA_ACC_FEATURE_LO_THRESHOLD 6
+#define DATA_ACC_FEATURE_HI_THRESHOLD 30
+
+/* Response to:
+	subType: DATA_ACC_SET_CALIBRATION
+   Passed values:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	UBYTE atwd;		  0..3
+	UBYTE channel;	  CAL_LO or CAL_HI
+	USHORT first;		  first sample set
+	USHORT cnt;
+	then cnt of:
+	 ULONG pedestal;	  IEEE single, ADC counts
+	 ULONG gain;		  IEEE single, mV per count
+   Size of passed values:
+	DATA_ACC_SET_CALIBRATION_LEN+8*cnt
+   Returned values in data portion of message:
+	none
+   Sets the tables DATA_ACC_ENC_CALIBRATED applies, see
+   dataAccess/calibration.h; until set, pedestal 0 and
+   gain 1.  A value that is not finite refuses the whole
+   request as badly formatted. */
+#define DATA_ACC_SET_CALIBRATION 16
+#define DATA_ACC_SET_CALIBRATION_LEN 6
+
+/* Response to:
+	subType: DATA_ACC_START_PEDESTAL
+   Passed values:
+    All ULONGs are in BIG ENDIAN format.
+	ULONG hits;		  forced trigger hits to average
+   Size of passed values:
+	DATA_ACC_START_PEDESTAL_LEN
+   Returned values in data portion of message:
+	none
+   Starts averaging the waveforms of the hits that come
+   in from now on, see dataAccess/pedestal.h; a run going
+   on is ended first.  SERVICE_SPECIFIC_ERROR if it cannot
+   be started. */
+#define DATA_ACC_START_PEDESTAL 17
+#define DATA_ACC_START_PEDESTAL_LEN 4
+
+/* Response to:
+	subType: DATA_ACC_GET_PEDESTAL
+   Passed values:
+	none, for the state only, or
+	UBYTE atwd;		  0..3
+	UBYTE variance;	  TRUE for variances too
+   Size of passed values:
+	0 or DATA_ACC_GET_PEDESTAL_LEN
+   Returned values in data portion of message:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	UBYTE state;		  PED_IDLE, PED_RUNNING or
+				 PED_DONE
+	ULONG done;		  hits averaged so far
+	ULONG target;		  hits asked for
+   then, once PED_DONE and for an atwd, for its lo and
+   then its hi channel:
+	ULONG cnt;		  waveforms averaged
+	USHORT mean[ATWD_LO_LEN or ATWD_HI_LEN/2];
+				 in 1/PED_SCALE counts
+	USHORT variance[the same];  if asked, 1/PED_SCALE
+				 counts squared
+   Size of returned values in data portion:
+	variable */
+#define DATA_ACC_GET_PEDESTAL 18
+#define DATA_ACC_GET_PEDESTAL_LEN 2
+#define DATA_ACC_PEDESTAL_HDR_LEN 9
+
+/* Response to:
+	subType: DATA_ACC_SET_FILTER
+   Passed values:
+	UBYTE minCoinc;
+	UBYTE minQuality;
+	UBYTE classes;	  HIT_FILTER_SPE|HIT_FILTER_MSPE
+	UBYTE coincAction;	  HIT_FILTER_KEEP, _DOWNGRADE
+	UBYTE qualityAction;	  or _DROP
+	UBYTE classAction;
+   Size of passed values:
+	DATA_ACC_SET_FILTER_LEN
+   Returned values in data portion of message:
+	none
+   Sets the selection hits from the generator pass
+   before they reach the buffer, see
+   dataAccess/hitFilter.h.  Takes effect from the next
+   batch of hits. */
+#define DATA_ACC_SET_FILTER 19
+#define DATA_ACC_SET_FILTER_LEN 6
+
+/* Response to:
+	subType: DATA_ACC_GET_FILTER_STATS
+   Passed values:
+	none
+   Returned values in data portion of message:
+    All ULONGs are in BIG ENDIAN format.
+	the DATA_ACC_SET_FILTER values in effect
+	then for coinc, quality and class:
+	 ULONG accepted;
+	 ULONG rejected;
+	ULONG kept;		  downgraded ones included
+	ULONG downgraded;
+	ULONG dropped;
+   Size of returned values in data portion: */
+#define DATA_ACC_GET_FILTER_STATS 20
+#define DATA_ACC_GET_FILTER_STATS_LEN 42
+
+/* Response to:
+	subType: DATA_ACC_SET_SCALER
+   Passed values:
+    All ULONGs are in BIG ENDIAN format.
+	ULONG binTicks;	  bin width, trigger clock
+				 ticks, not 0
+	ULONG deadTicks;	  dead time after a hit
+				 counted
+   Size of passed values:
+	DATA_ACC_SET_SCALER_LEN
+   Returned values in data portion of message:
+	none
+   Sets the scaler stream's bins, see dataAccess/scaler.h;
+   a new bin starts at the next hit.  The defaults are
+   SCALER_BIN_TICKS and SCALER_DEAD_TICKS. */
+#define DATA_ACC_SET_SCALER 21
+#define DATA_ACC_SET_SCALER_LEN 8
+
+/* Response to:
+	subType: DATA_ACC_GET_SCALERS
+   Passed values:
+	none
+   Returned values in data portion of message:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	ULONG first;		  number of the first bin
+	ULONG lost;		  bytes lost since the last
+				 read, before first
+	ULONG dead;		  hits not counted for dead
+				 time, since DA began
+	USHORT cnt;		  bytes to follow
+	UBYTE bins[cnt];	  two 4 bit counts a byte,
+				 the earlier high
+   Size of returned values in data portion:
+	DATA_ACC_SCALER_HDR_LEN+cnt
+   Returns the closed bins not yet read, as many as fit;
+   they are read out apart from the hits and keep coming
+   when hits are dropped or not read. */
+#define DATA_ACC_GET_SCALERS 22
+#define DATA_ACC_SCALER_HDR_LEN 14
+
+/* Response to:
+	subType: DATA_ACC_SET_HISTOGRAM
+   Passed values:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	UBYTE quantity;	  HIST_ENERGY or HIST_INTERVAL
+	UBYTE scale;		  HIST_LINEAR or HIST_LOG
+	UBYTE shift;		  HIST_LOG, log2 of the bins
+				 an octave, 0..HIST_MAX_SHIFT
+	USHORT bins;		  1..HIST_MAX_BINS
+	ULONG lo;		  signed, above 0 for HIST_LOG
+	ULONG width;		  HIST_LINEAR, not 0
+   Size of passed values:
+	DATA_ACC_SET_HISTOGRAM_LEN
+   Returned values in data portion of message:
+	none
+   Sets the axis of a histogram and empties it, see
+   dataAccess/histogram.h.  Energy is binned linearly,
+   DATA_ACC_ENERGY_BINS of DATA_ACC_ENERGY_WIDTH from 0, and
+   the ticks between hits in DATA_ACC_INTERVAL_BINS log
+   bins of shift DATA_ACC_INTERVAL_SHIFT from 1, until
+   set. */
+#define DATA_ACC_SET_HISTOGRAM 23
+#define DATA_ACC_SET_HISTOGRAM_LEN 13
+#define DATA_ACC_ENERGY_BINS 256
+#define DATA_ACC_ENERGY_WIDTH 8
+#define DATA_ACC_INTERVAL_BINS 128
+#define DATA_ACC_INTERVAL_SHIFT 2
+
+/* Response to:
+	subType: DATA_ACC_GET_HISTOGRAM
+   Passed values:
+	UBYTE quantity;	  HIST_ENERGY or HIST_INTERVAL
+	UBYTE format;		  HIST_SPARSE or HIST_DELTA
+	UBYTE since;		  TRUE for the counts since the
+				 last read with since TRUE
+   Size of passed values:
+	DATA_ACC_GET_HISTOGRAM_LEN
+   Returned values in data portion of message:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	UBYTE quantity;
+	UBYTE format;
+	USHORT bins;
+	ULONG underflow;
+	ULONG overflow;
+   then for HIST_SPARSE:
+	USHORT cnt;		  bins not empty
+	then cnt of:
+	 USHORT bin;
+	 ULONG count;
+   or for HIST_DELTA, for each bin, the zigzag coded
+   count less the one of the bin before, in 7 bit groups
+   low first, the top bit set on all but the last group.
+   Size of returned values in data portion:
+	variable, at most DATA_ACC_HISTOGRAM_HDR_LEN+
+	HIST_MAX_LEN */
+#define DATA_ACC_GET_HISTOGRAM 24
+#define DATA_ACC_GET_HISTOGRAM_LEN 3
+#define DATA_ACC_HISTOGRAM_HDR_LEN 12
+
+/* error ids, see GET_LAST_ERROR_ID */
+#define DATA_ACC_bad_msg_format 10
+
+/* error strings */
+#define DATA_ACC_ERS_NO_ERRORS "DATA_ACCESS: no errors"
+#define DATA_ACC_ERS_BAD_MSG_SUBTYPE "DATA_ACCESS: bad subtype"
+#define DATA_ACC_ERS_BAD_MSG_FORMAT "DATA_ACCESS: bad message format"
+
+#endif
@@ -0,0 +1,57 @@
+/* calibration.h */
+
+#ifndef _CALIBRATION_
+#define _CALIBRATION_
+
+/* ATWD samples to millivolts.  Every sample of every
+   channel has its own pedestal and gain, kept as a gain
+   and an offset so that a sample takes one multiply-add:
+	mV = sample*gain + offset,  offset = -pedestal*gain
+   The tables are cache line aligned and a waveform is
+   calibrated into a float arena, 8 samples at a time
+   with AVX2 and FMA, 4 with SSE2, scalar otherwise. */
+
+#define CAL_LO 0
+#define CAL_HI 1
+#define CAL_CHANNELS 2
+/* samples of the longest waveform */
+#define CAL_SAMPLES (ATWD_HI_LEN/2)
+#define CAL_CACHE_LINE 64
+
+typedef struct {
+	float gain[HIT_ATWD_CNT][CAL_CHANNELS][CAL_SAMPLES]
+	    __attribute__((aligned(CAL_CACHE_LINE)));
+	float offset[HIT_ATWD_CNT][CAL_CHANNELS][CAL_SAMPLES]
+	    __attribute__((aligned(CAL_CACHE_LINE)));
+} CAL_TABLES;
+
+/* a hit's waveforms in mV */
+typedef struct {
+	float lo[HIT_ATWD_CNT][ATWD_LO_LEN]
+	    __attribute__((aligned(CAL_CACHE_LINE)));
+	float hi[HIT_ATWD_CNT][ATWD_HI_LEN/2]
+	    __attribute__((aligned(CAL_CACHE_LINE)));
+} CAL_HIT;
+
+/* gain 1, pedestal 0 everywhere */
+void calibration_init(CAL_TABLES *t);
+
+void calibration_set(CAL_TABLES *t, int atwd, int channel, int sample,
+	float pedestal, float gain);
+
+/* n samples of v, n a multiple of 8, into out */
+void calibration_apply8(const CAL_TABLES *t, int atwd, const UBYTE *v,
+	int n, float *out);
+void calibration_apply16(const CAL_TABLES *t, int atwd, const USHORT *v,
+	int n, float *out);
+
+/* the waveforms of h named in present, ATWDx_xx_PRES */
+void calibration_applyHit(const CAL_TABLES *t, HIT_RECORD *h,
+	UBYTE present, CAL_HIT *out);
+
+/* out[i]=in[i]*scale, held to +-32767 and rounded to
+   nearest, halves to even; n a multiple of 8.  The same
+   with or without SSE2. */
+void calibration_toFixed(const float *in, int n, float scale, short *out);
+
+#endif
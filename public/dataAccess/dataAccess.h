@@ -0,0 +1,30 @@
+/* dataAccess.h */
+
+#ifndef _DATA_ACCESS_
+#define _DATA_ACCESS_
+
+/* Data Access service.  Hits are put in dataAccHits by
+   their source, through dataAccFilter; the DAQ reads them
+   out with DATA_ACC_GET_DATA through the service's own
+   reader of the buffer.  The source counts every hit in
+   dataAccScaler too, read with DATA_ACC_GET_SCALERS, and
+   adds it to dataAccHists, read with
+   DATA_ACC_GET_HISTOGRAM.  Run by the service workers on
+   DA. */
+
+extern COMMON_SERVICE_INFO dataAcc;
+extern HIT_BUFFER dataAccHits;
+extern HIT_FILTER dataAccFilter;
+extern SCALER dataAccScaler;
+extern HISTOGRAM dataAccHists[HIST_QUANTITIES];
+
+/* empty buffer, HIT_OVERWRITE, a filter keeping every
+   hit, an empty scaler stream and empty histograms with
+   the default bins.
+   After commonServices_init() on dataAcc. */
+void dataAccess_init(void);
+
+/* SERVICE_FN for the DA queue */
+UBYTE dataAccess_serve(MESSAGE_STRUCT *M);
+
+#endif
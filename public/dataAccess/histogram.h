@@ -0,0 +1,101 @@
+/* histogram.h */
+
+#ifndef _HISTOGRAM_
+#define _HISTOGRAM_
+
+/* Histograms of a trigger quantity of each hit, filled as
+   the hits come from their source: the energy, or the
+   clock ticks since the hit before.
+
+   An axis is linear, bins width ticks wide from lo, or
+   logarithmic, 2^shift bins an octave, lo rounded down to
+   its bin.  Below lo counts as underflow, past the last bin
+   as overflow.
+
+   Every thread adding hits does so into a partial
+   histogram of its own, without locks; a read sums the
+   partials.  Setting the axis starts a new generation: a
+   thread clears its partial at its next hit, and a read
+   sums only the partials of the current one.
+
+   A histogram is read out sparse, the bins not empty with
+   their counts, or as the zigzag coded differences between
+   neighbouring counts in 7 bit groups, low first, the top
+   bit set on all groups but the last of a difference;
+   either way a smooth histogram takes a few hundred
+   bytes. */
+
+#define HIST_ENERGY 0
+#define HIST_INTERVAL 1
+#define HIST_QUANTITIES 2
+
+/* axes */
+#define HIST_LINEAR 0
+#define HIST_LOG 1
+
+/* readout formats */
+#define HIST_SPARSE 0
+#define HIST_DELTA 1
+
+#define HIST_MAX_BINS 256
+#define HIST_MAX_SHIFT 4
+#define HIST_MAX_PARTS 4
+
+/* largest readout of a histogram */
+#define HIST_MAX_LEN (2+6*HIST_MAX_BINS)
+
+typedef struct {
+	UBYTE scale;		/* HIST_LINEAR or HIST_LOG */
+	UBYTE shift;		/* HIST_LOG, 0..HIST_MAX_SHIFT */
+	USHORT bins;		/* 1..HIST_MAX_BINS */
+	long lo;
+	ULONG width;		/* HIST_LINEAR, not 0 */
+} HIST_AXIS;
+
+/* counts are underflow, the bins, then overflow */
+typedef struct {
+	ULONG gen;
+	HIST_AXIS axis;
+	/* first bin index of the log axis */
+	ULONG first;
+	/* time of the last hit, HIST_INTERVAL */
+	ULONG last;
+	int started;
+	ULONG count[HIST_MAX_BINS+2];
+} HIST_PART;
+
+typedef struct {
+	int quantity;		/* HIST_ENERGY or HIST_INTERVAL */
+	HIST_AXIS axis;
+	volatile ULONG gen;
+	HIST_PART part[HIST_MAX_PARTS];
+	volatile int owned[HIST_MAX_PARTS];
+} HISTOGRAM;
+
+/* TRUE if a is an axis histograms take */
+int histogram_validAxis(const HIST_AXIS *a);
+
+/* empty histogram of quantity, axis valid */
+void histogram_init(HISTOGRAM *h, int quantity, const HIST_AXIS *a);
+
+/* new axis and generation, axis valid */
+void histogram_set(HISTOGRAM *h, const HIST_AXIS *a);
+
+/* a partial for the calling thread, 0 if none is left.
+   A partial left keeps its counts for the next thread. */
+HIST_PART *histogram_join(HISTOGRAM *h);
+void histogram_leave(HISTOGRAM *h, HIST_PART *p);
+
+/* add the n hits at hits to p, a partial of h */
+void histogram_add(HISTOGRAM *h, HIST_PART *p, HIT_RECORD *hits, int n);
+
+/* the partials of the current generation summed into
+   count, HIST_MAX_BINS+2 of them.  Returns the bins. */
+int histogram_sum(HISTOGRAM *h, ULONG *count);
+
+/* bins counts, underflow and overflow apart, to out as
+   HIST_SPARSE or HIST_DELTA.  Returns the bytes written,
+   at most HIST_MAX_LEN. */
+int histogram_encode(const ULONG *count, int bins, int format, UBYTE *out);
+
+#endif
@@ -0,0 +1,171 @@
+/* hitBuffer.h */
+
+#ifndef _HIT_BUFFER_
+#define _HIT_BUFFER_
+
+/* Lookback buffer of hits.  One producer writes hits into
+   a fixed ring; any number of readers follow it, each with
+   its own cursor, so a reader never takes a hit away from
+   another.  Nothing locks: the producer clears a slot's
+   sequence number while it writes the slot, and a reader
+   checks it before and after copying a hit out.
+
+   With HIT_OVERWRITE the producer never waits; a reader
+   that falls more than HIT_BUFFER_LEN hits behind skips to
+   the oldest hit still held and counts what it missed.
+   With HIT_STOP the producer drops new hits while the
+   slowest reader is a full ring behind, and counts them.
+
+   Hits are held as columns, not as HIT_RECORDs: times,
+   energies, flags and quality each in an array of their
+   own, the rest of DOM_DATA and the waveforms apart.  A
+   scan of one column then reads nothing else.  A reader
+   gets a hit back as a HIT_RECORD, its row view.
+
+   The 32 bit trigger clock wraps every couple of minutes.
+   The buffer counts the wraps, and each hit keeps the
+   epoch it was taken in, so (epoch, time) grows with the
+   hit number and hits are found by time with a binary
+   search.  This takes hits to come in time order; one
+   that comes late by less than half the clock is given
+   the epoch of its time and is not taken for a wrap. */
+
+/* must be a power of two */
+#define HIT_BUFFER_LEN 1024
+#define HIT_BUFFER_MAX_READERS 4
+#define HIT_ATWD_CNT 4
+
+/* the trigger clock, times compare modulo this.  The
+   time column keeps just its 32 bits, so a scan over it
+   moves as many times per vector as the target can. */
+#define HIT_TIME_MASK 0xffffffffUL
+typedef unsigned int HIT_TIME;
+
+/* flags column: the waveform present bits of
+   DAmessageAPIstatus.h, and */
+#define HIT_FLAG_PRESENT 0xff
+#define HIT_FLAG_SPE 0x100
+
+/* overflow policy */
+#define HIT_OVERWRITE 0
+#define HIT_STOP 1
+
+/* where a new reader starts */
+#define HIT_FROM_OLDEST 0
+#define HIT_FROM_NEW 1
+
+/* one hit: DOM_DATA and the waveforms it says are there.
+   lo is 8 bit samples, hi 16 bit. */
+typedef struct {
+	ULONG seq;		/* hit number, set by the buffer */
+	ULONG epoch;		/* clock wraps before it, likewise */
+	DOM_DATA dom;
+	UBYTE lo[HIT_ATWD_CNT][ATWD_LO_LEN];
+	USHORT hi[HIT_ATWD_CNT][ATWD_HI_LEN/2];
+} HIT_RECORD;
+
+/* the rarely scanned rest of DOM_DATA */
+typedef struct {
+	BYTE contents[HIT_ATWD_CNT];
+	SLOWADC_DESC adc;
+} HIT_DETAIL;
+
+typedef struct {
+	UBYTE lo[HIT_ATWD_CNT][ATWD_LO_LEN];
+	USHORT hi[HIT_ATWD_CNT][ATWD_HI_LEN/2];
+} HIT_WAVES;
+
+typedef struct {
+	/* next hit to read */
+	volatile ULONG next;
+	/* hits overwritten before this reader got to them */
+	ULONG lost;
+	int active;
+} HIT_READER;
+
+typedef struct {
+	/* per slot: n+1 once hit n is written, 0 while
+	   being written */
+	volatile ULONG seq[HIT_BUFFER_LEN];
+	HIT_TIME time[HIT_BUFFER_LEN];
+	ULONG epoch[HIT_BUFFER_LEN];
+	int energy[HIT_BUFFER_LEN];
+	USHORT flags[HIT_BUFFER_LEN];
+	BYTE quality[HIT_BUFFER_LEN];
+	BYTE coinc[HIT_BUFFER_LEN];
+	HIT_DETAIL detail[HIT_BUFFER_LEN];
+	HIT_WAVES wave[HIT_BUFFER_LEN];
+	/* the hit being claimed, spread into the columns
+	   when it is published */
+	HIT_RECORD claimed;
+	/* next hit to write */
+	volatile ULONG head;
+	/* clock wraps so far, and the latest time seen */
+	ULONG curEpoch;
+	HIT_TIME lastTime;
+	int policy;
+	/* hits dropped under HIT_STOP */
+	ULONG dropped;
+	HIT_READER *reader[HIT_BUFFER_MAX_READERS];
+} HIT_BUFFER;
+
+void hitBuffer_init(HIT_BUFFER *b, int policy);
+
+void hitBuffer_setPolicy(HIT_BUFFER *b, int policy);
+
+/* producer: record for the next hit, or 0 if HIT_STOP
+   drops it.  Fill it in and hitBuffer_publish() it. */
+HIT_RECORD *hitBuffer_claim(HIT_BUFFER *b);
+void hitBuffer_publish(HIT_BUFFER *b);
+
+/* copy of h as the next hit, FALSE if it was dropped */
+int hitBuffer_put(HIT_BUFFER *b, HIT_RECORD *h);
+
+/* start r at the oldest hit held, or with HIT_FROM_NEW
+   at the next hit put; r is placed before the producer
+   can see it.  Returns 0, or -1 if all reader places are
+   taken. */
+int hitBuffer_addReader(HIT_BUFFER *b, HIT_READER *r, int from);
+void hitBuffer_removeReader(HIT_BUFFER *b, HIT_READER *r);
+
+/* row view of hit n into out.  Returns FALSE if it is
+   not held, or was overwritten while being copied. */
+int hitBuffer_row(HIT_BUFFER *b, ULONG n, HIT_RECORD *out);
+
+/* copy r's next hit into out without moving past it.
+   Returns FALSE if there is none yet. */
+int hitBuffer_peek(HIT_BUFFER *b, HIT_READER *r, HIT_RECORD *out);
+
+/* move r past the hit last peeked */
+void hitBuffer_next(HIT_READER *r);
+
+/* hits held for r, not counting overwritten ones */
+ULONG hitBuffer_pending(HIT_BUFFER *b, HIT_READER *r);
+
+/* number of the first hit held taken at or after
+   (epoch, time), head if there is none.  Hits being
+   overwritten meanwhile may put it off by those few;
+   check the rows. */
+ULONG hitBuffer_find(HIT_BUFFER *b, ULONG epoch, ULONG time);
+
+/* Scans of the n hits from hit first on, n at most
+   HIT_BUFFER_LEN, each over as few columns as it can.
+   They look at the columns as they are, so hits the
+   producer overwrites meanwhile are seen new; check a
+   hit's row view before trusting it.
+
+   A hit is in the window t0, span if its time is t0 or
+   later and earlier than t0+span, modulo HIT_TIME_MASK+1.
+   It has the flags mask, want if (flags&mask)==want. */
+ULONG hitBuffer_countTime(HIT_BUFFER *b, ULONG first, ULONG n,
+	ULONG t0, ULONG span);
+ULONG hitBuffer_countFlags(HIT_BUFFER *b, ULONG first, ULONG n,
+	USHORT mask, USHORT want);
+
+/* both: match[i] is set to 1 if hit first+i is in the
+   window and has the flags, 0 if not.  Returns the
+   number matched. */
+ULONG hitBuffer_select(HIT_BUFFER *b, ULONG first, ULONG n,
+	ULONG t0, ULONG span, USHORT mask, USHORT want, UBYTE *match);
+
+#endif
@@ -0,0 +1,75 @@
+/* hitFilter.h */
+
+#ifndef _HIT_FILTER_
+#define _HIT_FILTER_
+
+/* Hit selection between a hit source and the lookback
+   buffer.  Each rule looks at one trigger field:
+	HIT_FILTER_COINC	coinc at least minCoinc
+	HIT_FILTER_QUALITY	quality at least minQuality
+	HIT_FILTER_CLASS	SPE or MSPE, as classes allows
+   and a hit failing it is kept, downgraded (its
+   waveforms dropped, the trigger kept) or dropped, as
+   the rule's action says; the hardest action of the
+   rules it fails wins.  coinc and quality are compared
+   as unsigned.
+
+   Hits are judged a batch at a time, field by field,
+   without branches.  Each rule counts the hits it
+   accepts and rejects.  The configuration is packed into
+   one word and swapped atomically, so it can be changed
+   while the source runs; a batch is judged under one
+   configuration. */
+
+#define HIT_FILTER_COINC 0
+#define HIT_FILTER_QUALITY 1
+#define HIT_FILTER_CLASS 2
+#define HIT_FILTER_RULES 3
+
+/* actions, ordered so that or-ing them picks the
+   hardest */
+#define HIT_FILTER_KEEP 0
+#define HIT_FILTER_DOWNGRADE 1
+#define HIT_FILTER_DROP 3
+
+/* classes */
+#define HIT_FILTER_MSPE 1
+#define HIT_FILTER_SPE 2
+
+/* hits judged at a time */
+#define HIT_FILTER_BATCH 16
+
+typedef struct {
+	UBYTE minCoinc;
+	UBYTE minQuality;
+	UBYTE classes;
+	UBYTE action[HIT_FILTER_RULES];
+} HIT_FILTER_CONFIG;
+
+typedef struct {
+	/* HIT_FILTER_CONFIG, packed */
+	volatile unsigned int config;
+	ULONG accepted[HIT_FILTER_RULES];
+	ULONG rejected[HIT_FILTER_RULES];
+	/* kept counts the downgraded too */
+	ULONG kept;
+	ULONG downgraded;
+	ULONG dropped;
+} HIT_FILTER;
+
+/* keep everything, counters cleared */
+void hitFilter_init(HIT_FILTER *f);
+
+void hitFilter_set(HIT_FILTER *f, const HIT_FILTER_CONFIG *cfg);
+void hitFilter_get(HIT_FILTER *f, HIT_FILTER_CONFIG *cfg);
+
+/* judge the n hits at h, n at most HIT_FILTER_BATCH, and
+   downgrade those to be.  verdict[i] is set to the
+   action taken on h[i].  Returns the hits not dropped. */
+int hitFilter_run(HIT_FILTER *f, HIT_RECORD *h, int n, UBYTE *verdict);
+
+/* hitFilter_run(), then the hits not dropped into b.
+   Returns the hits b took. */
+int hitFilter_put(HIT_FILTER *f, HIT_BUFFER *b, HIT_RECORD *h, int n);
+
+#endif
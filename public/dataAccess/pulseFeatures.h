@@ -0,0 +1,47 @@
+/* pulseFeatures.h */
+
+#ifndef _PULSE_FEATURES_
+#define _PULSE_FEATURES_
+
+/* Pulses found in an ATWD waveform, for readout in place
+   of the waveform.  The baseline is the lower of the means
+   of the first and the last PULSE_BASELINE_LEN samples.
+   A pulse is a run of samples more than the threshold
+   above it; for each the peak, the charge (the sum above
+   baseline over the run) and the leading edge time (where
+   the rise crosses half the peak, interpolated) are kept.
+
+   Subtracting the baseline and finding the samples over
+   threshold uses AVX2 or SSE2 when the compiler targets
+   them, 16 or 8 samples at a time, and is scalar
+   otherwise. */
+
+#define PULSE_BASELINE_LEN 16
+/* pulses past this many are not reported */
+#define PULSE_MAX 8
+/* leading edge times are in 1/PULSE_TIME_SCALE samples */
+#define PULSE_TIME_SCALE 16
+
+typedef struct {
+	USHORT time;		/* leading edge */
+	USHORT peak;		/* above baseline */
+	ULONG charge;		/* above baseline */
+} PULSE_FEATURE;
+
+typedef struct {
+	USHORT baseline;
+	int cnt;
+	/* runs over threshold, including those past
+	   PULSE_MAX */
+	int found;
+	PULSE_FEATURE pulse[PULSE_MAX];
+} PULSE_FEATURES;
+
+/* pulses of the n samples of v, n a multiple of 32 and at
+   most ATWD_HI_LEN/2 */
+void pulseFeatures_find16(const USHORT *v, int n, USHORT threshold,
+	PULSE_FEATURES *out);
+void pulseFeatures_find8(const UBYTE *v, int n, USHORT threshold,
+	PULSE_FEATURES *out);
+
+#endif
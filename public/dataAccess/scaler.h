@@ -0,0 +1,76 @@
+/* scaler.h */
+
+#ifndef _SCALER_
+#define _SCALER_
+
+/* Supernova style scaler stream.  Every hit's trigger
+   time is counted, as it comes from its source and before
+   any filter or buffer, into fixed bins of the trigger
+   clock; a bin is closed by the first hit past it, so the
+   stream moves on with the hit times.  A hit within the
+   dead time of the last hit counted is not counted, nor is
+   one that comes earlier than it.
+
+   Counts are 4 bits and stop at SCALER_MAX.  Two bins go
+   to a byte, the earlier in the high nibble, and the
+   bytes into a ring of their own, read out in large
+   batches apart from the hits; a reader that falls a
+   ring behind loses the oldest bytes and is told how
+   many.  One producer adds hits and one reader reads, and
+   nothing locks. */
+
+/* must be a power of two */
+#define SCALER_RING_LEN 8192
+#define SCALER_MAX 15
+
+/* defaults, in 40 MHz trigger clock ticks: 1.6 ms bins
+   and 250 us dead time */
+#define SCALER_BIN_TICKS 64000
+#define SCALER_DEAD_TICKS 10000
+
+typedef struct {
+	/* settings in use, and set for the next hit */
+	ULONG binTicks;
+	ULONG deadTicks;
+	ULONG newBinTicks;
+	ULONG newDeadTicks;
+	volatile int change;
+
+	/* the open bin */
+	int started;
+	ULONG binStart;
+	ULONG lastCounted;
+	UBYTE count;
+	/* the earlier bin of a byte not yet full */
+	UBYTE high;
+	int half;
+
+	/* hits in dead time, and bins that saturated */
+	ULONG dead;
+	ULONG saturated;
+
+	UBYTE ring[SCALER_RING_LEN];
+	/* bytes written, and read */
+	volatile ULONG head;
+	ULONG tail;
+	/* bytes overwritten before they were read */
+	ULONG lost;
+} SCALER;
+
+/* empty stream with the given settings */
+void scaler_init(SCALER *s, ULONG binTicks, ULONG deadTicks);
+
+/* new settings, taken up by the producer at the next
+   hit; the stream starts a new bin there */
+void scaler_set(SCALER *s, ULONG binTicks, ULONG deadTicks);
+
+/* count a hit at trigger time t, producer only */
+void scaler_add(SCALER *s, ULONG t);
+
+/* up to max bytes of closed bins to out.  *first is set
+   to the number of the first bin sent and *lost to the
+   bytes lost since the last read.  Returns the bytes
+   copied. */
+int scaler_read(SCALER *s, UBYTE *out, int max, ULONG *first, ULONG *lost);
+
+#endif
@@ -0,0 +1,47 @@
+/* waveformCodec.h */
+
+#ifndef _WAVEFORM_CODEC_
+#define _WAVEFORM_CODEC_
+
+/* Lossless coding of ATWD waveforms for readout.  Most
+   samples sit near the pedestal, so neighbouring samples
+   differ by little.  A waveform is coded as its first
+   sample and the zigzag coded differences between
+   neighbours ((d<<1)^(d>>15), 16 bit), bit-packed in
+   blocks of WAVE_CODEC_BLOCK with one bit width per block.
+   A waveform that would not get smaller is left raw.
+
+   Coded waveform:
+	UBYTE method;		  WAVE_RAW or WAVE_PACKED
+   WAVE_RAW: the samples as in an uncoded hit.
+   WAVE_PACKED:
+	first sample, 1 byte (lo) or 2 bytes big endian (hi)
+	then per block:
+	 UBYTE width;		  bits per difference, 0..16
+	 width*WAVE_CODEC_BLOCK/8 bytes, the differences
+	 packed low bit first; the first difference of the
+	 waveform is 0.
+
+   The difference and width pass uses AVX2 when the
+   compiler targets it, and undoing the differences uses
+   SSE2; both have a scalar fallback producing the same
+   bytes. */
+
+#define WAVE_RAW 0
+#define WAVE_PACKED 1
+#define WAVE_CODEC_BLOCK 32
+
+/* largest coded size of n samples of size bytes each */
+#define WAVE_CODEC_MAX_LEN(n,size) (1+(n)*(size))
+
+/* code n samples, n a multiple of WAVE_CODEC_BLOCK.
+   Returns the bytes written to out. */
+int waveformCodec_encode8(const UBYTE *in, int n, UBYTE *out);
+int waveformCodec_encode16(const USHORT *in, int n, UBYTE *out);
+
+/* undo the above from at most len bytes.  Returns the
+   bytes used, or -1 if in is cut short or bad. */
+int waveformCodec_decode8(const UBYTE *in, int len, UBYTE *out, int n);
+int waveformCodec_decode16(const UBYTE *in, int len, USHORT *out, int n);
+
+#endif
@@ -100,4 +100,30 @@
    Size of returned values in data portion: */
 #define GET_SERVICE_STATS_LEN 12
 
+/* Response to: 
+	subType: GET_SERVICE_EVENTS
+   Passed values:
+	none
+   Size of passed values:
+	0  
+   Returned values in data portion of message:
+    All ULONGs are in BIG ENDIAN format.
+	ULONG lostCnt;	  events overwritten before they
+			 were read, since the last request
+   followed by as many events as fit, oldest first:
+	ULONG seq;	  count of events in the service,
+			 gaps show lost events
+	ULONG timeUsec;	  monotonic clock, wraps
+	UBYTE errorID;	  as for GET_LAST_ERROR_ID
+	UBYTE errorSeverity;
+	UBYTE type;	  message that caused the event
+	UBYTE subtype;
+   Events returned are removed; events that did not fit
+   are left for the next request.  Each service keeps the
+   last EVENT_RING_LEN events.
+   Size of returned values in data portion:
+	GET_SERVICE_EVENTS_HDR_LEN+n*GET_SERVICE_EVENT_REC_LEN */
+#define GET_SERVICE_EVENTS_HDR_LEN 4
+#define GET_SERVICE_EVENT_REC_LEN 12
+
 #endif
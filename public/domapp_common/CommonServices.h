@@ -10,6 +10,9 @@
    other programs, like the message handler, can
    understand and access the appropriate structs. */
 
+#include "domapp_common/statCounters.h"
+#include "domapp_common/eventRing.h"
+
 #define MAX_ERROR_STR_LEN 80
 #define NULL_ERROR_STR ""
 
@@ -20,10 +23,39 @@ typedef struct {
 	UBYTE majorVersion;
 	UBYTE minorVersion;
 	UBYTE spare;
-	char lastErrorStr[MAX_ERROR_STR_LEN];
-	ULONG msgReceived;
-	ULONG msgRefused;
-	ULONG msgProcessingErr;
+	/* msgReceived, msgRefused, msgProcessingErr,
+	   indexed by SVC_xxx in DOMstats.h */
+	STAT_GROUP stats;
+	/* every error, not just the last one */
+	EVENT_RING events;
+	/* text for this service's error IDs, only called on
+	   readout.  NULL if it uses the COMMON_xxx IDs only. */
+	const char *(*errorStr)(UBYTE id);
 } COMMON_SERVICE_INFO;
 
+/* set up a service's common info at startup */
+void commonServices_init(COMMON_SERVICE_INFO *info,
+	UBYTE majorVersion, UBYTE minorVersion);
+
+/* answer the common subtypes (GET_SERVICE_STATE etc.)
+   from a service's common info.  Fills in the reply and
+   returns the message status, UNKNOWN_SUBTYPE for
+   anything service specific. */
+UBYTE commonServices_serve(COMMON_SERVICE_INFO *info,
+	MESSAGE_STRUCT *M);
+
+/* note an error while handling M: becomes the last error
+   and is added to the event ring.  No text is made here,
+   safe to call from any thread. */
+void commonServices_recordError(COMMON_SERVICE_INFO *info,
+	UBYTE id, UBYTE severity, MESSAGE_STRUCT *M);
+
+/* text for one of the service's error IDs */
+const char *commonServices_errorStr(COMMON_SERVICE_INFO *info,
+	UBYTE id);
+
+/* drain the event ring into a GET_SERVICE_EVENTS reply */
+void commonServices_getEvents(COMMON_SERVICE_INFO *info,
+	MESSAGE_STRUCT *M);
+
 #endif
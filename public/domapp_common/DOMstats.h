@@ -0,0 +1,61 @@
+/* DOMstats.h */
+
+#ifndef _DOM_STATS_
+#define _DOM_STATS_
+
+/* domapp wide statistics counter groups.  The index
+   values follow the order of the MSGHAND_GET_PKT_STATS
+   and MSGHAND_GET_MSG_STATS replies. */
+
+/* packet driver counters */
+#define PKT_RECV 0
+#define PKT_SENT 1
+#define PKT_NO_STORAGE 2
+#define PKT_BUF_OVR 3
+#define PKT_BAD_FMT 4
+#define PKT_SPARE 5
+#define PKT_STATS_CNT 6
+
+/* message level counters */
+#define MSG_RECV 0
+#define MSG_SENT 1
+#define MSG_TOO_MUCH_DATA 2
+#define MSG_ID_MISMATCH 3
+#define MSG_CRC_PROBLEM 4
+#define MSG_STATS_CNT 5
+
+/* service queue overflows seen by msgHandler */
+#define OVFL_SLOW_CNT 0
+#define OVFL_DATA_ACC 1
+#define OVFL_EXP_CNT 2
+#define OVFL_SENDER 3
+#define OVFL_STATS_CNT 4
+
+/* per service, kept in COMMON_SERVICE_INFO */
+#define SVC_MSG_RECEIVED 0
+#define SVC_MSG_REFUSED 1
+#define SVC_MSG_PROCESSING_ERR 2
+#define SVC_STATS_CNT 3
+
+/* the groups live together so they can be kept in
+   shared memory across a restart */
+typedef struct {
+	STAT_GROUP pkt;
+	STAT_GROUP msg;
+	STAT_GROUP ovfl;
+} DOM_STATS;
+
+extern DOM_STATS *domStats;
+#define pktStats (domStats->pkt)
+#define msgStats (domStats->msg)
+#define ovflStats (domStats->ovfl)
+
+/* zeroed groups in process memory */
+void DOMstats_init(void);
+
+/* use the groups at shared instead.  If warm, they hold
+   counts from an earlier run and are kept; otherwise they
+   are zeroed. */
+void DOMstats_attach(DOM_STATS *shared, int warm);
+
+#endif
@@ -75,5 +75,6 @@ enum Type {
 #define GET_SERVICE_STATS 6
 #define	REMOTE_OBJECT_REF 7
 #define GET_SERVICE_SUMMARY 8
+#define GET_SERVICE_EVENTS 9
 
 #endif
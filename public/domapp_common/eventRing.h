@@ -0,0 +1,51 @@
+/* eventRing.h */
+
+#ifndef _EVENT_RING_
+#define _EVENT_RING_
+
+/* Per-service record of errors and other events.  Any
+   thread may add a record without locking: it claims the
+   next index with one atomic add and publishes the record
+   by writing its sequence number last.  When the ring is
+   full the oldest records are overwritten and counted as
+   lost.  Records are small and binary, text is only made
+   when someone reads them out.  One reader drains. */
+
+/* must be a power of two */
+#define EVENT_RING_LEN 64
+
+typedef struct {
+	/* 1 + index of the record, 0 while being written */
+	volatile ULONG seq;
+	ULONG timeUsec;
+	UBYTE id;
+	UBYTE severity;
+	UBYTE type;
+	UBYTE subtype;
+} EVENT_RECORD;
+
+typedef struct {
+	EVENT_RECORD rec[EVENT_RING_LEN];
+	/* next index to write */
+	volatile ULONG head;
+	/* next index to drain, reader only */
+	ULONG tail;
+	/* records overwritten before they were drained */
+	ULONG lost;
+} EVENT_RING;
+
+void eventRing_init(EVENT_RING *r);
+
+/* add a record, never blocks */
+void eventRing_put(EVENT_RING *r, UBYTE id, UBYTE severity,
+	UBYTE type, UBYTE subtype);
+
+/* move up to max records, oldest first, into out.  Returns
+   the number copied; records still being written are left
+   for the next call. */
+int eventRing_drain(EVENT_RING *r, EVENT_RECORD *out, int max);
+
+/* lost count since the last call, then zero it */
+ULONG eventRing_takeLost(EVENT_RING *r);
+
+#endif
@@ -0,0 +1,57 @@
+/* statCounters.h */
+
+#ifndef _STAT_COUNTERS_
+#define _STAT_COUNTERS_
+
+/* Statistics counters written by several threads.  Each
+   group of counters is split into per-thread shards, one
+   cache line each, so increments never share a line with
+   another writer.  Readers sum the shards.  A reset does
+   not touch the shards: it records the current sums as the
+   group's base under a new epoch, and readers subtract the
+   base.  The epoch works as a sequence lock, so a snapshot
+   never mixes values from before and after a reset. */
+
+#define STAT_CACHE_LINE 64
+#define STAT_MAX_SHARDS 8
+#define STAT_MAX_COUNTERS (STAT_CACHE_LINE/sizeof(ULONG))
+
+typedef struct {
+	ULONG v[STAT_MAX_COUNTERS];
+} __attribute__((aligned(STAT_CACHE_LINE))) STAT_SHARD;
+
+typedef struct {
+	STAT_SHARD shard[STAT_MAX_SHARDS];
+	ULONG base[STAT_MAX_COUNTERS];
+	/* odd while a reset is in progress */
+	volatile ULONG epoch;
+	int resetLock;
+	int cnt;
+	const char *name;
+} STAT_GROUP;
+
+/* shard used by the calling thread, -1 until first use */
+extern __thread int statShardIdx;
+int statCounters_shard(void);
+
+#define STAT_SHARD_OF(g) \
+	(&(g)->shard[(statShardIdx>=0) ? statShardIdx : statCounters_shard()])
+
+/* hot path increments, lock free and uncontended unless
+   more than STAT_MAX_SHARDS threads share a group */
+#define STAT_ADD(g,i,n) \
+	__sync_fetch_and_add(&STAT_SHARD_OF(g)->v[(i)],(ULONG)(n))
+#define STAT_INC(g,i) STAT_ADD(g,i,1)
+
+void statCounters_init(STAT_GROUP *g, const char *name, int cnt);
+
+/* consistent copy of all counters of a group */
+void statCounters_snapshot(STAT_GROUP *g, ULONG *values);
+
+/* one counter, since the last reset */
+ULONG statCounters_read(STAT_GROUP *g, int i);
+
+/* start a new epoch with every counter at zero */
+void statCounters_reset(STAT_GROUP *g);
+
+#endif
@@ -0,0 +1,195 @@
+/* MSGHANDLERextAPIstatus.h */
+
+/* This file contains additional Message Handler
+   subtypes and response formats, allocated above
+   those in MSGHANDLERmessageAPIstatus.h. */
+
+#ifndef _MSGHANDLER_EXT_API_STATUS_
+#define _MSGHANDLER_EXT_API_STATUS_
+
+/* error string for requests whose data length does not
+   match the message catalog (COMMON_Bad_Msg_Format) */
+#define MSGHAND_ERS_BAD_MSG_FORMAT "MSGHAND: bad message format"
+
+/* Response to: 
+	subType: MSGHAND_GET_BUF_STATS
+   Passed values:
+	none
+   Size of passed values:
+	0  
+   Returned values in data portion of message:
+    All ULONGs are in BIG ENDIAN format.
+	ULONG totalCnt;
+	ULONG freeCnt;
+	ULONG lowWater;	  smallest free count seen
+	ULONG allocCnt;
+	ULONG releaseCnt;
+	ULONG allocFail;	  allocations refused, pool empty
+	ULONG freeListCorrupt;
+	ULONG census[MSGBUF_OWNER_CNT];  buffers held per stage,
+				 indexed by MSGBUF_OWNER_xxx
+   Size of returned values in data portion: */
+#define MSGHAND_GET_BUF_STATS 40
+#define MSGHAND_GET_BUF_STATS_LEN (4*(7+MSGBUF_OWNER_CNT))
+
+/* Response to: 
+	subType: MSGHAND_CLR_BUF_STATS
+   Passed values:
+	none
+   Returned values in data portion of message:
+	none
+   Resets pool counters and the low-water mark. */
+#define MSGHAND_CLR_BUF_STATS 41
+
+/* Response to: 
+	subType: MSGHAND_GET_BUF_OWNERS
+   Passed values:
+	none
+   Size of passed values:
+	0  
+   Returned values in data portion of message, one
+   record per outstanding buffer:
+	UBYTE slot;
+	UBYTE owner;		  MSGBUF_OWNER_xxx
+	USHORT line;		  allocation site line
+	ULONG ageMsec;	  time since allocation
+	char file[MSGHAND_BUF_FILE_LEN];  allocation site,
+				 trailing part of file name
+   Site and age are zero unless domapp was built with
+   MESSAGE_BUFFERS_DEBUG.
+   Size of returned values in data portion:
+	n*MSGHAND_BUF_OWNER_REC_LEN */
+#define MSGHAND_GET_BUF_OWNERS 42
+#define MSGHAND_BUF_FILE_LEN 8
+#define MSGHAND_BUF_OWNER_REC_LEN (8+MSGHAND_BUF_FILE_LEN)
+
+/* Response to: 
+	subType: MSGHAND_COMPOUND
+   Passed values, a list of sub-requests each made of:
+	UBYTE type;
+	UBYTE subtype;
+	USHORT argLen;
+	UBYTE args[argLen];	  data portion of the sub-request
+   Size of passed values:
+	sum of MSGHAND_COMPOUND_ENTRY_HDR_LEN+argLen
+   Returned values in data portion of message:
+	USHORT entryCnt;	  sub-requests executed
+   followed by entryCnt replies, in request order:
+	UBYTE type;
+	UBYTE subtype;
+	UBYTE status;		  status the sub-request would
+				 have returned on its own
+	USHORT len;
+	UBYTE data[len];
+   Sub-requests for other services are queued to that
+   service one at a time, in turn with its other messages;
+   the next entry runs once the reply is back, and other
+   requests are routed meanwhile.  At most
+   MSGHAND_COMPOUND_MAX compound requests wait on services
+   at once, more are refused with SERVER_STACK_FULL.
+   Execution stops at a truncated entry, or before an
+   entry whose reply of fixed length would not fit in
+   one message; entryCnt tells how far it got.  An entry
+   that ran but whose reply did not fit is listed with
+   its status, len MSGHAND_COMPOUND_NO_REPLY and no data,
+   and is the last one run.  Compound requests do not
+   nest.
+   Size of returned values in data portion:
+	variable */
+#define MSGHAND_COMPOUND 43
+#define MSGHAND_COMPOUND_ENTRY_HDR_LEN 4
+#define MSGHAND_COMPOUND_RSP_HDR_LEN 2
+#define MSGHAND_COMPOUND_RSP_ENTRY_LEN 5
+#define MSGHAND_COMPOUND_MAX 8
+#define MSGHAND_COMPOUND_NO_REPLY 0xffff
+
+/* Response to: 
+	subType: MSGHAND_TRACE
+   Passed values:
+	UBYTE command;	  MSGHAND_TRACE_xxx
+   Size of passed values:
+	1
+   Returned values in data portion of message:
+    All LONGs are in BIG ENDIAN format.
+	LONG count;	  spans written by DUMP, -1 if the
+			 file could not be written; 0 otherwise
+   START clears earlier stamps and turns tracing on.  DUMP
+   turns it off and writes the trace as Chrome trace-event
+   JSON to DOMTRACE_DUMP_PATH on the DOM.
+   Size of returned values in data portion: */
+#define MSGHAND_TRACE 44
+#define MSGHAND_TRACE_LEN 4
+#define MSGHAND_TRACE_STOP 0
+#define MSGHAND_TRACE_START 1
+#define MSGHAND_TRACE_DUMP 2
+
+/* Response to: 
+	subType: MSGHAND_SUBSCRIBE
+   Passed values:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	USHORT periodMsec;	  push period, at least
+				 MSGHAND_SUBSCRIBE_MIN_PERIOD
+	ULONG threshold;	  push only when a counter moved
+				 by at least this much, 0 always
+	UBYTE lane;		  MSGHAND_LANE_xxx
+	UBYTE cnt;
+	USHORT counter[cnt];	  group<<8|index, see below
+   Size of passed values:
+	MSGHAND_SUBSCRIBE_HDR_LEN+2*cnt
+   Returned values in data portion of message:
+	UBYTE id;		  subscription id
+   Counter groups: 0 packet (PKT_xxx), 1 message (MSG_xxx),
+   2 queue overflow (OVFL_xxx), 3 Message Handler service
+   counters (SVC_xxx), then the other services' SVC_xxx
+   counters in the order domapp starts them.
+   Pushes come as unsolicited MSGHAND_SUBSCRIPTION_PUSH
+   messages.  Low lane pushes are put off while the
+   message pool runs low; deltas are always against the
+   last push sent, so a late push carries everything.
+   SERVICE_SPECIFIC_ERROR if all subscriptions are in use.
+   Size of returned values in data portion: */
+#define MSGHAND_SUBSCRIBE 45
+#define MSGHAND_SUBSCRIBE_LEN 1
+#define MSGHAND_SUBSCRIBE_HDR_LEN 8
+#define MSGHAND_SUBSCRIBE_MIN_PERIOD 10
+#define MSGHAND_LANE_HIGH 0
+#define MSGHAND_LANE_LOW 1
+
+/* Response to: 
+	subType: MSGHAND_UNSUBSCRIBE
+   Passed values:
+	UBYTE id;
+   Size of passed values:
+	1
+   Returned values in data portion of message:
+    All ULONGs are in BIG ENDIAN format.
+	ULONG pushed;		  pushes sent
+	ULONG skipped;		  periods under the threshold
+	ULONG deferred;	  pushes put off for lack of
+				 buffers
+   Size of returned values in data portion: */
+#define MSGHAND_UNSUBSCRIBE 46
+#define MSGHAND_UNSUBSCRIBE_LEN 12
+
+/* Unsolicited, sent by domapp: 
+	subType: MSGHAND_SUBSCRIPTION_PUSH
+   Data portion of message:
+    All USHORTs and ULONGs are in BIG ENDIAN format.
+	UBYTE id;
+	UBYTE flags;		  MSGHAND_PUSH_KEY
+	USHORT seq;		  counts pushes of this id
+	ULONG timeMsec;	  domapp monotonic clock
+	then one varint per subscribed counter, in order:
+	 7 bits a byte, low bits first, top bit set when
+	 more bytes follow.  A key push carries the values,
+	 other pushes carry the zigzag coded change since
+	 the previous push ((d<<1)^(d>>31)).  A key push is
+	 sent first and every MSGHAND_PUSH_KEY_EVERY periods.
+   Size of data portion:
+	MSGHAND_PUSH_HDR_LEN plus the varints */
+#define MSGHAND_SUBSCRIPTION_PUSH 47
+#define MSGHAND_PUSH_HDR_LEN 8
+#define MSGHAND_PUSH_KEY 0x01
+#define MSGHAND_PUSH_KEY_EVERY 16
+
+#endif
@@ -0,0 +1,27 @@
+/* msgCatalog.h */
+
+/* Compile-time message catalog.  Each service lists its
+   (type, subtype) pairs in its own catalog file, included
+   below, with
+
+   MSG_CATALOG_HANDLER(type, subtype, handler, reqLen, rspLen)
+	local handler with expected request length and
+	fixed response length (or MSG_LEN_ANY)
+   MSG_CATALOG_FORWARD(type, queue, owner, ovflIdx)
+	every subtype of type goes to the named queue,
+	ovflIdx counts queue full in ovflStats
+
+   The includer defines both macros before including this
+   file; it is deliberately not guarded.  Adding a service
+   means adding its catalog file here. */
+
+#include "msgHandler/msgHandlerCatalog.h"
+
+MSG_CATALOG_FORWARD(DOM_SLOW_CONTROL, SC, MSGBUF_OWNER_SC,
+	OVFL_SLOW_CNT)
+MSG_CATALOG_FORWARD(DATA_ACCESS, DA, MSGBUF_OWNER_DA,
+	OVFL_DATA_ACC)
+MSG_CATALOG_FORWARD(EXPERIMENT_CONTROL, EC, MSGBUF_OWNER_EC,
+	OVFL_EXP_CNT)
+MSG_CATALOG_FORWARD(TEST_MANAGER, TM, MSGBUF_OWNER_TM,
+	OVFL_EXP_CNT)
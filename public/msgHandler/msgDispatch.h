@@ -0,0 +1,80 @@
+#ifndef _MSG_DISPATCH_H_
+#define _MSG_DISPATCH_H_
+/* msgDispatch.h */
+
+/* Table driven routing of messages by (type, subtype).
+   The table is filled at startup from the compile-time
+   catalog in msgHandler/msgCatalog.h and may be extended
+   at run time with msgDispatch_register().  Lookup is a
+   row index by type followed by a column index by
+   subtype. */
+
+/* request or response length checked/set by the
+   handler itself */
+#define MSG_LEN_ANY -1
+
+/* returned by a local handler that keeps M to answer it
+   later, e.g. a compound request waiting on a service.
+   The handler sends the reply itself.  Never sent. */
+#define MSG_HANDLER_KEPT LAST_STATUS
+
+/* set in res[0] of a request msgHandler forwards on its
+   own behalf.  The service sends the reply back to RD
+   instead of SD; res[1] is msgHandler's. */
+#define MSG_DISPATCH_RETURN_FLAG 0x40
+
+/* local handler.  Fills in the reply in place and
+   returns the message status.  If the catalog gives a
+   fixed response length it is applied after the call,
+   otherwise the handler sets the data length. */
+typedef UBYTE (*MSG_HANDLER_FN)(MESSAGE_STRUCT *M);
+
+typedef struct {
+	MSG_HANDLER_FN handler;	/* local handler, or 0 */
+	int *queue;		/* queue to forward to, or 0 */
+	int owner;		/* MSGBUF_OWNER_xxx when forwarded */
+	int ovflIdx;		/* ovflStats counter for queue full */
+	short reqLen;		/* expected request length */
+	short rspLen;		/* fixed response length */
+} MSG_DISPATCH_ENTRY;
+
+/* outcome of msgDispatch_route() */
+#define MSG_DISPATCH_DONE 0
+#define MSG_DISPATCH_FORWARDED 1
+#define MSG_DISPATCH_STACK_FULL 2
+#define MSG_DISPATCH_BAD_FORMAT 3
+#define MSG_DISPATCH_UNKNOWN_SUBTYPE 4
+#define MSG_DISPATCH_UNKNOWN_SERVER 5
+
+/* most message types that may have table rows */
+#define MSG_DISPATCH_MAX_TYPES 16
+
+/* fill the table from the compile-time catalog */
+int msgDispatch_init(void);
+
+/* add a local handler for one (type, subtype) pair.
+   Returns 0, or -1 if the pair is taken or the table
+   is full. */
+int msgDispatch_register(UBYTE type, UBYTE subtype,
+	MSG_HANDLER_FN handler, short reqLen, short rspLen);
+
+/* route every subtype of type to a service queue */
+int msgDispatch_registerForward(UBYTE type, int *queue,
+	int owner, int ovflIdx);
+
+MSG_DISPATCH_ENTRY *msgDispatch_lookup(UBYTE type, UBYTE subtype);
+
+/* TRUE if any subtype of type has an entry */
+int msgDispatch_knownType(UBYTE type);
+
+/* called after each successful forward, e.g. to wake
+   the service workers */
+typedef void (*MSG_FORWARD_HOOK)(int queue);
+void msgDispatch_setForwardHook(MSG_FORWARD_HOOK hook);
+
+/* validate and run a local handler, or forward the
+   message to its service queue.  FORWARDED is also
+   returned for a message a handler kept. */
+int msgDispatch_route(MESSAGE_STRUCT *M);
+
+#endif
@@ -0,0 +1,60 @@
+/* msgHandlerCatalog.h */
+
+/* Message Handler entries for the message catalog,
+   see msgHandler/msgCatalog.h.  Not guarded. */
+
+/* Manditory Service SubTypes */
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, GET_SERVICE_STATE,
+	msgHand_getServiceState, 0, GET_SERVICE_STATE_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, GET_LAST_ERROR_ID,
+	msgHand_getLastErrorID, 0, GET_LAST_ERROR_ID_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, GET_SERVICE_VERSION_INFO,
+	msgHand_getServiceVersionInfo, 0, GET_SERVICE_VERSION_INFO_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, GET_SERVICE_STATS,
+	msgHand_getServiceStats, 0, GET_SERVICE_STATS_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, GET_LAST_ERROR_STR,
+	msgHand_getLastErrorStr, 0, MSG_LEN_ANY)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, CLEAR_LAST_ERROR,
+	msgHand_clearLastError, 0, 0)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, REMOTE_OBJECT_REF,
+	msgHand_remoteObjectRef, MSG_LEN_ANY, 0)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, GET_SERVICE_SUMMARY,
+	msgHand_getServiceSummary, 0, MSG_LEN_ANY)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, GET_SERVICE_EVENTS,
+	msgHand_getServiceEvents, 0, MSG_LEN_ANY)
+
+/* Message Handler specific SubTypes */
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_DOM_VER,
+	msgHand_getDomVer, 0, MSGHAND_GET_DOM_VERSION_INFO_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_DOM_ID,
+	msgHand_getDomID, 0, MSGHAND_GET_DOM_ID_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_DOM_NAME,
+	msgHand_getDomName, 0, MSG_LEN_ANY)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_ATWD_ID,
+	msgHand_getAtwdID, 0, MSGHAND_GET_ATWD_ID_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_PKT_STATS,
+	msgHand_getPktStats, 0, MSGHAND_GET_PKT_STATS_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_MSG_STATS,
+	msgHand_getMsgStats, 0, MSGHAND_GET_MSG_STATS_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_CLR_PKT_STATS,
+	msgHand_clrPktStats, 0, 0)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_CLR_MSG_STATS,
+	msgHand_clrMsgStats, 0, 0)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_ECHO_MSG,
+	msgHand_echoMsg, MSG_LEN_ANY, MSG_LEN_ANY)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_DOM_POSITION,
+	msgHand_getDomPosition, 0, MSGHAND_GET_DOM_POSITION_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_BUF_STATS,
+	msgHand_getBufStats, 0, MSGHAND_GET_BUF_STATS_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_CLR_BUF_STATS,
+	msgHand_clrBufStats, 0, 0)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_GET_BUF_OWNERS,
+	msgHand_getBufOwners, 0, MSG_LEN_ANY)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_COMPOUND,
+	msgHand_compound, MSG_LEN_ANY, MSG_LEN_ANY)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_TRACE,
+	msgHand_trace, 1, MSGHAND_TRACE_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_SUBSCRIBE,
+	msgHand_subscribe, MSG_LEN_ANY, MSGHAND_SUBSCRIBE_LEN)
+MSG_CATALOG_HANDLER(MESSAGE_HANDLER, MSGHAND_UNSUBSCRIBE,
+	msgHand_unsubscribe, 1, MSGHAND_UNSUBSCRIBE_LEN)
@@ -0,0 +1,31 @@
+#ifndef _MSG_SUBSCRIBE_H_
+#define _MSG_SUBSCRIBE_H_
+/* msgSubscribe.h */
+
+/* Push mode monitoring.  A client subscribes to a set of
+   counters (MSGHAND_SUBSCRIBE) and domapp pushes delta
+   coded snapshots of them onto SD each period, in place
+   of the client polling the GET_xxx_STATS subtypes.
+   Counters are addressed by group, see
+   MSGHANDLERextAPIstatus.h; domapp registers the groups
+   at startup in that order.  msgSubscribe_tick() is
+   called from a timer thread; it never blocks. */
+
+#define MSG_SUBSCRIBE_MAX 8
+#define MSG_SUBSCRIBE_MAX_COUNTERS 32
+#define MSG_SUBSCRIBE_MAX_GROUPS 16
+/* how often domapp calls msgSubscribe_tick() */
+#define MSG_SUBSCRIBE_TICK_MSEC 10
+/* low lane pushes wait while fewer than 1/n of the
+   message buffers are free */
+#define MSG_SUBSCRIBE_LOW_FRACTION 4
+
+/* next counter group.  Returns its number, or -1 if the
+   group table is full. */
+int msgSubscribe_addGroup(STAT_GROUP *g);
+
+/* push every subscription that is due at nowMsec, a
+   monotonic clock.  Returns the number of pushes sent. */
+int msgSubscribe_tick(ULONG nowMsec);
+
+#endif